@@ -0,0 +1,141 @@
+#include "bench_util.hpp"
+#include "common/concurrent_store.hpp"
+#include "common/hyperloglog.hpp"
+#include "util/bitops.hpp"
+#include <cstring>
+#include <random>
+
+namespace {
+
+// One 512 MB bitmap (Redis' largest string), filled once and shared by the
+// BITCOUNT benchmarks.
+constexpr size_t BITMAP_BYTES = size_t{512} << 20;
+
+const std::string &big_bitmap() {
+  static const std::string bitmap = [] {
+    std::string s(BITMAP_BYTES, '\0');
+    std::mt19937_64 rng(42);
+    for (size_t i = 0; i + 8 <= s.size(); i += 8) {
+      u64 w = rng();
+      std::memcpy(s.data() + i, &w, sizeof(w));
+    }
+    return s;
+  }();
+  return bitmap;
+}
+
+constexpr i64 IMPLS[] = {static_cast<i64>(ScanImpl::SCALAR),
+                         static_cast<i64>(ScanImpl::AVX2)};
+
+} // namespace
+
+// Raw popcount kernel over the whole bitmap. range(0) selects the ScanImpl.
+static void BM_Popcount512MB(benchmark::State &state) {
+  auto impl = static_cast<ScanImpl>(state.range(0));
+  if (!scan_impl_supported(impl)) {
+    state.SkipWithError("implementation not supported on this CPU");
+    return;
+  }
+  state.SetLabel(scan_impl_name(impl));
+  const std::string &bitmap = big_bitmap();
+  for (auto _ : state) {
+    size_t bits = popcount_with(
+        impl, reinterpret_cast<const uint8_t *>(bitmap.data()), bitmap.size());
+    benchmark::DoNotOptimize(bits);
+  }
+  state.SetBytesProcessed(state.iterations() * bitmap.size());
+}
+BENCHMARK(BM_Popcount512MB)
+    ->ArgName("impl")
+    ->Arg(IMPLS[0])
+    ->Arg(IMPLS[1])
+    ->Unit(benchmark::kMillisecond);
+
+// BITCOUNT's path: the count runs inside read_string, under the shard lock.
+static void BM_StoreBitcount512MB(benchmark::State &state) {
+  Redis::ConcurrentStore store;
+  store.set("bitmap", Redis::Value{big_bitmap()});
+  for (auto _ : state) {
+    size_t bits = 0;
+    store.read_string("bitmap", [&](std::string_view s) {
+      bits = popcount(reinterpret_cast<const uint8_t *>(s.data()), s.size());
+    });
+    benchmark::DoNotOptimize(bits);
+  }
+  state.SetBytesProcessed(state.iterations() * BITMAP_BYTES);
+}
+BENCHMARK(BM_StoreBitcount512MB)->Unit(benchmark::kMillisecond);
+
+// PFMERGE's inner loop: range(1) dense HyperLogLogs of 20k elements each,
+// unpacked and max-merged into one register set. range(0) selects the
+// ScanImpl of the max kernel.
+static void BM_HllMerge(benchmark::State &state) {
+  auto impl = static_cast<ScanImpl>(state.range(0));
+  if (!scan_impl_supported(impl)) {
+    state.SkipWithError("implementation not supported on this CPU");
+    return;
+  }
+  state.SetLabel(scan_impl_name(impl));
+  size_t keys = static_cast<size_t>(state.range(1));
+  std::vector<std::string> hlls;
+  std::vector<std::string> elements(20000);
+  for (size_t k = 0; k < keys; k++) {
+    for (size_t i = 0; i < elements.size(); i++) {
+      elements[i] = std::to_string(k * elements.size() + i);
+    }
+    std::string hll = Redis::hll::create();
+    bool changed;
+    Redis::hll::add(hll, elements, changed);
+    hlls.push_back(std::move(hll));
+  }
+
+  std::vector<uint8_t> registers(Redis::hll::REGISTERS);
+  for (auto _ : state) {
+    std::fill(registers.begin(), registers.end(), 0);
+    for (const auto &hll : hlls) {
+      Redis::hll::merge_into_with(impl, registers.data(), hll);
+    }
+    benchmark::DoNotOptimize(registers.data());
+  }
+  state.SetItemsProcessed(state.iterations() * keys);
+}
+BENCHMARK(BM_HllMerge)
+    ->ArgNames({"impl", "keys"})
+    ->ArgsProduct({{IMPLS[0], IMPLS[1]}, {100, 500}})
+    ->Unit(benchmark::kMicrosecond);
+
+// The PFMERGE command end to end against the store, with the SIMD kernel
+// chosen at startup.
+static void BM_StorePfmerge(benchmark::State &state) {
+  size_t keys = static_cast<size_t>(state.range(0));
+  Redis::ConcurrentStore store;
+  std::vector<std::string> names;
+  std::vector<std::string> elements(20000);
+  for (size_t k = 0; k < keys; k++) {
+    for (size_t i = 0; i < elements.size(); i++) {
+      elements[i] = std::to_string(k * elements.size() + i);
+    }
+    std::string hll = Redis::hll::create();
+    bool changed;
+    Redis::hll::add(hll, elements, changed);
+    names.push_back("hll:" + std::to_string(k));
+    store.set(names.back(), Redis::Value{std::move(hll)});
+  }
+
+  std::vector<uint8_t> registers(Redis::hll::REGISTERS);
+  for (auto _ : state) {
+    std::fill(registers.begin(), registers.end(), 0);
+    {
+      Redis::ConcurrentStore::KeyLock lock(store, names);
+      for (const auto &name : names) {
+        store.read_string(name, [&](std::string_view s) {
+          Redis::hll::merge_into(registers.data(), s);
+        });
+      }
+    }
+    store.set("dest", Redis::Value{Redis::hll::from_registers(
+                          registers.data())});
+  }
+  state.SetItemsProcessed(state.iterations() * keys);
+}
+BENCHMARK(BM_StorePfmerge)->Arg(100)->Arg(500)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,131 @@
+#include "bench_util.hpp"
+#include "util/RESP.hpp"
+#include "util/simd_scan.hpp"
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+static void BM_ParseSingle(benchmark::State &state) {
+  std::string data = encode_command({"SET", "key:12345", "value"});
+  AllocationScope allocs(state);
+  for (auto _ : state) {
+    size_t pos = 0;
+    RESP r = parse_RESP(data, pos);
+    benchmark::DoNotOptimize(r);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ParseSingle);
+
+// A read buffer holding `range(0)` pipelined GETs.
+static void BM_ParsePipelined(benchmark::State &state) {
+  std::string data;
+  for (i64 i = 0; i < state.range(0); i++) {
+    data += encode_command({"GET", "key:" + std::to_string(i)});
+  }
+  AllocationScope allocs(state);
+  for (auto _ : state) {
+    size_t pos = 0;
+    while (pos < data.size()) {
+      RESP r = parse_RESP(data, pos);
+      benchmark::DoNotOptimize(r);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ParsePipelined)->Arg(16)->Arg(128)->Arg(1024);
+
+static void BM_ParseLargeBulk(benchmark::State &state) {
+  std::string data = encode_command(
+      {"SET", "big", std::string(static_cast<size_t>(state.range(0)), 'x')});
+  AllocationScope allocs(state);
+  for (auto _ : state) {
+    size_t pos = 0;
+    RESP r = parse_RESP(data, pos);
+    benchmark::DoNotOptimize(r);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ParseLargeBulk)->Range(1 << 10, 64 << 20);
+
+static void BM_SerializeBulk(benchmark::State &state) {
+  RESP r{.resp_type = RESP::type::BULK_STRING,
+         .str = std::string(static_cast<size_t>(state.range(0)), 'x')};
+  AllocationScope allocs(state);
+  for (auto _ : state) {
+    std::string out = serialize_RESP(r);
+    benchmark::DoNotOptimize(out);
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SerializeBulk)->Arg(16)->Arg(4096)->Arg(1 << 20);
+
+static void BM_SerializeArray(benchmark::State &state) {
+  RESP r{.resp_type = RESP::type::ARRAY};
+  for (i64 i = 0; i < state.range(0); i++) {
+    r.elements.push_back({.resp_type = RESP::type::BULK_STRING,
+                          .str = "element:" + std::to_string(i)});
+  }
+  AllocationScope allocs(state);
+  for (auto _ : state) {
+    std::string out = serialize_RESP(r);
+    benchmark::DoNotOptimize(out);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SerializeArray)->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_RESPToTokens(benchmark::State &state) {
+  std::vector<std::string> args = {"RPUSH", "mylist"};
+  for (i64 i = 0; i < state.range(0); i++) {
+    args.push_back("value:" + std::to_string(i));
+  }
+  std::string data = encode_command(args);
+  size_t pos = 0;
+  RESP r = parse_RESP(data, pos);
+
+  AllocationScope allocs(state);
+  for (auto _ : state) {
+    std::vector<std::string> tokens = RESP_to_tokens(r);
+    benchmark::DoNotOptimize(tokens);
+  }
+  state.SetItemsProcessed(state.iterations() * args.size());
+}
+BENCHMARK(BM_RESPToTokens)->Arg(1)->Arg(16)->Arg(256);
+
+// Scans a buffer whose only CRLF is at the very end. range(0) selects the
+// ScanImpl, range(1) the buffer size. Reports bytes per TSC cycle on x86.
+static void BM_FindCRLF(benchmark::State &state) {
+  auto impl = static_cast<ScanImpl>(state.range(0));
+  if (!scan_impl_supported(impl)) {
+    state.SkipWithError("implementation not supported on this CPU");
+    return;
+  }
+  state.SetLabel(scan_impl_name(impl));
+
+  std::string data(static_cast<size_t>(state.range(1)), 'x');
+  data[data.size() - 2] = '\r';
+  data[data.size() - 1] = '\n';
+
+#if defined(__x86_64__)
+  u64 cycles_start = __rdtsc();
+#endif
+  for (auto _ : state) {
+    size_t pos = find_crlf_with(impl, data.data(), data.size());
+    benchmark::DoNotOptimize(pos);
+  }
+#if defined(__x86_64__)
+  u64 cycles = __rdtsc() - cycles_start;
+  state.counters["bytes/cycle"] =
+      static_cast<f64>(state.iterations() * data.size()) / cycles;
+#endif
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_FindCRLF)
+    ->ArgNames({"impl", "bytes"})
+    ->ArgsProduct({{static_cast<i64>(ScanImpl::SCALAR),
+                    static_cast<i64>(ScanImpl::SSE2),
+                    static_cast<i64>(ScanImpl::AVX2)},
+                   {16, 64, 1024, 65536}});
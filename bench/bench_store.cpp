@@ -0,0 +1,179 @@
+#include "bench_util.hpp"
+#include "common/concurrent_store.hpp"
+#include <memory>
+#include <thread>
+
+namespace {
+
+constexpr size_t KEY_COUNT = 100000;
+
+// Shared across the threads of one ThreadRange run; thread 0 owns setup.
+std::unique_ptr<Redis::ConcurrentStore> g_store;
+std::vector<std::string> g_keys = make_keys(KEY_COUNT);
+
+void setup_store(const benchmark::State &state) {
+  if (state.thread_index() != 0)
+    return;
+  g_store = std::make_unique<Redis::ConcurrentStore>();
+  for (const auto &key : g_keys) {
+    g_store->set(key, Redis::Value{std::string("value")});
+  }
+}
+
+// Counters for the INCR benchmarks, in the native i64 encoding or as the
+// decimal strings a store without integer encoding would hold.
+void setup_int_counters(const benchmark::State &state) {
+  if (state.thread_index() != 0)
+    return;
+  g_store = std::make_unique<Redis::ConcurrentStore>();
+  for (const auto &key : g_keys) {
+    g_store->set(key, Redis::Value{i64{0}});
+  }
+}
+
+void setup_string_counters(const benchmark::State &state) {
+  if (state.thread_index() != 0)
+    return;
+  g_store = std::make_unique<Redis::ConcurrentStore>();
+  for (const auto &key : g_keys) {
+    g_store->set(key, Redis::Value{std::string("0")});
+  }
+}
+
+void teardown_store(const benchmark::State &state) {
+  if (state.thread_index() == 0)
+    g_store.reset();
+}
+
+} // namespace
+
+// range(0): 0 = uniform keys, 1 = zipfian keys.
+static void BM_StoreGet(benchmark::State &state) {
+  KeyPicker picker(KEY_COUNT, state.range(0) == 1, 0.99,
+                   state.thread_index() + 1);
+  AllocationScope allocs(state);
+  for (auto _ : state) {
+    auto v = g_store->get(g_keys[picker.next()]);
+    benchmark::DoNotOptimize(v);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StoreGet)
+    ->Setup(setup_store)
+    ->Teardown(teardown_store)
+    ->ArgName("zipf")
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+static void BM_StoreSet(benchmark::State &state) {
+  KeyPicker picker(KEY_COUNT, state.range(0) == 1, 0.99,
+                   state.thread_index() + 1);
+  std::string value = "value";
+  AllocationScope allocs(state);
+  for (auto _ : state) {
+    g_store->set(g_keys[picker.next()], Redis::Value{value});
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StoreSet)
+    ->Setup(setup_store)
+    ->Teardown(teardown_store)
+    ->ArgName("zipf")
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+static void BM_StoreGetOrCreate(benchmark::State &state) {
+  KeyPicker picker(KEY_COUNT, state.range(0) == 1, 0.99,
+                   state.thread_index() + 1);
+  std::vector<std::string> list_keys = make_keys(1024);
+  AllocationScope allocs(state);
+  for (auto _ : state) {
+    Redis::Value *v =
+        g_store->get_or_create("list:" + list_keys[picker.next() % 1024]);
+    benchmark::DoNotOptimize(v);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StoreGetOrCreate)
+    ->Setup(setup_store)
+    ->Teardown(teardown_store)
+    ->ArgName("zipf")
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+// INCR in place under the shard lock: no allocation, no formatting.
+static void BM_StoreIncr(benchmark::State &state) {
+  KeyPicker picker(KEY_COUNT, state.range(0) == 1, 0.99,
+                   state.thread_index() + 1);
+  AllocationScope allocs(state);
+  for (auto _ : state) {
+    i64 result;
+    g_store->incr_by(g_keys[picker.next()], 1, result);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StoreIncr)
+    ->Setup(setup_int_counters)
+    ->Teardown(teardown_store)
+    ->ArgName("zipf")
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+// Baseline: INCR as a client-side read-modify-write over string values (copy
+// out, parse, format, write back). Not atomic; only here for the cost.
+static void BM_StoreIncrStringRoundTrip(benchmark::State &state) {
+  KeyPicker picker(KEY_COUNT, state.range(0) == 1, 0.99,
+                   state.thread_index() + 1);
+  AllocationScope allocs(state);
+  for (auto _ : state) {
+    const std::string &key = g_keys[picker.next()];
+    auto v = g_store->get(key);
+    i64 n = std::stoll(std::get<std::string>(*v)) + 1;
+    g_store->set(key, Redis::Value{std::to_string(n)});
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StoreIncrStringRoundTrip)
+    ->Setup(setup_string_counters)
+    ->Teardown(teardown_store)
+    ->ArgName("zipf")
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+// One active expiry cycle against a store holding range(0) already expired
+// volatile keys; the store is refilled (untimed) whenever it drains.
+static void BM_ActiveExpiryCycle(benchmark::State &state) {
+  const size_t n = static_cast<size_t>(state.range(0));
+  std::vector<std::string> keys = make_keys(n);
+  Redis::ConcurrentStore store;
+
+  auto fill = [&]() {
+    for (const auto &key : keys) {
+      store.set(key, Redis::Value{std::string("v")}, 1);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  };
+  fill();
+
+  AllocationScope allocs(state);
+  for (auto _ : state) {
+    store.active_expiry_cycle();
+    if (store.size() == 0) {
+      state.PauseTiming();
+      allocs.exclude(fill);
+      state.ResumeTiming();
+    }
+  }
+}
+BENCHMARK(BM_ActiveExpiryCycle)->Arg(1000000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,20 @@
+#include "bench_util.hpp"
+#include <cstdlib>
+#include <new>
+
+thread_local u64 t_allocations = 0;
+
+void *operator new(size_t size) {
+  t_allocations++;
+  if (void *p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) { return ::operator new(size); }
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
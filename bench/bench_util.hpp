@@ -0,0 +1,52 @@
+#pragma once
+#include "benchmark/key_picker.hpp"
+#include "common/types.hpp"
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+// Per-thread allocation counter, bumped by the operator new override in
+// bench_util.cpp. Thread-local so multi-threaded runs report per-op figures.
+extern thread_local u64 t_allocations;
+
+// Reports heap allocations per iteration as the "allocs/op" counter.
+class AllocationScope {
+public:
+  explicit AllocationScope(benchmark::State &state)
+      : state_(state), start_(t_allocations) {}
+
+  ~AllocationScope() {
+    u64 allocs = t_allocations - start_;
+    state_.counters["allocs/op"] = benchmark::Counter(
+        static_cast<f64>(allocs), benchmark::Counter::kAvgIterations);
+  }
+
+  // Runs fn without charging its allocations to the run; PauseTiming() only
+  // stops the clock, not the allocation counter.
+  template <typename F> void exclude(F &&fn) {
+    u64 before = t_allocations;
+    fn();
+    start_ += t_allocations - before;
+  }
+
+private:
+  benchmark::State &state_;
+  u64 start_;
+};
+
+inline std::vector<std::string> make_keys(size_t n) {
+  std::vector<std::string> keys;
+  keys.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    keys.push_back("key:" + std::to_string(i));
+  }
+  return keys;
+}
+
+inline std::string encode_command(const std::vector<std::string> &args) {
+  std::string out = "*" + std::to_string(args.size()) + "\r\n";
+  for (const auto &arg : args) {
+    out += "$" + std::to_string(arg.size()) + "\r\n" + arg + "\r\n";
+  }
+  return out;
+}
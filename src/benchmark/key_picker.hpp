@@ -0,0 +1,44 @@
+#pragma once
+#include "common/types.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+// Samples key indexes in [0, n) either uniformly or from a zipfian
+// distribution with exponent s (inverse-CDF lookup over a precomputed table).
+// Shared by redis_benchmark and the microbenchmarks.
+class KeyPicker {
+public:
+  KeyPicker(u64 n, bool zipf, f64 s, u64 seed)
+      : n_(n), zipf_(zipf), rng_(seed) {
+    if (!zipf_ || n_ <= 1)
+      return;
+    cdf_.resize(n_);
+    f64 sum = 0;
+    for (u64 i = 0; i < n_; i++) {
+      sum += 1.0 / std::pow(static_cast<f64>(i + 1), s);
+      cdf_[i] = sum;
+    }
+    for (auto &c : cdf_) {
+      c /= sum;
+    }
+  }
+
+  u64 next() {
+    if (n_ <= 1)
+      return 0;
+    if (!zipf_)
+      return std::uniform_int_distribution<u64>(0, n_ - 1)(rng_);
+    f64 u = std::uniform_real_distribution<f64>(0.0, 1.0)(rng_);
+    auto it = std::lower_bound(cdf_.begin(), cdf_.end(), u);
+    return static_cast<u64>(std::min<ptrdiff_t>(it - cdf_.begin(), n_ - 1));
+  }
+
+private:
+  u64 n_;
+  bool zipf_;
+  std::mt19937_64 rng_;
+  std::vector<f64> cdf_;
+};
@@ -0,0 +1,403 @@
+#include "benchmark/key_picker.hpp"
+#include "client/reply_parser.hpp"
+#include "common/types.hpp"
+#include "server/stats.hpp"
+#include "util/RESP.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <format>
+#include <iostream>
+#include <netinet/in.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+// Pipelined load generator: every connection keeps up to `pipeline` requests
+// in flight over a single non-blocking epoll loop, and per-request latency is
+// recorded into the same log-linear buckets the server uses for INFO.
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string host = "127.0.0.1";
+  int port = 6379;
+  int clients = 50;
+  u64 requests = 100000;
+  int pipeline = 1;
+  size_t value_size = 3;
+  u64 keyspace = 1;
+  bool zipf = false;
+  f64 zipf_s = 0.99;
+  int mget_keys = 10;
+  int lrange_count = 100;
+  // lrange and mget need LRANGE/MGET, which the server does not implement
+  // yet, so they only run when asked for with -t.
+  std::vector<std::string> tests = {"ping", "set", "get", "rpush"};
+  enum class Format { TEXT, CSV, JSON } format = Format::TEXT;
+};
+
+static void append_bulk(std::string &out, std::string_view s) {
+  out += std::format("${}\r\n", s.size());
+  out += s;
+  out += "\r\n";
+}
+
+static std::string key_name(u64 idx) { return std::format("key:{:012}", idx); }
+
+// Appends one RESP-encoded request for the named test.
+static void build_request(const std::string &test, const Options &opt,
+                          const std::string &value, KeyPicker &keys,
+                          std::string &out) {
+  if (test == "ping") {
+    out += "*1\r\n";
+    append_bulk(out, "PING");
+  } else if (test == "set") {
+    out += "*3\r\n";
+    append_bulk(out, "SET");
+    append_bulk(out, key_name(keys.next()));
+    append_bulk(out, value);
+  } else if (test == "get") {
+    out += "*2\r\n";
+    append_bulk(out, "GET");
+    append_bulk(out, key_name(keys.next()));
+  } else if (test == "incr") {
+    out += "*2\r\n";
+    append_bulk(out, "INCR");
+    append_bulk(out, std::format("counter:{:012}", keys.next()));
+  } else if (test == "rpush") {
+    out += "*3\r\n";
+    append_bulk(out, "RPUSH");
+    append_bulk(out, "mylist");
+    append_bulk(out, value);
+  } else if (test == "lrange") {
+    out += "*4\r\n";
+    append_bulk(out, "LRANGE");
+    append_bulk(out, "mylist");
+    append_bulk(out, "0");
+    append_bulk(out, std::to_string(opt.lrange_count - 1));
+  } else if (test == "mget") {
+    out += std::format("*{}\r\n", opt.mget_keys + 1);
+    append_bulk(out, "MGET");
+    for (int i = 0; i < opt.mget_keys; i++) {
+      append_bulk(out, key_name(keys.next()));
+    }
+  } else {
+    throw std::runtime_error("Unknown test: " + test);
+  }
+}
+
+struct Connection {
+  int fd = -1;
+  std::string out;
+  size_t out_sent = 0;
+  std::string in;
+  std::deque<Clock::time_point> inflight;
+  bool want_write = false;
+};
+
+struct Result {
+  std::string test;
+  u64 completed = 0;
+  u64 errors = 0;
+  f64 seconds = 0;
+  u64 max_us = 0;
+  Redis::CommandSnapshot latency;
+
+  f64 rps() const { return seconds > 0 ? completed / seconds : 0; }
+  // Bucket upper bounds can overshoot the exact maximum; clamp to it.
+  u64 pct(f64 p) const { return std::min(latency.percentile(p), max_us); }
+};
+
+static int connect_nonblocking(const Options &opt) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    throw std::runtime_error("Socket creation failed");
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(opt.port);
+  if (inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr) <= 0)
+    throw std::runtime_error("Invalid address: " + opt.host);
+  if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+    throw std::runtime_error("Connection failed: " +
+                             std::string(strerror(errno)));
+
+  configure_socket_safety(fd);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  return fd;
+}
+
+static Result run_test(const std::string &test, const Options &opt) {
+  Result result{.test = test};
+  result.latency.buckets.assign(Redis::LatencyBuckets::COUNT, 0);
+
+  std::string value(opt.value_size, 'x');
+  KeyPicker keys(opt.keyspace, opt.zipf, opt.zipf_s, 42);
+
+  int ep = epoll_create1(0);
+  std::vector<Connection> conns(opt.clients);
+  for (size_t i = 0; i < conns.size(); i++) {
+    conns[i].fd = connect_nonblocking(opt);
+    epoll_event ev{.events = EPOLLIN, .data = {.u64 = i}};
+    epoll_ctl(ep, EPOLL_CTL_ADD, conns[i].fd, &ev);
+  }
+
+  // Writes as much as the socket takes and only asks for EPOLLOUT while
+  // something is left over, so the loop never spins on a writable socket.
+  auto flush = [&](Connection &c, size_t idx) {
+    while (c.out_sent < c.out.size()) {
+      ssize_t w = send(c.fd, c.out.data() + c.out_sent,
+                       c.out.size() - c.out_sent, MSG_NOSIGNAL);
+      if (w > 0) {
+        c.out_sent += static_cast<size_t>(w);
+      } else if (w < 0 && errno == EINTR) {
+        continue;
+      } else if (w < 0 && errno == EAGAIN) {
+        break;
+      } else {
+        throw std::runtime_error("Connection lost while sending");
+      }
+    }
+    bool pending = c.out_sent < c.out.size();
+    if (pending != c.want_write) {
+      c.want_write = pending;
+      epoll_event ev{.events = EPOLLIN | (pending ? EPOLLOUT : 0u),
+                     .data = {.u64 = idx}};
+      epoll_ctl(ep, EPOLL_CTL_MOD, c.fd, &ev);
+    }
+  };
+
+  u64 issued = 0;
+  auto fill = [&](Connection &c) {
+    if (!c.inflight.empty() || issued >= opt.requests)
+      return;
+    c.out.clear();
+    c.out_sent = 0;
+    u64 batch = std::min<u64>(opt.pipeline, opt.requests - issued);
+    auto now = Clock::now();
+    for (u64 i = 0; i < batch; i++) {
+      build_request(test, opt, value, keys, c.out);
+      c.inflight.push_back(now);
+    }
+    issued += batch;
+  };
+
+  auto start = Clock::now();
+  for (size_t i = 0; i < conns.size(); i++) {
+    fill(conns[i]);
+    flush(conns[i], i);
+  }
+
+  std::vector<epoll_event> events(conns.size());
+  char temp[16384];
+  while (result.completed < opt.requests) {
+    int n = epoll_wait(ep, events.data(), static_cast<int>(events.size()), 1000);
+    if (n < 0 && errno != EINTR)
+      throw std::runtime_error("epoll_wait failed");
+
+    for (int i = 0; i < n; i++) {
+      size_t idx = events[i].data.u64;
+      Connection &c = conns[idx];
+
+      if (events[i].events & EPOLLOUT) {
+        flush(c, idx);
+      }
+
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        ssize_t r = recv(c.fd, temp, sizeof(temp), 0);
+        if (r == 0 || (r < 0 && errno != EAGAIN && errno != EINTR))
+          throw std::runtime_error("Connection closed by server");
+        if (r > 0)
+          c.in.append(temp, static_cast<size_t>(r));
+
+        size_t pos = 0;
+        while (!c.inflight.empty()) {
+          size_t len = Redis::ReplyParser::frame_length(c.in, pos);
+          if (len == 0)
+            break;
+          bool is_error = c.in[pos] == '-';
+          pos += len;
+
+          u64 us = static_cast<u64>(
+              std::chrono::duration_cast<std::chrono::microseconds>(
+                  Clock::now() - c.inflight.front())
+                  .count());
+          c.inflight.pop_front();
+          result.latency.buckets[Redis::LatencyBuckets::index_for(us)]++;
+          result.latency.calls++;
+          result.max_us = std::max(result.max_us, us);
+          result.completed++;
+          if (is_error)
+            result.errors++;
+        }
+        c.in.erase(0, pos);
+        fill(c);
+        flush(c, idx);
+      }
+    }
+  }
+  result.seconds =
+      std::chrono::duration<f64>(Clock::now() - start).count();
+
+  for (auto &c : conns) {
+    close(c.fd);
+  }
+  close(ep);
+  return result;
+}
+
+static void print_text(const Result &r, const Options &opt) {
+  std::cout << std::format("====== {} ======\n", r.test);
+  std::cout << std::format("  {} requests completed in {:.2f} seconds\n",
+                           r.completed, r.seconds);
+  std::cout << std::format(
+      "  {} parallel clients, {} bytes payload, pipeline {}\n", opt.clients,
+      opt.value_size, opt.pipeline);
+  if (r.errors > 0)
+    std::cout << std::format("  {} error replies\n", r.errors);
+  std::cout << std::format("  {:.2f} requests per second\n", r.rps());
+  std::cout << std::format(
+      "  latency (usec): p50={} p99={} p99.9={} max={}\n\n",
+      r.pct(50.0), r.pct(99.0),
+      r.pct(99.9), r.max_us);
+}
+
+static void print_csv(const std::vector<Result> &results) {
+  std::cout << "\"test\",\"rps\",\"p50_usec\",\"p99_usec\",\"p999_usec\","
+               "\"max_usec\",\"errors\"\n";
+  for (const auto &r : results) {
+    std::cout << std::format("\"{}\",\"{:.2f}\",\"{}\",\"{}\",\"{}\",\"{}\","
+                             "\"{}\"\n",
+                             r.test, r.rps(), r.pct(50.0),
+                             r.pct(99.0),
+                             r.pct(99.9), r.max_us, r.errors);
+  }
+}
+
+static void print_json(const std::vector<Result> &results,
+                       const Options &opt) {
+  std::cout << std::format("{{\"clients\":{},\"pipeline\":{},\"value_size\":{},"
+                           "\"keyspace\":{},\"distribution\":\"{}\",\"results\":[",
+                           opt.clients, opt.pipeline, opt.value_size,
+                           opt.keyspace, opt.zipf ? "zipf" : "uniform");
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
+    std::cout << std::format(
+        "{}{{\"test\":\"{}\",\"requests\":{},\"errors\":{},\"seconds\":{:.6f},"
+        "\"rps\":{:.2f},\"p50_usec\":{},\"p99_usec\":{},\"p999_usec\":{},"
+        "\"max_usec\":{}}}",
+        i ? "," : "", r.test, r.completed, r.errors, r.seconds, r.rps(),
+        r.pct(50.0), r.pct(99.0),
+        r.pct(99.9), r.max_us);
+  }
+  std::cout << "]}\n";
+}
+
+static void usage() {
+  std::cerr
+      << "Usage: redis_benchmark [options]\n"
+         "  -h <host>        Server hostname (default 127.0.0.1)\n"
+         "  -p <port>        Server port (default 6379)\n"
+         "  -c <clients>     Parallel connections (default 50)\n"
+         "  -n <requests>    Requests per test (default 100000)\n"
+         "  -P <pipeline>    Requests in flight per connection (default 1)\n"
+         "  -d <size>        SET/RPUSH value size in bytes (default 3)\n"
+         "  -r <keyspace>    Number of distinct keys (default 1)\n"
+         "  -t <tests>       Comma separated: ping,set,get,incr,rpush,lrange,\n"
+         "                   mget (default ping,set,get,rpush)\n"
+         "  --dist <d>       Key distribution: uniform or zipf (default uniform)\n"
+         "  --zipf-s <s>     Zipf exponent (default 0.99)\n"
+         "  --mget-keys <n>  Keys per MGET (default 10)\n"
+         "  --lrange <n>     Elements per LRANGE (default 100)\n"
+         "  --csv | --json   Machine readable output\n";
+}
+
+static Options parse_args(int argc, char **argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto next = [&]() -> std::string {
+      if (i + 1 >= argc)
+        throw std::runtime_error("Missing value for " + arg);
+      return argv[++i];
+    };
+
+    if (arg == "-h")
+      opt.host = next();
+    else if (arg == "-p")
+      opt.port = std::stoi(next());
+    else if (arg == "-c")
+      opt.clients = std::max(1, std::stoi(next()));
+    else if (arg == "-n")
+      opt.requests = std::stoull(next());
+    else if (arg == "-P")
+      opt.pipeline = std::max(1, std::stoi(next()));
+    else if (arg == "-d")
+      opt.value_size = std::stoull(next());
+    else if (arg == "-r")
+      opt.keyspace = std::max<u64>(1, std::stoull(next()));
+    else if (arg == "--dist")
+      opt.zipf = next() == "zipf";
+    else if (arg == "--zipf-s")
+      opt.zipf_s = std::stod(next());
+    else if (arg == "--mget-keys")
+      opt.mget_keys = std::max(1, std::stoi(next()));
+    else if (arg == "--lrange")
+      opt.lrange_count = std::max(1, std::stoi(next()));
+    else if (arg == "--csv")
+      opt.format = Options::Format::CSV;
+    else if (arg == "--json")
+      opt.format = Options::Format::JSON;
+    else if (arg == "-t") {
+      opt.tests.clear();
+      std::stringstream ss(next());
+      std::string test;
+      while (std::getline(ss, test, ',')) {
+        for (char &ch : test)
+          ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        opt.tests.push_back(test);
+      }
+    } else {
+      throw std::runtime_error("Unknown option: " + arg);
+    }
+  }
+  return opt;
+}
+
+int main(int argc, char **argv) {
+  Options opt;
+  try {
+    opt = parse_args(argc, argv);
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    usage();
+    return 1;
+  }
+
+  std::vector<Result> results;
+  try {
+    for (const auto &test : opt.tests) {
+      results.push_back(run_test(test, opt));
+      if (opt.format == Options::Format::TEXT)
+        print_text(results.back(), opt);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+
+  if (opt.format == Options::Format::CSV)
+    print_csv(results);
+  else if (opt.format == Options::Format::JSON)
+    print_json(results, opt);
+  return 0;
+}
@@ -0,0 +1,329 @@
+#include "client/async_connection.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <memory>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Redis {
+
+static void append_command(std::string &out,
+                           const std::vector<std::string> &args) {
+  out += "*" + std::to_string(args.size()) + "\r\n";
+  for (const auto &arg : args) {
+    out += "$" + std::to_string(arg.size()) + "\r\n";
+    out += arg;
+    out += "\r\n";
+  }
+}
+
+// Non-blocking connect bounded by timeout. Returns false with errno set.
+static bool connect_within(int fd, const sockaddr_in &addr,
+                           std::chrono::milliseconds timeout) {
+  if (connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) ==
+      0)
+    return true;
+  if (errno != EINPROGRESS)
+    return false;
+
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  pollfd pfd{.fd = fd, .events = POLLOUT, .revents = 0};
+  for (;;) {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (left.count() <= 0) {
+      errno = ETIMEDOUT;
+      return false;
+    }
+    int ready = poll(&pfd, 1, static_cast<int>(left.count()));
+    if (ready > 0)
+      break;
+    if (ready < 0 && errno != EINTR)
+      return false;
+  }
+
+  int err = 0;
+  socklen_t len = sizeof(err);
+  if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+    return false;
+  errno = err;
+  return err == 0;
+}
+
+AsyncConnection::AsyncConnection(const std::string &address, int port,
+                                 std::chrono::milliseconds connect_timeout)
+    : sock_fd_(-1), wake_fd_(-1), running_(false),
+      destroyed_(std::make_shared<std::atomic<bool>>(false)) {
+  sock_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (sock_fd_ < 0)
+    throw std::runtime_error("Socket creation failed");
+
+  sockaddr_in server_addr{};
+  server_addr.sin_family = AF_INET;
+  server_addr.sin_port = htons(port);
+
+  if (inet_pton(AF_INET, address.c_str(), &server_addr.sin_addr) <= 0) {
+    ::close(sock_fd_);
+    throw std::runtime_error("Invalid address/ Address not supported");
+  }
+
+  fcntl(sock_fd_, F_SETFL, fcntl(sock_fd_, F_GETFL, 0) | O_NONBLOCK);
+  if (!connect_within(sock_fd_, server_addr, connect_timeout)) {
+    bool timed_out = errno == ETIMEDOUT;
+    ::close(sock_fd_);
+    throw std::runtime_error(timed_out ? "Connection timed out (Client)"
+                                       : "Connection Failed (Client)");
+  }
+
+  configure_socket_safety(sock_fd_);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK);
+
+  running_ = true;
+  io_thread_ = std::thread(&AsyncConnection::io_loop, this);
+}
+
+AsyncConnection::~AsyncConnection() {
+  close();
+  if (io_thread_.get_id() == std::this_thread::get_id()) {
+    // Released by one of its own callbacks: a thread cannot join itself.
+    *destroyed_ = true;
+    io_thread_.detach();
+    fail_pending();
+  } else if (io_thread_.joinable()) {
+    io_thread_.join();
+  }
+  if (sock_fd_ >= 0)
+    ::close(sock_fd_);
+  if (wake_fd_ >= 0)
+    ::close(wake_fd_);
+}
+
+void AsyncConnection::close() {
+  running_ = false;
+  wake();
+}
+
+void AsyncConnection::wake() {
+  u64 one = 1;
+  (void)!write(wake_fd_, &one, sizeof(one));
+}
+
+void AsyncConnection::enqueue(
+    const std::vector<std::vector<std::string>> &commands,
+    std::vector<Callback> callbacks) {
+  bool was_idle;
+  {
+    // Bytes and callbacks go in under one lock so replies stay in order.
+    std::lock_guard lock(mtx_);
+    if (!running_)
+      throw std::runtime_error("Connection is closed");
+    was_idle = out_.empty();
+    for (size_t i = 0; i < commands.size(); i++) {
+      append_command(out_, commands[i]);
+      pending_.push_back(std::move(callbacks[i]));
+    }
+  }
+  if (was_idle)
+    wake();
+}
+
+void AsyncConnection::command(const std::vector<std::string> &args,
+                              Callback cb) {
+  enqueue({args}, {std::move(cb)});
+}
+
+std::future<RESP>
+AsyncConnection::command(const std::vector<std::string> &args) {
+  auto promise = std::make_shared<std::promise<RESP>>();
+  auto future = promise->get_future();
+  command(args, [promise](const RESP &r) { promise->set_value(r); });
+  return future;
+}
+
+RESP AsyncConnection::command_sync(const std::vector<std::string> &args) {
+  return command(args).get();
+}
+
+std::vector<std::future<RESP>> AsyncConnection::pipeline(
+    const std::vector<std::vector<std::string>> &commands) {
+  std::vector<std::future<RESP>> futures;
+  std::vector<Callback> callbacks;
+  futures.reserve(commands.size());
+  callbacks.reserve(commands.size());
+  for (size_t i = 0; i < commands.size(); i++) {
+    auto promise = std::make_shared<std::promise<RESP>>();
+    futures.push_back(promise->get_future());
+    callbacks.push_back([promise](const RESP &r) { promise->set_value(r); });
+  }
+  enqueue(commands, std::move(callbacks));
+  return futures;
+}
+
+std::future<std::vector<std::optional<std::string>>>
+AsyncConnection::mget(const std::vector<std::string> &keys) {
+  struct Batch {
+    std::promise<std::vector<std::optional<std::string>>> promise;
+    std::vector<std::optional<std::string>> values;
+    size_t remaining;
+  };
+  auto batch = std::make_shared<Batch>();
+  batch->values.resize(keys.size());
+  batch->remaining = keys.size();
+  auto future = batch->promise.get_future();
+  if (keys.empty()) {
+    batch->promise.set_value({});
+    return future;
+  }
+
+  // Callbacks all run on the I/O thread, so the counter needs no lock.
+  std::vector<std::vector<std::string>> commands;
+  std::vector<Callback> callbacks;
+  for (size_t i = 0; i < keys.size(); i++) {
+    commands.push_back({"GET", keys[i]});
+    callbacks.push_back([batch, i](const RESP &r) {
+      if (r.resp_type == RESP::type::BULK_STRING && !r.is_null)
+        batch->values[i] = r.str;
+      if (--batch->remaining == 0)
+        batch->promise.set_value(std::move(batch->values));
+    });
+  }
+  enqueue(commands, std::move(callbacks));
+  return future;
+}
+
+std::future<bool> AsyncConnection::mset(
+    const std::vector<std::pair<std::string, std::string>> &pairs) {
+  struct Batch {
+    std::promise<bool> promise;
+    bool ok = true;
+    size_t remaining;
+  };
+  auto batch = std::make_shared<Batch>();
+  batch->remaining = pairs.size();
+  auto future = batch->promise.get_future();
+  if (pairs.empty()) {
+    batch->promise.set_value(true);
+    return future;
+  }
+
+  std::vector<std::vector<std::string>> commands;
+  std::vector<Callback> callbacks;
+  for (const auto &[key, value] : pairs) {
+    commands.push_back({"SET", key, value});
+    callbacks.push_back([batch](const RESP &r) {
+      if (r.resp_type == RESP::type::ERROR)
+        batch->ok = false;
+      if (--batch->remaining == 0)
+        batch->promise.set_value(batch->ok);
+    });
+  }
+  enqueue(commands, std::move(callbacks));
+  return future;
+}
+
+void AsyncConnection::set_push_handler(Callback handler) {
+  std::lock_guard lock(mtx_);
+  push_handler_ = std::move(handler);
+}
+
+void AsyncConnection::fail_pending() {
+  std::deque<Callback> failed;
+  Callback on_push;
+  {
+    std::lock_guard lock(mtx_);
+    failed.swap(pending_);
+    out_.clear();
+    on_push = push_handler_;
+  }
+  RESP err{.resp_type = RESP::type::ERROR, .str = "ERR connection lost"};
+  for (auto &cb : failed) {
+    cb(err);
+  }
+  if (on_push)
+    on_push(RESP{.resp_type = RESP::type::PUSH});
+}
+
+void AsyncConnection::io_loop() {
+  std::shared_ptr<std::atomic<bool>> destroyed = destroyed_;
+  std::string writing;
+  size_t written = 0;
+  char buffer[16384];
+
+  while (running_) {
+    if (written == writing.size()) {
+      writing.clear();
+      written = 0;
+      std::lock_guard lock(mtx_);
+      writing.swap(out_);
+    }
+
+    pollfd fds[2] = {
+        {.fd = sock_fd_,
+         .events = static_cast<short>(POLLIN |
+                                      (written < writing.size() ? POLLOUT : 0)),
+         .revents = 0},
+        {.fd = wake_fd_, .events = POLLIN, .revents = 0},
+    };
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      u64 counter;
+      (void)!read(wake_fd_, &counter, sizeof(counter));
+    }
+
+    if (fds[0].revents & POLLOUT) {
+      ssize_t n = send(sock_fd_, writing.data() + written,
+                       writing.size() - written, MSG_NOSIGNAL);
+      if (n < 0 && errno != EAGAIN && errno != EINTR)
+        break;
+      if (n > 0)
+        written += static_cast<size_t>(n);
+    }
+
+    if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+      ssize_t n = recv(sock_fd_, buffer, sizeof(buffer), 0);
+      if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+        break;
+      if (n > 0)
+        parser_.feed(buffer, static_cast<size_t>(n));
+
+      try {
+        while (auto reply = parser_.next()) {
+          Callback cb;
+          {
+            std::lock_guard lock(mtx_);
+            if (reply->resp_type == RESP::type::PUSH) {
+              cb = push_handler_;
+            } else if (!pending_.empty()) {
+              cb = std::move(pending_.front());
+              pending_.pop_front();
+            }
+          }
+          if (cb)
+            cb(*reply);
+          if (*destroyed)
+            return;
+        }
+      } catch (const std::exception &) {
+        break;
+      }
+    }
+  }
+
+  {
+    std::lock_guard lock(mtx_);
+    running_ = false;
+  }
+  fail_pending();
+}
+
+} // namespace Redis
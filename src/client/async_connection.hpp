@@ -0,0 +1,88 @@
+#pragma once
+#include "client/reply_parser.hpp"
+#include "common/types.hpp"
+#include "util/RESP.hpp"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Redis {
+
+// One non-blocking connection served by its own I/O thread. Commands issued
+// from any thread are appended to a shared write buffer and flushed together,
+// so concurrent callers are pipelined automatically. Replies are matched to
+// requests in FIFO order; push frames bypass the queue. If the connection
+// drops, outstanding requests get an "ERR connection lost" reply.
+class AsyncConnection {
+public:
+  using Callback = std::function<void(const RESP &)>;
+
+  static constexpr std::chrono::milliseconds DEFAULT_CONNECT_TIMEOUT{5000};
+
+  // Throws if the server cannot be reached within connect_timeout.
+  AsyncConnection(const std::string &address, int port,
+                  std::chrono::milliseconds connect_timeout =
+                      DEFAULT_CONNECT_TIMEOUT);
+  // May run inside one of this connection's callbacks; the I/O thread is
+  // then detached instead of joined.
+  ~AsyncConnection();
+
+  AsyncConnection(const AsyncConnection &) = delete;
+  AsyncConnection &operator=(const AsyncConnection &) = delete;
+
+  // The callback runs on the I/O thread and must not block.
+  void command(const std::vector<std::string> &args, Callback cb);
+  std::future<RESP> command(const std::vector<std::string> &args);
+  RESP command_sync(const std::vector<std::string> &args);
+
+  // Sends all commands in one write; futures are in the same order.
+  std::vector<std::future<RESP>>
+  pipeline(const std::vector<std::vector<std::string>> &commands);
+
+  // Batch helpers, pipelined as one write.
+  std::future<std::vector<std::optional<std::string>>>
+  mget(const std::vector<std::string> &keys);
+  std::future<bool>
+  mset(const std::vector<std::pair<std::string, std::string>> &pairs);
+
+  // Receives RESP3 push frames (tracking invalidations) instead of the
+  // pending-reply queue. Runs on the I/O thread and must not block. The
+  // handler is also called with an empty PUSH when the connection is lost.
+  void set_push_handler(Callback handler);
+
+  bool connected() const { return running_; }
+  void close();
+
+private:
+  void enqueue(const std::vector<std::vector<std::string>> &commands,
+               std::vector<Callback> callbacks);
+  void io_loop();
+  void wake();
+  void fail_pending();
+
+  int sock_fd_;
+  int wake_fd_;
+  std::atomic<bool> running_;
+  std::thread io_thread_;
+  // Set when the destructor runs on the I/O thread, which then returns
+  // without touching the object again. io_loop keeps its own reference.
+  std::shared_ptr<std::atomic<bool>> destroyed_;
+
+  std::mutex mtx_;
+  std::string out_;
+  std::deque<Callback> pending_;
+  Callback push_handler_;
+
+  ReplyParser parser_;
+};
+
+} // namespace Redis
@@ -0,0 +1,125 @@
+#include "client/client_cache.hpp"
+#include <stdexcept>
+
+namespace Redis {
+
+ClientCache::ClientCache(const std::string &address, int port,
+                         size_t max_entries, bool bcast,
+                         std::vector<std::string> prefixes)
+    : max_entries_(max_entries),
+      conn_(std::make_unique<AsyncConnection>(address, port)) {
+  conn_->set_push_handler([this](const RESP &push) { on_push(push); });
+
+  std::vector<std::string> args = {"CLIENT", "TRACKING", "ON"};
+  if (bcast) {
+    args.push_back("BCAST");
+    for (auto &prefix : prefixes) {
+      args.push_back("PREFIX");
+      args.push_back(std::move(prefix));
+    }
+  }
+  RESP r = conn_->command_sync(args);
+  if (r.resp_type == RESP::type::ERROR)
+    throw std::runtime_error(r.str);
+}
+
+std::optional<std::string> ClientCache::get(const std::string &key) {
+  {
+    std::lock_guard lock(mtx_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second.lru);
+      hits_++;
+      return it->second.value;
+    }
+    in_flight_[key].readers++;
+  }
+  misses_++;
+
+  RESP r;
+  try {
+    r = conn_->command_sync({"GET", key});
+  } catch (...) {
+    std::lock_guard lock(mtx_);
+    if (--in_flight_[key].readers == 0)
+      in_flight_.erase(key);
+    throw;
+  }
+
+  bool cacheable = r.resp_type == RESP::type::BULK_STRING;
+  std::optional<std::string> value;
+  if (cacheable && !r.is_null)
+    value = std::move(r.str);
+
+  std::lock_guard lock(mtx_);
+  auto it = in_flight_.find(key);
+  cacheable = cacheable && !it->second.invalidated && conn_->connected();
+  if (--it->second.readers == 0)
+    in_flight_.erase(it);
+  if (cacheable)
+    insert_locked(key, value);
+  return value;
+}
+
+void ClientCache::clear() {
+  std::lock_guard lock(mtx_);
+  flush_locked();
+}
+
+size_t ClientCache::size() const {
+  std::lock_guard lock(mtx_);
+  return entries_.size();
+}
+
+// Runs on the connection's I/O thread.
+void ClientCache::on_push(const RESP &push) {
+  std::lock_guard lock(mtx_);
+  bool is_invalidate = push.elements.size() == 2 &&
+                       push.elements[0].str == "invalidate";
+  // A nil key list (server dropped our tracking entry) or a lost connection
+  // means anything may have changed.
+  if (!is_invalidate || push.elements[1].is_null) {
+    flush_locked();
+    invalidations_++;
+    return;
+  }
+
+  for (const auto &key : push.elements[1].elements) {
+    auto it = entries_.find(key.str);
+    if (it != entries_.end()) {
+      lru_.erase(it->second.lru);
+      entries_.erase(it);
+    }
+    auto pending = in_flight_.find(key.str);
+    if (pending != in_flight_.end())
+      pending->second.invalidated = true;
+    invalidations_++;
+  }
+}
+
+void ClientCache::insert_locked(const std::string &key,
+                                std::optional<std::string> value) {
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    it->second.value = std::move(value);
+    lru_.splice(lru_.begin(), lru_, it->second.lru);
+    return;
+  }
+  if (max_entries_ == 0)
+    return;
+  while (entries_.size() >= max_entries_) {
+    entries_.erase(lru_.back());
+    lru_.pop_back();
+  }
+  lru_.push_front(key);
+  entries_.emplace(key, Entry{std::move(value), lru_.begin()});
+}
+
+void ClientCache::flush_locked() {
+  entries_.clear();
+  lru_.clear();
+  for (auto &[key, pending] : in_flight_)
+    pending.invalidated = true;
+}
+
+} // namespace Redis
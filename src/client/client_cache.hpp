@@ -0,0 +1,65 @@
+#pragma once
+#include "client/async_connection.hpp"
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Redis {
+
+// In-process GET cache kept coherent by server-assisted invalidation (CLIENT
+// TRACKING). Hits never leave the process; misses are fetched over a
+// dedicated tracking connection and cached, nil results included. A key
+// invalidated while its GET is still in flight is not cached, so a late reply
+// cannot resurrect a value the server has already replaced. If the
+// connection drops the whole cache is flushed.
+class ClientCache {
+public:
+  // With bcast, the server announces every write under prefixes (all keys if
+  // none) instead of remembering what this connection read.
+  ClientCache(const std::string &address, int port, size_t max_entries = 10000,
+              bool bcast = false, std::vector<std::string> prefixes = {});
+
+  std::optional<std::string> get(const std::string &key);
+  void clear();
+
+  // The tracking connection, for writes that should not go to the cache.
+  AsyncConnection &connection() { return *conn_; }
+
+  size_t size() const;
+  u64 hits() const { return hits_.load(); }
+  u64 misses() const { return misses_.load(); }
+  u64 invalidations() const { return invalidations_.load(); }
+
+private:
+  struct Entry {
+    std::optional<std::string> value;
+    std::list<std::string>::iterator lru;
+  };
+  struct InFlight {
+    int readers = 0;
+    bool invalidated = false;
+  };
+
+  void on_push(const RESP &push);
+  void insert_locked(const std::string &key, std::optional<std::string> value);
+  void flush_locked();
+
+  size_t max_entries_;
+  mutable std::mutex mtx_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::list<std::string> lru_; // most recently used first
+  std::unordered_map<std::string, InFlight> in_flight_;
+
+  std::atomic<u64> hits_{0};
+  std::atomic<u64> misses_{0};
+  std::atomic<u64> invalidations_{0};
+
+  std::unique_ptr<AsyncConnection> conn_;
+};
+
+} // namespace Redis
@@ -0,0 +1,29 @@
+#include "client/connection_pool.hpp"
+#include <stdexcept>
+
+namespace Redis {
+
+ConnectionPool::ConnectionPool(const std::string &address, int port,
+                               size_t size)
+    : address_(address), port_(port) {
+  if (size == 0)
+    throw std::runtime_error("Connection pool size must be positive");
+  connections_.reserve(size);
+  for (size_t i = 0; i < size; i++) {
+    connections_.push_back(std::make_shared<AsyncConnection>(address, port));
+  }
+}
+
+// Dropped connections are replaced lazily when they come up in rotation.
+// Callers keep their own reference, so a replaced connection stays alive
+// until its last in-flight user lets go.
+std::shared_ptr<AsyncConnection> ConnectionPool::next() {
+  std::lock_guard lock(mtx_);
+  auto &conn = connections_[cursor_++ % connections_.size()];
+  if (!conn->connected()) {
+    conn = std::make_shared<AsyncConnection>(address_, port_);
+  }
+  return conn;
+}
+
+} // namespace Redis
@@ -0,0 +1,41 @@
+#pragma once
+#include "client/async_connection.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Redis {
+
+// Fixed set of AsyncConnections handed out round-robin. Each connection
+// already pipelines its callers, so a handful is enough to spread load over
+// server threads.
+class ConnectionPool {
+public:
+  ConnectionPool(const std::string &address, int port, size_t size);
+
+  std::shared_ptr<AsyncConnection> next();
+
+  std::future<RESP> command(const std::vector<std::string> &args) {
+    return next()->command(args);
+  }
+  std::future<std::vector<std::optional<std::string>>>
+  mget(const std::vector<std::string> &keys) {
+    return next()->mget(keys);
+  }
+  std::future<bool>
+  mset(const std::vector<std::pair<std::string, std::string>> &pairs) {
+    return next()->mset(pairs);
+  }
+
+  size_t size() const { return connections_.size(); }
+
+private:
+  std::string address_;
+  int port_;
+  std::mutex mtx_;
+  std::vector<std::shared_ptr<AsyncConnection>> connections_;
+  size_t cursor_ = 0;
+};
+
+} // namespace Redis
@@ -0,0 +1,160 @@
+#include "client/reply_parser.hpp"
+#include "util/simd_scan.hpp"
+#include <stdexcept>
+
+namespace Redis {
+
+static constexpr size_t COMPACT_THRESHOLD = 64 * 1024;
+
+// Parses the decimal after a type prefix up to CRLF. Returns false when the
+// line is not complete yet.
+static bool read_header(std::string_view buf, size_t pos, long long &value,
+                        size_t &header_len) {
+  size_t eol = find_crlf(buf.data() + pos, buf.size() - pos);
+  if (eol == std::string_view::npos) {
+    return false;
+  }
+  if (!parse_int_fast(buf.data() + pos + 1, eol - 1, value)) {
+    throw std::runtime_error("Invalid number format");
+  }
+  header_len = eol + 2;
+  return true;
+}
+
+size_t ReplyParser::frame_length(std::string_view buf, size_t pos, int depth) {
+  if (depth > MAX_RESP_DEPTH) {
+    throw std::runtime_error("RESP nesting depth exceeded");
+  }
+  if (pos >= buf.size()) {
+    return 0;
+  }
+
+  switch (buf[pos]) {
+  case '+':
+  case '-':
+  case ':': {
+    size_t eol = find_crlf(buf.data() + pos, buf.size() - pos);
+    return eol == std::string_view::npos ? 0 : eol + 2;
+  }
+  case '$': {
+    long long len;
+    size_t header;
+    if (!read_header(buf, pos, len, header)) {
+      return 0;
+    }
+    if (len < 0) {
+      return header;
+    }
+    if (len > MAX_BULK_LEN) {
+      throw std::runtime_error("Invalid bulk string length");
+    }
+    size_t total = header + static_cast<size_t>(len) + 2;
+    return pos + total <= buf.size() ? total : 0;
+  }
+  case '*':
+  case '>': {
+    long long count;
+    size_t total;
+    if (!read_header(buf, pos, count, total)) {
+      return 0;
+    }
+    for (long long i = 0; i < count; i++) {
+      size_t n = frame_length(buf, pos + total, depth + 1);
+      if (n == 0) {
+        return 0;
+      }
+      total += n;
+    }
+    return total;
+  }
+  default:
+    throw std::runtime_error("Unsupported RESP type");
+  }
+}
+
+void ReplyParser::feed(const char *data, size_t len) { buf_.append(data, len); }
+
+// frame_length() without the restart: advances scan_ element by element and
+// returns true once the frame at pos_ ends there. An incomplete element is
+// retried from its header on the next call.
+bool ReplyParser::scan_frame() {
+  std::string_view buf = buf_;
+  for (;;) {
+    if (open_.size() > static_cast<size_t>(MAX_RESP_DEPTH)) {
+      throw std::runtime_error("RESP nesting depth exceeded");
+    }
+    if (scan_ >= buf.size()) {
+      return false;
+    }
+
+    switch (buf[scan_]) {
+    case '+':
+    case '-':
+    case ':': {
+      size_t eol = find_crlf(buf.data() + scan_, buf.size() - scan_);
+      if (eol == std::string_view::npos) {
+        return false;
+      }
+      scan_ += eol + 2;
+      break;
+    }
+    case '$': {
+      long long len;
+      size_t header;
+      if (!read_header(buf, scan_, len, header)) {
+        return false;
+      }
+      if (len > MAX_BULK_LEN) {
+        throw std::runtime_error("Invalid bulk string length");
+      }
+      size_t total = header + (len < 0 ? 0 : static_cast<size_t>(len) + 2);
+      if (scan_ + total > buf.size()) {
+        return false;
+      }
+      scan_ += total;
+      break;
+    }
+    case '*':
+    case '>': {
+      long long count;
+      size_t header;
+      if (!read_header(buf, scan_, count, header)) {
+        return false;
+      }
+      scan_ += header;
+      if (count > 0) {
+        open_.push_back(count);
+        continue;
+      }
+      break;
+    }
+    default:
+      throw std::runtime_error("Unsupported RESP type");
+    }
+
+    // An element ended; so does every aggregate it was the last one of.
+    while (!open_.empty() && --open_.back() == 0) {
+      open_.pop_back();
+    }
+    if (open_.empty()) {
+      return true;
+    }
+  }
+}
+
+std::optional<RESP> ReplyParser::next() {
+  if (!scan_frame()) {
+    if (pos_ == buf_.size()) {
+      buf_.clear();
+      pos_ = scan_ = 0;
+    } else if (pos_ > COMPACT_THRESHOLD) {
+      buf_.erase(0, pos_);
+      scan_ -= pos_;
+      pos_ = 0;
+    }
+    return std::nullopt;
+  }
+  return parse_RESP(buf_, pos_);
+}
+
+} // namespace Redis
@@ -0,0 +1,38 @@
+#pragma once
+#include "util/RESP.hpp"
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Redis {
+
+// Incremental reply parser: bytes are fed as they arrive from the socket and
+// complete replies are handed out in order. A reply split across reads stays
+// buffered until its last byte shows up; binary payloads (NULs) are kept.
+class ReplyParser {
+public:
+  void feed(const char *data, size_t len);
+  std::optional<RESP> next();
+
+  size_t buffered() const { return buf_.size() - pos_; }
+
+  // Length of the complete frame starting at pos, or 0 if more bytes are
+  // needed. Walks headers only; bulk payloads are skipped, never copied.
+  // Throws std::runtime_error on malformed input.
+  static size_t frame_length(std::string_view buf, size_t pos, int depth = 0);
+
+private:
+  bool scan_frame();
+
+  std::string buf_;
+  size_t pos_ = 0;
+  // How far the frame at pos_ has been checked: scan_ is where its next
+  // unchecked element starts and open_ holds, per enclosing aggregate, how
+  // many elements are still to come. Kept across feed() calls, so a reply
+  // arriving in many reads is walked once, not from its start on each read.
+  size_t scan_ = 0;
+  std::vector<long long> open_;
+};
+
+} // namespace Redis
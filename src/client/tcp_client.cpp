@@ -1,103 +1,149 @@
 #include "../client/tcp_client.hpp"
 #include "util/RESP.hpp"
-#include <arpa/inet.h>
-#include <atomic>
 #include <cstring>
+#include <format>
 #include <iostream>
-#include <mutex>
-#include <netinet/in.h>
-#include <sys/socket.h>
-#include <thread>
-#include <unistd.h>
-
-std::atomic<bool> running_{true};
-std::mutex cout_mutex;
-
-TCPClient::TCPClient() : sock_fd(-1) {}
+#include <string>
 
 void TCPClient::connect_to_server(const std::string &address, int port) {
-  sock_fd = socket(AF_INET, SOCK_STREAM, 0);
-  if (sock_fd < 0)
-    throw std::runtime_error("Socket creation failed");
-
-  sockaddr_in server_addr{};
-  server_addr.sin_family = AF_INET;
-  server_addr.sin_port = htons(port);
-
-  if (inet_pton(AF_INET, address.c_str(), &server_addr.sin_addr) <= 0)
-    throw std::runtime_error("Invalid address/ Address not supported");
-
-  if (connect(sock_fd, reinterpret_cast<sockaddr *>(&server_addr),
-              sizeof(server_addr)) < 0)
-    throw std::runtime_error("Connection Failed (Client)");
-
-  {
-    std::lock_guard<std::mutex> lock(cout_mutex);
-    std::cout << "Connecting to " << address << " on port " << port << "\n";
-  }
-
-  std::thread client_loop(&TCPClient::read_from_server, this, sock_fd);
-  client_loop.detach();
+  conn_ = std::make_unique<Redis::AsyncConnection>(address, port);
+  conn_->set_push_handler([this](const RESP &push) {
+    // An empty frame only reports a lost connection.
+    if (push.elements.empty())
+      return;
+    std::lock_guard lock(print_mtx_);
+    if (at_prompt_)
+      std::cout << '\n';
+    print_reply(push);
+    if (at_prompt_)
+      std::cout << "$ redis-cli: " << std::flush;
+  });
+  std::cout << "Connecting to " << address << " on port " << port << "\n";
 
-  while (running_) {
+  while (conn_->connected()) {
     {
-      std::lock_guard<std::mutex> lock(cout_mutex);
+      std::lock_guard lock(print_mtx_);
       std::cout << "$ redis-cli: " << std::flush;
+      at_prompt_ = true;
     }
 
     std::string input;
-    std::getline(std::cin, input);
-
-    if (input == "exit") {
-      running_ = false;
-      shutdown(sock_fd, SHUT_RDWR);
-      break;
+    bool done = !std::getline(std::cin, input) || input == "exit";
+    {
+      std::lock_guard lock(print_mtx_);
+      at_prompt_ = false;
     }
-
-    RESP r = convert_inline_to_RESP(input);
-    std::string msg = serialize_RESP(r);
-
-    if (!robust_send(sock_fd, msg.c_str(), msg.size()))
-      throw std::runtime_error("Failed to send data to server");
+    if (done)
+      break;
+    if (input.empty())
+      continue;
+
+    std::vector<std::string> tokens =
+        RESP_to_tokens(convert_inline_to_RESP(input));
+    RESP reply = conn_->command_sync(tokens);
+    std::lock_guard lock(print_mtx_);
+    print_reply(reply);
   }
+  conn_->close();
 }
 
-void TCPClient::read_from_server(int sock_fd) {
-  char buffer[4096];
-  while (running_) {
-    ssize_t bytes_read = recv(sock_fd, buffer, sizeof(buffer) - 1, 0);
-    if (bytes_read <= 0) {
-      running_ = false;
-      break;
-    }
+// Unlike redis-cli, which SCANs the whole keyspace from the client, this asks
+// the server for what its background sampler has already found.
+int TCPClient::report_keys(const std::string &address, int port, bool big) {
+  conn_ = std::make_unique<Redis::AsyncConnection>(address, port);
+  bool ok = big ? print_key_table("MEMORY", "bytes (estimated)") &&
+                      print_key_table("ELEMENTS", "length")
+                : print_key_table("FREQ", "LFU counter");
+  conn_->close();
+  return ok ? 0 : 1;
+}
 
-    buffer[bytes_read] = '\0';
-    std::string data(buffer);
-    size_t pos = 0;
+bool TCPClient::print_key_table(const std::string &metric,
+                                const std::string &label) {
+  RESP reply = conn_->command_sync({"HOTKEYS", metric, "COUNT", "16"});
+  if (reply.resp_type != RESP::type::ARRAY) {
+    std::cerr << "Error: "
+              << (reply.resp_type == RESP::type::ERROR ? reply.str
+                                                       : "unexpected reply")
+              << "\n";
+    return false;
+  }
 
-    try {
-      while (pos < data.size()) {
-        RESP r = parse_RESP(data, pos);
+  std::cout << std::format("# Top keys by {}\n", label);
+  if (reply.elements.empty())
+    std::cout << "(no keys sampled yet)\n";
+  for (const RESP &entry : reply.elements) {
+    if (entry.elements.size() != 3)
+      continue;
+    std::cout << std::format("{:>12}  {:<6} {}\n", entry.elements[2].integer,
+                             entry.elements[1].str, entry.elements[0].str);
+  }
+  return true;
+}
 
-        std::lock_guard<std::mutex> lock(cout_mutex);
-        std::cout << "\r\033[K";
-        print_RESP(r);
-        std::cout << "$ redis-cli: " << std::flush;
-      }
-    } catch (...) {
+void TCPClient::print_reply(const RESP &reply, const std::string &indent) {
+  switch (reply.resp_type) {
+  case RESP::type::ERROR:
+    std::cout << "(error) " << reply.str << '\n';
+    break;
+  case RESP::type::INTEGER:
+    std::cout << "(integer) " << reply.integer << '\n';
+    break;
+  case RESP::type::SIMPLE_STRING:
+    std::cout << reply.str << '\n';
+    break;
+  case RESP::type::BULK_STRING:
+    if (reply.is_null)
+      std::cout << "(nil)\n";
+    else
+      std::cout << '"' << reply.str << "\"\n";
+    break;
+  case RESP::type::ARRAY:
+    if (reply.is_null || reply.elements.empty()) {
+      std::cout << "(empty array)\n";
       break;
     }
+    for (size_t i = 0; i < reply.elements.size(); i++) {
+      // The first line continues the parent's "n) " prefix.
+      std::cout << (i == 0 ? "" : indent) << i + 1 << ") ";
+      print_reply(reply.elements[i], indent + "   ");
+    }
+    break;
+  case RESP::type::PUSH:
+    // Out-of-band (invalidation) frames: a header line, then the array.
+    std::cout << "(push)\n";
+    for (size_t i = 0; i < reply.elements.size(); i++) {
+      std::cout << indent << i + 1 << ") ";
+      print_reply(reply.elements[i], indent + "   ");
+    }
+    break;
   }
-  close(sock_fd);
-  running_ = false;
 }
 
-int main() {
+int main(int argc, char **argv) {
   TCPClient client;
-  int port = 6379;
-  std::string address = "0.0.0.0";
+  std::vector<std::string> positional;
+  bool hotkeys = false, bigkeys = false;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--hotkeys") == 0)
+      hotkeys = true;
+    else if (std::strcmp(argv[i], "--bigkeys") == 0)
+      bigkeys = true;
+    else
+      positional.emplace_back(argv[i]);
+  }
+  std::string address = positional.size() > 0 ? positional[0] : "127.0.0.1";
+  int port = positional.size() > 1 ? std::stoi(positional[1]) : 6379;
 
   try {
+    if (hotkeys || bigkeys) {
+      int status = 0;
+      if (hotkeys)
+        status |= client.report_keys(address, port, false);
+      if (bigkeys)
+        status |= client.report_keys(address, port, true);
+      return status;
+    }
     client.connect_to_server(address, port);
   } catch (const std::exception &e) {
     std::cerr << "Error: " << e.what() << "\n";
@@ -105,4 +151,4 @@ int main() {
   }
 
   return 0;
-}
\ No newline at end of file
+}
@@ -1,14 +1,25 @@
 #pragma once
+#include "client/async_connection.hpp"
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
-
+// Interactive CLI on top of AsyncConnection: one inline command per line.
 class TCPClient {
 public:
-  TCPClient();
-  void connect_to_server(const std::string &address, int port); 
-  void read_from_server(int sock_fd);
+  void connect_to_server(const std::string &address, int port);
+  // Non-interactive --hotkeys / --bigkeys: prints the server's HOTKEYS
+  // boards and returns the process exit status.
+  int report_keys(const std::string &address, int port, bool big);
+
 private:
-  int running_;
-  int sock_fd;
-};
\ No newline at end of file
+  void print_reply(const RESP &reply, const std::string &indent = "");
+  bool print_key_table(const std::string &metric, const std::string &label);
+
+  std::unique_ptr<Redis::AsyncConnection> conn_;
+  // Push frames (CLIENT TRACKING invalidations) are printed from the
+  // connection's I/O thread, so output goes through this lock.
+  std::mutex print_mtx_;
+  bool at_prompt_ = false;
+};
@@ -1,5 +1,15 @@
 #include "concurrent_store.hpp"
+#include "common/keyslot.hpp"
 #include "common/types.hpp"
+#include "util/simd_scan.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <mutex>
 
 namespace Redis {
@@ -9,71 +19,850 @@ static i64 get_now_ms() {
       .count();
 }
 
-void ConcurrentStore::set(const std::string &key, Value v, i64 ttl_ms) {
-  std::unique_lock lock(mtx_);
-  
-  if (ttl_ms > 0) {
-    v.expires_at = get_now_ms() + ttl_ms;
-    expiry_index_[key] = v.expires_at;
+// Set while this thread holds a KeyLock: the store it belongs to, the shards
+// it covers, and the notifications deferred until it is released.
+static thread_local const ConcurrentStore *t_key_lock_store = nullptr;
+static thread_local u32 t_key_lock_shards = 0;
+static thread_local std::vector<std::string> t_deferred_notify;
+
+// Redis' LFU defaults: lfu-log-factor 10 and lfu-decay-time 1. New keys
+// start at 5 so that they are not the coldest the moment they are written.
+static constexpr u8 LFU_INIT_VAL = 5;
+static constexpr u32 LFU_LOG_FACTOR = 10;
+static constexpr u32 LFU_DECAY_MINUTES = 1;
+static constexpr int LFU_COUNTER_SHIFT = Value::VERSION_BITS;
+static constexpr int LFU_TIME_SHIFT = Value::VERSION_BITS + 8;
+// Buckets of a shard resize moved per expiry cycle, on top of the one every
+// write moves, so that shards nobody writes to still finish resizing.
+static constexpr size_t REHASH_BUCKETS_PER_CYCLE = 1000;
+
+static u64 pack_meta(u64 version, u8 counter, u16 minutes) {
+  return version | (u64{counter} << LFU_COUNTER_SHIFT) |
+         (u64{minutes} << LFU_TIME_SHIFT);
+}
+
+// The counter minus one per decay period since it was last touched; the
+// 16-bit minute clock wraps like Redis' does.
+static u8 lfu_decayed(u64 meta, u16 now) {
+  u8 counter = static_cast<u8>(meta >> LFU_COUNTER_SHIFT);
+  u16 last = static_cast<u16>(meta >> LFU_TIME_SHIFT);
+  u16 elapsed = static_cast<u16>(now - last);
+  u32 periods = elapsed / LFU_DECAY_MINUTES;
+  return periods >= counter ? 0 : static_cast<u8>(counter - periods);
+}
+
+// Logarithmic increment: bumps with probability 1 / ((c - init) * factor + 1),
+// so 255 stands for about a million hits.
+static u8 lfu_log_incr(u8 counter) {
+  if (counter == 255) {
+    return counter;
+  }
+  u32 base = counter > LFU_INIT_VAL ? counter - LFU_INIT_VAL : 0;
+  if (base == 0) {
+    return counter + 1;
+  }
+  static thread_local u64 rng = 0x9E3779B97F4A7C15ULL;
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return rng % (base * LFU_LOG_FACTOR + 1) == 0 ? counter + 1 : counter;
+}
+
+static u16 lfu_clock() { return static_cast<u16>(get_now_ms() / 60000); }
+
+bool parse_canonical_int(std::string_view s, i64 &out) {
+  long long v;
+  if (!parse_int_fast(s.data(), s.size(), v)) {
+    return false;
+  }
+  // Only forms that print back identically, so GET returns the bytes SET
+  // stored: no "-0", no leading zeros.
+  size_t first = s[0] == '-' ? 1 : 0;
+  if (s[first] == '0' && s.size() > 1) {
+    return false;
+  }
+  out = v;
+  return true;
+}
+
+RedisData encode_string(std::string s) {
+  i64 v;
+  if (parse_canonical_int(s, v)) {
+    return v;
+  }
+  return s;
+}
+
+// Redis' INCRBYFLOAT reply format: fixed notation with 17 digits, trailing
+// zeros stripped.
+static std::string format_long_double(long double v) {
+  char buf[5 * 1024];
+  int len = std::snprintf(buf, sizeof(buf), "%.17Lf", v);
+  if (len <= 0 || static_cast<size_t>(len) >= sizeof(buf)) {
+    return {};
+  }
+  std::string out(buf, len);
+  if (out.find('.') != std::string::npos) {
+    while (out.back() == '0') {
+      out.pop_back();
+    }
+    if (out.back() == '.') {
+      out.pop_back();
+    }
+  }
+  if (out == "-0") {
+    out = "0";
+  }
+  return out;
+}
+
+bool parse_long_double(const std::string &s, long double &out) {
+  if (s.empty() || std::isspace(static_cast<unsigned char>(s[0]))) {
+    return false;
+  }
+  char *end;
+  errno = 0;
+  out = std::strtold(s.c_str(), &end);
+  return end == s.c_str() + s.size() && errno != ERANGE && !std::isnan(out);
+}
+
+ConcurrentStore::ConcurrentStore() : lfu_minutes_(lfu_clock()) {}
+
+void ConcurrentStore::touch(Shard &shard, Value *v) {
+  u16 now = lfu_minutes_.load(std::memory_order_relaxed);
+  u64 meta = v->meta;
+  u8 counter = (meta & Value::VERSION_MASK) == 0
+                   ? LFU_INIT_VAL
+                   : lfu_log_incr(lfu_decayed(meta, now));
+  u64 version = ++shard.version_clock & Value::VERSION_MASK;
+  std::atomic_ref<u64>(v->meta).store(pack_meta(version, counter, now),
+                                      std::memory_order_relaxed);
+}
+
+// Concurrent readers may race; the loser's increment is dropped, which an
+// estimate can afford. Once a key is warm most hits change nothing and the
+// shared cache line is not written at all.
+void ConcurrentStore::record_access(const Value &v) const {
+  u16 now = lfu_minutes_.load(std::memory_order_relaxed);
+  std::atomic_ref<u64> meta(v.meta);
+  u64 old = meta.load(std::memory_order_relaxed);
+  u64 updated = pack_meta(old & Value::VERSION_MASK,
+                          lfu_log_incr(lfu_decayed(old, now)), now);
+  if (updated != old) {
+    meta.compare_exchange_strong(old, updated, std::memory_order_relaxed);
+  }
+}
+
+u8 ConcurrentStore::frequency(const Value &v) const {
+  u64 meta = std::atomic_ref<u64>(v.meta).load(std::memory_order_relaxed);
+  return lfu_decayed(meta, lfu_minutes_.load(std::memory_order_relaxed));
+}
+
+void ConcurrentStore::notify(const std::string &key) {
+  if (!observer_) {
+    return;
+  }
+  if (t_key_lock_store == this) {
+    t_deferred_notify.push_back(key);
+    return;
+  }
+  observer_(key);
+}
+
+bool ConcurrentStore::held_by_key_lock(const Shard &shard) const {
+  return t_key_lock_store == this &&
+         (t_key_lock_shards & (u32{1} << (&shard - shards_.data())));
+}
+
+std::unique_lock<std::shared_mutex>
+ConcurrentStore::lock_exclusive(Shard &shard) const {
+  if (held_by_key_lock(shard)) {
+    return std::unique_lock(shard.mtx, std::defer_lock);
+  }
+  return std::unique_lock(shard.mtx);
+}
+
+std::shared_lock<std::shared_mutex>
+ConcurrentStore::lock_shared(const Shard &shard) const {
+  if (held_by_key_lock(shard)) {
+    return std::shared_lock(shard.mtx, std::defer_lock);
+  }
+  return std::shared_lock(shard.mtx);
+}
+
+ConcurrentStore::KeyLock::KeyLock(ConcurrentStore &store,
+                                  const std::vector<std::string> &keys,
+                                  bool all_shards)
+    : store_(store) {
+  if (t_key_lock_store == &store_) {
+    nested_ = true;
+    return;
+  }
+  if (all_shards) {
+    shards_ = static_cast<u32>((u64{1} << SHARD_COUNT) - 1);
   } else {
-    v.expires_at = 0;
-    expiry_index_.erase(key);
+    for (const auto &key : keys) {
+      shards_ |= u32{1} << shard_of(Dict<Value>::hash_key(key));
+    }
+  }
+  for (size_t i = 0; i < SHARD_COUNT; i++) {
+    if (shards_ & (u32{1} << i)) {
+      store_.shards_[i].mtx.lock();
+    }
+  }
+  t_key_lock_store = &store_;
+  t_key_lock_shards = shards_;
+}
+
+ConcurrentStore::KeyLock::~KeyLock() {
+  if (nested_) {
+    return;
+  }
+  t_key_lock_store = nullptr;
+  t_key_lock_shards = 0;
+  for (size_t i = SHARD_COUNT; i-- > 0;) {
+    if (shards_ & (u32{1} << i)) {
+      store_.shards_[i].mtx.unlock();
+    }
+  }
+  std::vector<std::string> keys = std::move(t_deferred_notify);
+  t_deferred_notify.clear();
+  for (const auto &key : keys) {
+    store_.notify(key);
   }
+}
+
+void ConcurrentStore::set(const std::string &key, Value v, i64 ttl_ms) {
+  u64 hash = Dict<Value>::hash_key(key);
+  Shard &shard = shard_for(hash);
+  {
+    auto lock = lock_exclusive(shard);
+
+    if (ttl_ms > 0) {
+      v.expires_at = get_now_ms() + ttl_ms;
+      shard.expiry_index[key] = v.expires_at;
+    } else {
+      v.expires_at = 0;
+      shard.expiry_index.erase(key);
+    }
 
-  store_[key] = std::move(v);
+    auto [value, inserted] =
+        shard.store.insert_or_assign(key, hash, std::move(v));
+    touch(shard, value);
+    if (inserted) {
+      shard.keys.store(shard.store.size(), std::memory_order_relaxed);
+      index_insert(key);
+    }
+  }
+  notify(key);
 }
 
 std::optional<RedisData> ConcurrentStore::get(const std::string &key) {
-  std::shared_lock lock(mtx_);
-  auto it = store_.find(key);
+  u64 hash = Dict<Value>::hash_key(key);
+  Shard &shard = shard_for(hash);
+  auto lock = lock_shared(shard);
+  const Value *v = shard.store.find(key, hash);
 
-  if (it == store_.end()) {
+  if (!v) {
     return std::nullopt;
   }
 
-  if (!it->second.is_persistent() && it->second.expires_at < get_now_ms()) {
-    lock.unlock();
-    std::unique_lock write_lock(mtx_);
+  if (!v->is_persistent() && v->expires_at < get_now_ms()) {
+    if (lock.owns_lock()) {
+      lock.unlock();
+    }
+    auto write_lock = lock_exclusive(shard);
 
-    store_.erase(key);
-    expiry_index_.erase(key);
+    // Re-check: the key may have been rewritten while unlocked.
+    v = shard.store.find(key, hash);
+    if (v && !v->is_persistent() && v->expires_at < get_now_ms()) {
+      remove_locked(shard, key, hash);
+      expired_keys_++;
+      if (write_lock.owns_lock()) {
+        write_lock.unlock();
+      }
+      notify(key);
+    }
     return std::nullopt;
   }
 
-  return it->second.data;
+  record_access(*v);
+  return v->data;
 }
 
 Value* ConcurrentStore::get_or_create(const std::string &key) {
-  std::unique_lock lock(mtx_);
+  u64 hash = Dict<Value>::hash_key(key);
+  Shard &shard = shard_for(hash);
+  auto lock = lock_exclusive(shard);
 
-  auto it = store_.find(key);
-  if (it == store_.end()) {
-    auto [new_it, _] = store_.emplace(key, Value{RedisList{}});
-    return &new_it->second;
+  auto [value, inserted] = shard.store.try_emplace(key, hash, RedisList{});
+  // The caller writes through the pointer.
+  touch(shard, value);
+  if (inserted) {
+    shard.keys.store(shard.store.size(), std::memory_order_relaxed);
+    index_insert(key);
   }
-  
-  return &it->second;
+  return value;
 }
 
-void ConcurrentStore::active_expiry_cycle() {
-  std::unique_lock lock(mtx_);
-  if (expiry_index_.empty()) {
-    return;
+StoreStatus ConcurrentStore::set(const std::string &key, RedisData data,
+                                 const SetOptions &opts,
+                                 std::optional<RedisData> *old) {
+  u64 hash = Dict<Value>::hash_key(key);
+  Shard &shard = shard_for(hash);
+  bool expired = false;
+  StoreStatus status = StoreStatus::OK;
+  {
+    auto lock = lock_exclusive(shard);
+    Value *v = find_live_locked(shard, key, hash, expired);
+    if (old && v && v->is_list()) {
+      status = StoreStatus::WRONG_TYPE;
+    } else if ((opts.condition == SetOptions::Condition::IF_ABSENT && v) ||
+               (opts.condition == SetOptions::Condition::IF_PRESENT && !v)) {
+      status = StoreStatus::NOT_SET;
+      if (old && v) {
+        *old = v->data;
+      }
+    } else {
+      // The old value is overwritten below, so it can be moved out.
+      if (old && v) {
+        *old = std::move(v->data);
+      }
+      i64 expires_at = 0;
+      if (opts.ttl_ms > 0) {
+        expires_at = get_now_ms() + opts.ttl_ms;
+      } else if (opts.keep_ttl && v) {
+        expires_at = v->expires_at;
+      }
+
+      if (v) {
+        v->data = std::move(data);
+        touch(shard, v);
+      } else {
+        v = insert_locked(shard, key, hash, std::move(data));
+      }
+      v->expires_at = expires_at;
+      if (expires_at > 0) {
+        shard.expiry_index[key] = expires_at;
+      } else {
+        shard.expiry_index.erase(key);
+      }
+    }
+  }
+  if (status == StoreStatus::OK || expired) {
+    notify(key);
+  }
+  return status;
+}
+
+StoreStatus ConcurrentStore::incr_by(const std::string &key, i64 delta,
+                                     i64 &result) {
+  u64 hash = Dict<Value>::hash_key(key);
+  Shard &shard = shard_for(hash);
+  bool expired = false;
+  StoreStatus status = StoreStatus::OK;
+  {
+    auto lock = lock_exclusive(shard);
+    Value *v = find_live_locked(shard, key, hash, expired);
+    i64 current = 0;
+    if (v) {
+      if (const i64 *n = std::get_if<i64>(&v->data)) {
+        current = *n;
+      } else if (v->is_list()) {
+        status = StoreStatus::WRONG_TYPE;
+      } else if (!parse_canonical_int(std::get<std::string>(v->data),
+                                      current)) {
+        status = StoreStatus::NOT_INTEGER;
+      }
+    }
+    if (status == StoreStatus::OK &&
+        __builtin_add_overflow(current, delta, &result)) {
+      status = StoreStatus::OVERFLOW;
+    }
+    if (status == StoreStatus::OK) {
+      if (v) {
+        v->data = result;
+        touch(shard, v);
+      } else {
+        insert_locked(shard, key, hash, result);
+      }
+    }
   }
+  if (status == StoreStatus::OK || expired) {
+    notify(key);
+  }
+  return status;
+}
+
+StoreStatus ConcurrentStore::incr_by_float(const std::string &key,
+                                           long double delta,
+                                           std::string &result) {
+  u64 hash = Dict<Value>::hash_key(key);
+  Shard &shard = shard_for(hash);
+  bool expired = false;
+  StoreStatus status = StoreStatus::OK;
+  {
+    auto lock = lock_exclusive(shard);
+    Value *v = find_live_locked(shard, key, hash, expired);
+    long double current = 0;
+    if (v) {
+      if (const i64 *n = std::get_if<i64>(&v->data)) {
+        current = static_cast<long double>(*n);
+      } else if (v->is_list()) {
+        status = StoreStatus::WRONG_TYPE;
+      } else if (!parse_long_double(std::get<std::string>(v->data),
+                                    current)) {
+        status = StoreStatus::NOT_FLOAT;
+      }
+    }
+    if (status == StoreStatus::OK) {
+      long double sum = current + delta;
+      if (std::isnan(sum) || std::isinf(sum)) {
+        status = StoreStatus::NOT_FLOAT;
+      } else {
+        result = format_long_double(sum);
+        if (v) {
+          v->data = encode_string(result);
+          touch(shard, v);
+        } else {
+          insert_locked(shard, key, hash, encode_string(result));
+        }
+      }
+    }
+  }
+  if (status == StoreStatus::OK || expired) {
+    notify(key);
+  }
+  return status;
+}
 
+StoreStatus ConcurrentStore::getdel(const std::string &key,
+                                    std::optional<RedisData> &out) {
+  u64 hash = Dict<Value>::hash_key(key);
+  Shard &shard = shard_for(hash);
+  bool expired = false;
+  StoreStatus status = StoreStatus::OK;
+  out.reset();
+  {
+    auto lock = lock_exclusive(shard);
+    Value *v = find_live_locked(shard, key, hash, expired);
+    if (!v) {
+      status = StoreStatus::NOT_SET;
+    } else if (v->is_list()) {
+      status = StoreStatus::WRONG_TYPE;
+    } else {
+      out = std::move(v->data);
+      remove_locked(shard, key, hash);
+    }
+  }
+  if (status == StoreStatus::OK || expired) {
+    notify(key);
+  }
+  return status == StoreStatus::NOT_SET ? StoreStatus::OK : status;
+}
+
+std::optional<size_t>
+ConcurrentStore::rpush(const std::string &key,
+                       std::span<std::string> items) {
+  u64 hash = Dict<Value>::hash_key(key);
+  Shard &shard = shard_for(hash);
+  size_t length;
+  {
+    auto lock = lock_exclusive(shard);
+    Value *v = shard.store.find(key, hash);
+    if (v && !v->is_persistent() && v->expires_at < get_now_ms()) {
+      remove_locked(shard, key, hash);
+      expired_keys_++;
+      v = nullptr;
+    }
+    if (!v) {
+      v = shard.store.try_emplace(key, hash, RedisList{}).first;
+      shard.keys.store(shard.store.size(), std::memory_order_relaxed);
+      index_insert(key);
+    }
+
+    auto *list = std::get_if<RedisList>(&v->data);
+    if (!list) {
+      return std::nullopt;
+    }
+    list->insert(list->end(), std::make_move_iterator(items.begin()),
+                 std::make_move_iterator(items.end()));
+    touch(shard, v);
+    length = list->size();
+  }
+  notify(key);
+  return length;
+}
+
+void ConcurrentStore::active_expiry_cycle() {
   i64 now = get_now_ms();
-  int limit = 20;
+  lfu_minutes_.store(lfu_clock(), std::memory_order_relaxed);
+  std::vector<std::string> expired;
+  for (Shard &shard : shards_) {
+    {
+      std::unique_lock lock(shard.mtx);
+      int limit = 20;
+
+      auto it = shard.expiry_index.begin();
+      while (it != shard.expiry_index.end() && limit > 0) {
+        if (it->second < now) {
+          u64 hash = Dict<Value>::hash_key(it->first);
+          shard.store.erase(it->first, hash);
+          shard.removals++;
+          index_erase(it->first);
+          if (observer_) {
+            expired.push_back(it->first);
+          }
+          it = shard.expiry_index.erase(it);
+          expired_keys_++;
+        } else {
+          it++;
+        }
+        limit--;
+      }
+      shard.store.rehash(REHASH_BUCKETS_PER_CYCLE);
+      shard.keys.store(shard.store.size(), std::memory_order_relaxed);
+    }
+    for (const auto &key : expired) {
+      notify(key);
+    }
+    expired.clear();
+  }
+}
 
-  auto it = expiry_index_.begin();
+StoreStatus ConcurrentStore::read_string(
+    const std::string &key,
+    const std::function<void(std::string_view)> &fn) const {
+  u64 hash = Dict<Value>::hash_key(key);
+  const Shard &shard = shard_for(hash);
+  auto lock = lock_shared(shard);
+  const Value *v = shard.store.find(key, hash);
+  if (!v || (!v->is_persistent() && v->expires_at < get_now_ms())) {
+    fn({});
+    return StoreStatus::OK;
+  }
+  record_access(*v);
+  if (const auto *str = std::get_if<std::string>(&v->data)) {
+    fn(*str);
+  } else if (const i64 *n = std::get_if<i64>(&v->data)) {
+    char buf[24];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), *n);
+    fn(std::string_view(buf, end - buf));
+  } else {
+    return StoreStatus::WRONG_TYPE;
+  }
+  return StoreStatus::OK;
+}
 
-  while (it != expiry_index_.end() && limit > 0) {
-    if (it->second < now) {
-      store_.erase(it->first);
-      it = expiry_index_.erase(it);
+StoreStatus
+ConcurrentStore::update_string(const std::string &key,
+                               const std::function<bool(std::string &)> &fn) {
+  u64 hash = Dict<Value>::hash_key(key);
+  Shard &shard = shard_for(hash);
+  bool expired = false;
+  bool changed = false;
+  {
+    auto lock = lock_exclusive(shard);
+    Value *v = find_live_locked(shard, key, hash, expired);
+    if (v && v->is_list()) {
+      return StoreStatus::WRONG_TYPE;
+    }
+    if (!v) {
+      std::string value;
+      changed = fn(value);
+      if (changed) {
+        insert_locked(shard, key, hash, std::move(value));
+      }
     } else {
-      it++;
+      // Bit and register edits need the bytes, so integers are expanded,
+      // into a copy that replaces the value only if fn changed it.
+      if (const i64 *n = std::get_if<i64>(&v->data)) {
+        std::string expanded = std::to_string(*n);
+        changed = fn(expanded);
+        if (changed) {
+          v->data = std::move(expanded);
+        }
+      } else {
+        changed = fn(std::get<std::string>(v->data));
+      }
+      if (changed) {
+        touch(shard, v);
+      }
+    }
+  }
+  if (changed || expired) {
+    notify(key);
+  }
+  return StoreStatus::OK;
+}
+
+bool ConcurrentStore::contains(const std::string &key) const {
+  u64 hash = Dict<Value>::hash_key(key);
+  const Shard &shard = shard_for(hash);
+  auto lock = lock_shared(shard);
+  const Value *v = shard.store.find(key, hash);
+  return v && (v->is_persistent() || v->expires_at >= get_now_ms());
+}
+
+u64 ConcurrentStore::version(const std::string &key) const {
+  u64 hash = Dict<Value>::hash_key(key);
+  const Shard &shard = shard_for(hash);
+  auto lock = lock_shared(shard);
+  const Value *v = shard.store.find(key, hash);
+  if (!v) {
+    return ABSENT_VERSION | shard.removals;
+  }
+  if (!v->is_persistent() && v->expires_at < get_now_ms()) {
+    // Counts the removal still pending, so the version stays the same once
+    // the key is actually expired.
+    return ABSENT_VERSION | (shard.removals + 1);
+  }
+  return v->version();
+}
+
+bool ConcurrentStore::erase(const std::string &key) {
+  u64 hash = Dict<Value>::hash_key(key);
+  Shard &shard = shard_for(hash);
+  {
+    auto lock = lock_exclusive(shard);
+    if (!shard.store.find(key, hash)) {
+      return false;
+    }
+    remove_locked(shard, key, hash);
+  }
+  notify(key);
+  return true;
+}
+
+bool ConcurrentStore::erase_if_version(const std::string &key, u64 version) {
+  u64 hash = Dict<Value>::hash_key(key);
+  Shard &shard = shard_for(hash);
+  bool expired = false;
+  bool erased = false;
+  {
+    auto lock = lock_exclusive(shard);
+    Value *v = find_live_locked(shard, key, hash, expired);
+    if (v && v->version() == version) {
+      remove_locked(shard, key, hash);
+      erased = true;
+    }
+  }
+  if (erased || expired) {
+    notify(key);
+  }
+  return erased;
+}
+
+// Caller holds the shard's exclusive lock.
+void ConcurrentStore::remove_locked(Shard &shard, const std::string &key,
+                                    u64 hash) {
+  if (shard.store.erase(key, hash)) {
+    shard.removals++;
+    index_erase(key);
+    shard.keys.store(shard.store.size(), std::memory_order_relaxed);
+  }
+  shard.expiry_index.erase(key);
+}
+
+// Caller holds the shard's exclusive lock. Lazily expires the key, setting
+// expired so the caller notifies once unlocked.
+Value *ConcurrentStore::find_live_locked(Shard &shard, const std::string &key,
+                                         u64 hash, bool &expired) {
+  Value *v = shard.store.find(key, hash);
+  if (v && !v->is_persistent() && v->expires_at < get_now_ms()) {
+    remove_locked(shard, key, hash);
+    expired_keys_++;
+    expired = true;
+    return nullptr;
+  }
+  return v;
+}
+
+// Caller holds the shard's exclusive lock and has checked key is absent.
+Value *ConcurrentStore::insert_locked(Shard &shard, const std::string &key,
+                                      u64 hash, RedisData data) {
+  Value *v = shard.store.try_emplace(key, hash, std::move(data)).first;
+  touch(shard, v);
+  shard.keys.store(shard.store.size(), std::memory_order_relaxed);
+  index_insert(key);
+  return v;
+}
+
+std::optional<std::pair<RedisData, i64>>
+ConcurrentStore::dump(const std::string &key, u64 *version) {
+  u64 hash = Dict<Value>::hash_key(key);
+  const Shard &shard = shard_for(hash);
+  auto lock = lock_shared(shard);
+  const Value *v = shard.store.find(key, hash);
+  if (!v) {
+    return std::nullopt;
+  }
+
+  i64 ttl_ms = 0;
+  if (!v->is_persistent()) {
+    ttl_ms = v->expires_at - get_now_ms();
+    if (ttl_ms <= 0) {
+      return std::nullopt;
+    }
+  }
+  if (version)
+    *version = v->version();
+  return std::make_pair(v->data, ttl_ms);
+}
+
+// One SCAN step: visits buckets from cursor, holding one shard's shared lock
+// at a time, until emit has accepted count keys or count * 10 buckets have
+// been seen. emit(key, value) returns whether it took the key.
+template <typename F>
+u64 ConcurrentStore::walk(u64 cursor, size_t count, F &&emit) const {
+  size_t shard_idx = cursor >> CURSOR_SHARD_SHIFT;
+  u64 bucket = cursor & ((u64{1} << CURSOR_SHARD_SHIFT) - 1);
+  count = std::max<size_t>(count, 1);
+  size_t taken = 0;
+  size_t budget = count * 10;
+  i64 now = get_now_ms();
+
+  auto visit = [&](const std::string &key, const Value &v) {
+    if ((v.is_persistent() || v.expires_at >= now) && emit(key, v)) {
+      taken++;
+    }
+  };
+
+  while (shard_idx < SHARD_COUNT) {
+    {
+      auto lock = lock_shared(shards_[shard_idx]);
+      do {
+        bucket = shards_[shard_idx].store.scan(bucket, visit);
+        budget--;
+      } while (bucket != 0 && taken < count && budget > 0);
+    }
+    if (bucket != 0) {
+      return (static_cast<u64>(shard_idx) << CURSOR_SHARD_SHIFT) | bucket;
+    }
+    shard_idx++;
+    if (taken >= count || budget == 0) {
+      break;
+    }
+  }
+  return shard_idx < SHARD_COUNT
+             ? static_cast<u64>(shard_idx) << CURSOR_SHARD_SHIFT
+             : 0;
+}
+
+u64 ConcurrentStore::scan(u64 cursor, size_t count,
+                          std::vector<ScanEntry> &out) const {
+  return walk(cursor, count, [&](const std::string &key, const Value &v) {
+    out.push_back({key, v.data.index()});
+    return true;
+  });
+}
+
+// Rough resident size: the table node and key, plus heap blocks for strings
+// that do not fit the small-string buffer. Lists are estimated from up to
+// five elements, like Redis' MEMORY USAGE default.
+static u64 estimate_memory(const std::string &key, const Value &v) {
+  auto heap = [](const std::string &s) -> u64 {
+    return s.capacity() > std::string().capacity() ? s.capacity() + 1 : 0;
+  };
+  u64 bytes = sizeof(Value) + sizeof(std::string) + 2 * sizeof(void *) +
+              sizeof(u64) + heap(key);
+  if (const auto *str = std::get_if<std::string>(&v.data)) {
+    bytes += heap(*str);
+  } else if (const auto *list = std::get_if<RedisList>(&v.data)) {
+    size_t sampled = std::min<size_t>(list->size(), 5);
+    u64 sample_bytes = 0;
+    for (size_t i = 0; i < sampled; i++) {
+      sample_bytes += sizeof(std::string) + heap((*list)[i]);
+    }
+    if (sampled > 0) {
+      bytes += sample_bytes * list->size() / sampled;
+    }
+  }
+  return bytes;
+}
+
+static u64 element_count(const Value &v) {
+  if (const auto *str = std::get_if<std::string>(&v.data)) {
+    return str->size();
+  }
+  if (const auto *list = std::get_if<RedisList>(&v.data)) {
+    return list->size();
+  }
+  char buf[24];
+  auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), std::get<i64>(v.data));
+  return static_cast<u64>(end - buf);
+}
+
+u64 ConcurrentStore::sample(u64 cursor, size_t count,
+                            std::vector<KeySample> &out) const {
+  return walk(cursor, count, [&](const std::string &key, const Value &v) {
+    out.push_back({key, v.data.index(), frequency(v), element_count(v),
+                   estimate_memory(key, v)});
+    return true;
+  });
+}
+
+void ConcurrentStore::enable_slot_index() {
+  slot_index_ = std::make_unique<SlotIndex>();
+  slot_index_->keys.resize(CLUSTER_SLOTS);
+  slot_index_enabled_.store(true, std::memory_order_release);
+  for (Shard &shard : shards_) {
+    std::shared_lock lock(shard.mtx);
+    shard.store.for_each(
+        [this](const std::string &key, const Value &) { index_insert(key); });
+  }
+}
+
+// Callers hold the key's shard lock.
+void ConcurrentStore::index_insert(const std::string &key) {
+  if (!slot_index_enabled_.load(std::memory_order_acquire)) {
+    return;
+  }
+  u16 slot = key_hash_slot(key);
+  std::lock_guard lock(slot_index_->lock_for(slot));
+  slot_index_->keys[slot].insert(key);
+}
+
+void ConcurrentStore::index_erase(const std::string &key) {
+  if (!slot_index_enabled_.load(std::memory_order_acquire)) {
+    return;
+  }
+  u16 slot = key_hash_slot(key);
+  std::lock_guard lock(slot_index_->lock_for(slot));
+  slot_index_->keys[slot].erase(key);
+}
+
+size_t ConcurrentStore::count_keys_in_slot(u16 slot) const {
+  if (!slot_index_enabled_.load(std::memory_order_acquire) ||
+      slot >= CLUSTER_SLOTS) {
+    return 0;
+  }
+  std::lock_guard lock(slot_index_->lock_for(slot));
+  return slot_index_->keys[slot].size();
+}
+
+std::vector<std::string> ConcurrentStore::keys_in_slot(u16 slot,
+                                                       size_t count) const {
+  std::vector<std::string> keys;
+  if (!slot_index_enabled_.load(std::memory_order_acquire) ||
+      slot >= CLUSTER_SLOTS) {
+    return keys;
+  }
+  std::lock_guard lock(slot_index_->lock_for(slot));
+  for (const auto &key : slot_index_->keys[slot]) {
+    if (keys.size() >= count) {
+      break;
     }
-    limit--;
+    keys.push_back(key);
+  }
+  return keys;
+}
+
+size_t ConcurrentStore::size() const {
+  size_t total = 0;
+  for (const Shard &shard : shards_) {
+    total += shard.keys.load(std::memory_order_relaxed);
   }
+  return total;
 }
 } // namespace Redis
\ No newline at end of file
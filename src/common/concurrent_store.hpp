@@ -1,22 +1,241 @@
+#pragma once
+#include "common/dict.hpp"
 #include "common/types.hpp"
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <shared_mutex>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace Redis {
+
+// String values that are canonical integers ("0", "-12", no '+' or leading
+// zeros, within i64) are encoded as i64; anything else stays a string.
+RedisData encode_string(std::string s);
+bool parse_canonical_int(std::string_view s, i64 &out);
+// strtold over the whole string; rejects leading spaces and NaN.
+bool parse_long_double(const std::string &s, long double &out);
+
+enum class StoreStatus {
+  OK,
+  NOT_SET,     // NX/XX condition failed
+  WRONG_TYPE,  // key holds a list
+  NOT_INTEGER, // value is not an integer
+  OVERFLOW,    // integer result out of range
+  NOT_FLOAT,   // value is not a float, or the result is NaN/Inf
+};
+
+struct SetOptions {
+  enum class Condition { ALWAYS, IF_ABSENT, IF_PRESENT };
+  Condition condition = Condition::ALWAYS;
+  bool keep_ttl = false;
+  i64 ttl_ms = -1;
+};
+
+struct ScanEntry {
+  std::string key;
+  size_t type; // RedisData alternative index
+};
+
+// What the hot/big key sampler learns about one key.
+struct KeySample {
+  std::string key;
+  size_t type;     // RedisData alternative index
+  u8 frequency;    // decayed LFU counter, as OBJECT FREQ reports it
+  u64 elements;    // string length or list length
+  u64 memory;      // estimated bytes, key and table node included
+};
+
 class ConcurrentStore {
+public:
+  static constexpr int SHARD_BITS = 4;
+  static constexpr size_t SHARD_COUNT = size_t{1} << SHARD_BITS;
+  // SCAN cursors carry the shard in their top bits and the shard's
+  // reverse-binary bucket cursor below.
+  static constexpr int CURSOR_SHARD_SHIFT = 64 - SHARD_BITS;
+
 private:
-  std::unordered_map<std::string, Value> store_;
-  std::unordered_map<std::string, i64> expiry_index_;
-  mutable std::shared_mutex mtx_;
+  struct alignas(64) Shard {
+    Dict<Value> store;
+    std::unordered_map<std::string, i64> expiry_index;
+    mutable std::shared_mutex mtx;
+    // Mirrors store.size() so DBSIZE never takes a lock.
+    std::atomic<size_t> keys{0};
+    // Source of Value::version; written under the exclusive lock. Versions
+    // wrap after 2^40 writes to one shard.
+    u64 version_clock = 0;
+    // Keys removed from the shard by delete or expiry; the version of a
+    // missing key, so that one created and removed again reads as changed.
+    u64 removals = 0;
+  };
+
+  std::array<Shard, SHARD_COUNT> shards_;
+  std::atomic<u64> expired_keys_{0};
+
+  // Cluster mode only: keys bucketed by hash slot, so slot counts and
+  // migrations never walk the whole keyspace. Slots are striped over a few
+  // locks so that shards rarely meet there. Lock order: shard, then slot.
+  struct SlotIndex {
+    static constexpr size_t LOCK_COUNT = 64;
+    std::array<std::mutex, LOCK_COUNT> locks;
+    std::vector<std::unordered_set<std::string>> keys;
+
+    std::mutex &lock_for(u16 slot) { return locks[slot % LOCK_COUNT]; }
+  };
+  std::unique_ptr<SlotIndex> slot_index_;
+  // Checked before anything else, so that outside cluster mode key creation
+  // and removal never touch the index.
+  std::atomic<bool> slot_index_enabled_{false};
+
+  static size_t shard_of(u64 hash) { return hash >> CURSOR_SHARD_SHIFT; }
+  Shard &shard_for(u64 hash) { return shards_[shard_of(hash)]; }
+  const Shard &shard_for(u64 hash) const { return shards_[shard_of(hash)]; }
+
+  std::function<void(const std::string &)> observer_;
+
+  void notify(const std::string &key);
+  // Minutes since start, truncated to 16 bits, for LFU decay. Advanced by
+  // active_expiry_cycle() so the read path only does a relaxed load.
+  std::atomic<u16> lfu_minutes_{0};
+
+  // Write path: new version plus an LFU access. Caller holds the exclusive
+  // lock.
+  void touch(Shard &shard, Value *v);
+  // Read path: LFU access only, safe under the shared lock.
+  void record_access(const Value &v) const;
+  u8 frequency(const Value &v) const;
+  template <typename F> u64 walk(u64 cursor, size_t count, F &&emit) const;
+  // Shard locks that step aside when this thread already holds the shard
+  // through a KeyLock; the returned lock then does not own the mutex.
+  bool held_by_key_lock(const Shard &shard) const;
+  std::unique_lock<std::shared_mutex> lock_exclusive(Shard &shard) const;
+  std::shared_lock<std::shared_mutex> lock_shared(const Shard &shard) const;
+  void index_insert(const std::string &key);
+  void index_erase(const std::string &key);
+  void remove_locked(Shard &shard, const std::string &key, u64 hash);
+  Value *find_live_locked(Shard &shard, const std::string &key, u64 hash,
+                          bool &expired);
+  Value *insert_locked(Shard &shard, const std::string &key, u64 hash,
+                       RedisData data);
 
 public:
+  ConcurrentStore();
+
+  // Exclusive locks on the shards of keys (or on every shard), taken in
+  // shard order so that concurrent holders cannot deadlock. While it lives,
+  // store calls made by the owning thread run under these locks instead of
+  // taking their own, and key notifications are held back until release.
+  // A KeyLock taken while the thread already holds one (a multi-key command
+  // inside EXEC) does nothing; the outer lock must cover its keys.
+  class KeyLock {
+  public:
+    KeyLock(ConcurrentStore &store, const std::vector<std::string> &keys,
+            bool all_shards = false);
+    ~KeyLock();
+    KeyLock(const KeyLock &) = delete;
+    KeyLock &operator=(const KeyLock &) = delete;
+
+  private:
+    ConcurrentStore &store_;
+    u32 shards_ = 0;
+    bool nested_ = false;
+  };
+  static_assert(SHARD_COUNT <= 32, "KeyLock keeps shards in a u32 mask");
+
+  // Called with the key after a write, expiry or delete has changed it, once
+  // the shard lock is released. Install before the store is shared.
+  void set_key_observer(std::function<void(const std::string &)> observer) {
+    observer_ = std::move(observer);
+  }
+
+  // Called with the duration in microseconds of each batch of shard resize
+  // work done by active_expiry_cycle(), while that shard's exclusive lock is
+  // held. Install before the store is shared.
+  void set_rehash_observer(const std::function<void(u64)> &observer) {
+    for (Shard &shard : shards_) {
+      shard.store.set_rehash_observer(observer);
+    }
+  }
+
   void set(const std::string &key, Value v, i64 ttl_ms = -1);
   std::optional<RedisData> get(const std::string &key);
   Value *get_or_create(const std::string &key);
 
+  // SET with NX/XX/KEEPTTL, atomically. If old is given it receives the
+  // previous string value (GET option); a list there fails with WRONG_TYPE
+  // and nothing is written.
+  StoreStatus set(const std::string &key, RedisData data,
+                  const SetOptions &opts,
+                  std::optional<RedisData> *old = nullptr);
+  // In place under the shard lock; a missing key counts as 0 and the TTL is
+  // kept.
+  StoreStatus incr_by(const std::string &key, i64 delta, i64 &result);
+  StoreStatus incr_by_float(const std::string &key, long double delta,
+                            std::string &result);
+  StoreStatus getdel(const std::string &key, std::optional<RedisData> &out);
+  // Moves items onto the list at key, creating it if needed. Returns the new
+  // length, or nullopt if key holds a non-list value.
+  std::optional<size_t> rpush(const std::string &key,
+                              std::span<std::string> items);
+
+  // Bitmaps and HyperLogLogs work on string values in place, through these.
+  // read_string runs fn on the value under the shard's shared lock: empty
+  // for a missing key, digits for an integer. update_string runs fn on it
+  // under the exclusive lock; fn returns whether it changed the string, and
+  // only then is a missing key created or the version bumped. Both fail with
+  // WRONG_TYPE on a list without calling fn.
+  StoreStatus
+  read_string(const std::string &key,
+              const std::function<void(std::string_view)> &fn) const;
+  StoreStatus update_string(const std::string &key,
+                            const std::function<bool(std::string &)> &fn);
+
+  bool contains(const std::string &key) const;
+  // Version of the live value at key. Writing to a live key, deleting it or
+  // letting it expire changes it. A missing key reads as ABSENT_VERSION plus
+  // its shard's removal count, which any removal in the shard changes, so
+  // creating and then removing the key is never missed (other removals in
+  // the shard may cause a spurious change).
+  static constexpr u64 ABSENT_VERSION = u64{1} << 63;
+  u64 version(const std::string &key) const;
+  bool erase(const std::string &key);
+  // Erases key only if its live value still has the given version, so a
+  // write made after dump() is never dropped. Returns whether it erased.
+  bool erase_if_version(const std::string &key, u64 version);
+  // Value plus remaining TTL in ms (0 when persistent), for MIGRATE. If
+  // version is given it receives the value's version, read under the same
+  // lock.
+  std::optional<std::pair<RedisData, i64>> dump(const std::string &key,
+                                                u64 *version = nullptr);
+
+  // Also advances shard resizes that writes have not finished.
   void active_expiry_cycle();
+
+  // One SCAN step from cursor: appends live keys to out and returns the
+  // cursor to resume from, 0 once every shard has been covered. Holds one
+  // shard's shared lock at a time and visits at most count * 10 buckets.
+  u64 scan(u64 cursor, size_t count, std::vector<ScanEntry> &out) const;
+  // Same walk as scan(), reporting access frequency and size for each key.
+  u64 sample(u64 cursor, size_t count, std::vector<KeySample> &out) const;
+
+  // O(SHARD_COUNT), lock free.
+  size_t size() const;
+  u64 expired_keys() const { return expired_keys_.load(); }
+
+  // Cluster mode: starts tracking keys by hash slot. Call once, before the
+  // store is shared.
+  void enable_slot_index();
+  size_t count_keys_in_slot(u16 slot) const;
+  std::vector<std::string> keys_in_slot(u16 slot, size_t count) const;
 };
 
-} // namespace Redis
\ No newline at end of file
+} // namespace Redis
@@ -0,0 +1,284 @@
+#pragma once
+#include "common/types.hpp"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Redis {
+
+// Chained hash table with power-of-two bucket counts. std::unordered_map uses
+// prime bucket counts, which rules out Redis' reverse-binary SCAN cursor; with
+// bucket = hash & mask, scan() returns every element that is present for the
+// whole iteration at least once, even if the table grows or shrinks between
+// calls. Resizes are incremental, as in Redis: a second table is allocated and
+// every insert or erase moves one bucket into it, so no single call pays for
+// the whole table. Node addresses are stable across rehashes. Not thread
+// safe; const members do not move buckets and may run concurrently.
+template <typename V> class Dict {
+public:
+  static constexpr size_t MIN_BUCKETS = 4;
+
+  static u64 hash_key(std::string_view key) {
+    return std::hash<std::string_view>{}(key);
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  // The size being rehashed to, if a resize is under way.
+  size_t bucket_count() const { return tables_[rehashing() ? 1 : 0].size(); }
+  bool rehashing() const { return rehash_idx_ != NOT_REHASHING; }
+
+  // Called with the duration in microseconds of every rehash() batch. Steps
+  // taken by inserts and erases move a single bucket and are not timed.
+  void set_rehash_observer(std::function<void(u64)> observer) {
+    on_rehash_ = std::move(observer);
+  }
+
+  V *find(std::string_view key, u64 hash) {
+    Node *n = find_node(key, hash);
+    return n ? &n->value : nullptr;
+  }
+  const V *find(std::string_view key, u64 hash) const {
+    const Node *n = const_cast<Dict *>(this)->find_node(key, hash);
+    return n ? &n->value : nullptr;
+  }
+
+  // Returns the value for key, constructing it from args if absent.
+  template <typename... Args>
+  std::pair<V *, bool> try_emplace(const std::string &key, u64 hash,
+                                   Args &&...args) {
+    rehash_step(1);
+    if (Node *n = find_node(key, hash)) {
+      return {&n->value, false};
+    }
+    grow_if_needed();
+    auto node = std::make_unique<Node>(
+        Node{key, V(std::forward<Args>(args)...), hash, nullptr});
+    // Buckets below rehash_idx_ are already empty in the old table.
+    auto &table = tables_[rehashing() ? 1 : 0];
+    auto &head = table[hash & (table.size() - 1)];
+    node->next = std::move(head);
+    head = std::move(node);
+    size_++;
+    return {&head->value, true};
+  }
+
+  std::pair<V *, bool> insert_or_assign(const std::string &key, u64 hash,
+                                        V value) {
+    if (Node *n = find_node(key, hash)) {
+      n->value = std::move(value);
+      return {&n->value, false};
+    }
+    return try_emplace(key, hash, std::move(value));
+  }
+
+  bool erase(std::string_view key, u64 hash) {
+    if (size_ == 0) {
+      return false;
+    }
+    rehash_step(1);
+    for (auto &table : tables_) {
+      if (table.empty()) {
+        continue;
+      }
+      std::unique_ptr<Node> *link = &table[hash & (table.size() - 1)];
+      while (*link) {
+        if ((*link)->hash == hash && (*link)->key == key) {
+          *link = std::move((*link)->next);
+          size_--;
+          shrink_if_needed();
+          return true;
+        }
+        link = &(*link)->next;
+      }
+    }
+    return false;
+  }
+
+  // Moves up to buckets buckets of a resize in progress, for callers that
+  // finish resizes of tables nobody is writing to. Returns true while the
+  // resize still has buckets left.
+  bool rehash(size_t buckets) {
+    if (!rehashing()) {
+      return false;
+    }
+    auto start = on_rehash_ ? std::chrono::steady_clock::now()
+                            : std::chrono::steady_clock::time_point{};
+    rehash_step(buckets);
+    if (on_rehash_) {
+      on_rehash_(static_cast<u64>(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count()));
+    }
+    return rehashing();
+  }
+
+  template <typename F> void for_each(F &&fn) const {
+    for (const auto &table : tables_) {
+      for (const auto &head : table) {
+        for (const Node *n = head.get(); n; n = n->next.get()) {
+          fn(n->key, n->value);
+        }
+      }
+    }
+  }
+
+  // Emits every entry of the bucket addressed by cursor and returns the next
+  // cursor, or 0 once the table has been covered. The cursor is incremented
+  // from its high bits down, so buckets that split or merge on a resize map
+  // onto cursors that are still ahead of the iteration. While rehashing, the
+  // cursor's bucket in the smaller table is emitted together with every
+  // bucket of the larger table it expands to.
+  template <typename F> u64 scan(u64 cursor, F &&fn) const {
+    if (!rehashing()) {
+      const auto &table = tables_[0];
+      if (table.empty()) {
+        return 0;
+      }
+      u64 mask = table.size() - 1;
+      emit_bucket(table[cursor & mask], fn);
+      return next_cursor(cursor, mask);
+    }
+
+    const auto *small = &tables_[0];
+    const auto *large = &tables_[1];
+    if (small->size() > large->size()) {
+      std::swap(small, large);
+    }
+    u64 small_mask = small->size() - 1;
+    u64 large_mask = large->size() - 1;
+    emit_bucket((*small)[cursor & small_mask], fn);
+    do {
+      emit_bucket((*large)[cursor & large_mask], fn);
+      cursor = next_cursor(cursor, large_mask);
+    } while (cursor & (small_mask ^ large_mask));
+    return cursor;
+  }
+
+private:
+  struct Node {
+    std::string key;
+    V value;
+    u64 hash;
+    std::unique_ptr<Node> next;
+  };
+  using Table = std::vector<std::unique_ptr<Node>>;
+
+  static constexpr size_t NOT_REHASHING = static_cast<size_t>(-1);
+  // Empty buckets a step may skip per bucket it is asked to move, so that a
+  // sparse old table does not turn one insert into a long walk.
+  static constexpr size_t EMPTY_VISITS = 10;
+
+  static u64 reverse_bits(u64 v) {
+    v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+    v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+    v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    v = ((v >> 8) & 0x00FF00FF00FF00FFULL) | ((v & 0x00FF00FF00FF00FFULL) << 8);
+    v = ((v >> 16) & 0x0000FFFF0000FFFFULL) |
+        ((v & 0x0000FFFF0000FFFFULL) << 16);
+    return (v >> 32) | (v << 32);
+  }
+
+  static u64 next_cursor(u64 cursor, u64 mask) {
+    cursor |= ~mask;
+    cursor = reverse_bits(cursor);
+    cursor++;
+    return reverse_bits(cursor);
+  }
+
+  template <typename F>
+  static void emit_bucket(const std::unique_ptr<Node> &head, F &fn) {
+    for (const Node *n = head.get(); n; n = n->next.get()) {
+      fn(n->key, n->value);
+    }
+  }
+
+  Node *find_node(std::string_view key, u64 hash) {
+    for (auto &table : tables_) {
+      if (table.empty()) {
+        continue;
+      }
+      for (Node *n = table[hash & (table.size() - 1)].get(); n;
+           n = n->next.get()) {
+        if (n->hash == hash && n->key == key) {
+          return n;
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  void grow_if_needed() {
+    if (tables_[0].empty()) {
+      tables_[0].resize(MIN_BUCKETS);
+    } else if (!rehashing() && size_ >= tables_[0].size()) {
+      start_rehash(tables_[0].size() * 2);
+    }
+  }
+
+  // Shrink at 1/8 load so that alternating inserts and deletes near a
+  // boundary do not rehash every time.
+  void shrink_if_needed() {
+    size_t buckets = tables_[0].size();
+    if (!rehashing() && buckets > MIN_BUCKETS && size_ * 8 < buckets) {
+      size_t target = MIN_BUCKETS;
+      while (target < size_) {
+        target *= 2;
+      }
+      start_rehash(target);
+    }
+  }
+
+  void start_rehash(size_t new_count) {
+    tables_[1] = Table(new_count);
+    rehash_idx_ = 0;
+  }
+
+  // Moves the nodes of up to buckets non-empty old buckets into the new
+  // table, and swaps the tables once the old one is empty.
+  void rehash_step(size_t buckets) {
+    if (!rehashing()) {
+      return;
+    }
+    Table &from = tables_[0];
+    Table &to = tables_[1];
+    size_t empty_visits = buckets * EMPTY_VISITS;
+    while (buckets > 0 && rehash_idx_ < from.size()) {
+      std::unique_ptr<Node> &head = from[rehash_idx_];
+      if (!head) {
+        rehash_idx_++;
+        if (--empty_visits == 0) {
+          break;
+        }
+        continue;
+      }
+      while (head) {
+        std::unique_ptr<Node> node = std::move(head);
+        head = std::move(node->next);
+        auto &slot = to[node->hash & (to.size() - 1)];
+        node->next = std::move(slot);
+        slot = std::move(node);
+      }
+      rehash_idx_++;
+      buckets--;
+    }
+    if (rehash_idx_ == from.size()) {
+      from = std::move(to);
+      to = Table();
+      rehash_idx_ = NOT_REHASHING;
+    }
+  }
+
+  // tables_[1] is only allocated while a resize is moving nodes into it.
+  Table tables_[2];
+  size_t rehash_idx_ = NOT_REHASHING; // next old bucket to move
+  size_t size_ = 0;
+  std::function<void(u64)> on_rehash_;
+};
+
+} // namespace Redis
@@ -0,0 +1,438 @@
+#include "common/hyperloglog.hpp"
+#include "util/bitops.hpp"
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace Redis::hll {
+
+// Constants and algorithms follow Redis' hyperloglog.c so that encoded values
+// and estimates match byte for byte.
+static constexpr int Q = 64 - P;
+static constexpr u8 REGISTER_MAX = 63;
+static constexpr u8 SPARSE_VAL_MAX = 32;
+static constexpr u8 DENSE = 0;
+static constexpr u8 SPARSE = 1;
+static constexpr size_t CARD_OFFSET = 8;
+
+// Sparse opcodes: 00xxxxxx ZERO run of 1-64, 01xxxxxx yyyyyyyy XZERO run of
+// 1-16384, 1vvvvvxx VAL run of 1-4 registers holding 1-32.
+static constexpr u8 OP_XZERO = 0x40;
+static constexpr u8 OP_VAL = 0x80;
+
+static u64 murmur_hash64a(const void *key, size_t len, u64 seed) {
+  const u64 m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+  u64 h = seed ^ (len * m);
+  const auto *data = static_cast<const u8 *>(key);
+  const u8 *end = data + (len - (len & 7));
+
+  while (data != end) {
+    u64 k;
+    std::memcpy(&k, data, sizeof(k));
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h ^= k;
+    h *= m;
+    data += 8;
+  }
+
+  switch (len & 7) {
+  case 7:
+    h ^= u64{data[6]} << 48;
+    [[fallthrough]];
+  case 6:
+    h ^= u64{data[5]} << 40;
+    [[fallthrough]];
+  case 5:
+    h ^= u64{data[4]} << 32;
+    [[fallthrough]];
+  case 4:
+    h ^= u64{data[3]} << 24;
+    [[fallthrough]];
+  case 3:
+    h ^= u64{data[2]} << 16;
+    [[fallthrough]];
+  case 2:
+    h ^= u64{data[1]} << 8;
+    [[fallthrough]];
+  case 1:
+    h ^= u64{data[0]};
+    h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
+// Register index and the run length of zeros (plus one) after the index
+// bits, capped at Q + 1 by a sentinel bit.
+static u8 pattern(const std::string &element, size_t &index) {
+  u64 hash = murmur_hash64a(element.data(), element.size(), 0xadc83b19ULL);
+  index = hash & (REGISTERS - 1);
+  hash >>= P;
+  hash |= u64{1} << Q;
+  return static_cast<u8>(__builtin_ctzll(hash) + 1);
+}
+
+static bool is_hll(std::string_view s) {
+  if (s.size() < HEADER_SIZE || std::memcmp(s.data(), "HYLL", 4) != 0) {
+    return false;
+  }
+  u8 encoding = static_cast<u8>(s[4]);
+  return (encoding == DENSE && s.size() == DENSE_SIZE) || encoding == SPARSE;
+}
+
+static void invalidate_cache(std::string &hll) {
+  hll[CARD_OFFSET + 7] = static_cast<char>(hll[CARD_OFFSET + 7] | 0x80);
+}
+
+// ---- dense ----
+
+static u8 *dense_registers(std::string &hll) {
+  return reinterpret_cast<u8 *>(hll.data()) + HEADER_SIZE;
+}
+
+// Register i occupies bits 6i..6i+5, least significant bit first; four
+// registers share three bytes, which is what dense_pack and max_packed6 step
+// over.
+static u8 dense_get(const u8 *p, size_t i) {
+  size_t byte = i * 6 / 8;
+  unsigned shift = i * 6 % 8;
+  unsigned bits = p[byte] >> shift;
+  if (shift > 2) {
+    bits |= static_cast<unsigned>(p[byte + 1]) << (8 - shift);
+  }
+  return static_cast<u8>(bits & REGISTER_MAX);
+}
+
+static void dense_set(u8 *p, size_t i, u8 value) {
+  size_t byte = i * 6 / 8;
+  unsigned shift = i * 6 % 8;
+  p[byte] = static_cast<u8>((p[byte] & ~(REGISTER_MAX << shift)) |
+                            (value << shift));
+  if (shift > 2) {
+    unsigned high = 8 - shift;
+    p[byte + 1] = static_cast<u8>((p[byte + 1] & ~(REGISTER_MAX >> high)) |
+                                  (value >> high));
+  }
+}
+
+static void dense_pack(const u8 *registers, u8 *p) {
+  for (size_t i = 0; i < REGISTERS; i += 4, p += 3) {
+    p[0] = static_cast<u8>(registers[i] | (registers[i + 1] << 6));
+    p[1] = static_cast<u8>((registers[i + 1] >> 2) | (registers[i + 2] << 4));
+    p[2] = static_cast<u8>((registers[i + 2] >> 4) | (registers[i + 3] << 2));
+  }
+}
+
+static std::string new_header(u8 encoding) {
+  std::string out(HEADER_SIZE, '\0');
+  std::memcpy(out.data(), "HYLL", 4);
+  out[4] = static_cast<char>(encoding);
+  return out;
+}
+
+std::string from_registers(const u8 *registers) {
+  std::string out = new_header(DENSE);
+  out.resize(DENSE_SIZE);
+  dense_pack(registers, dense_registers(out));
+  invalidate_cache(out);
+  return out;
+}
+
+// ---- sparse ----
+
+struct Run {
+  u8 value;
+  u16 length;
+};
+
+static bool sparse_decode(std::string_view hll, std::vector<Run> &runs) {
+  const auto *p = reinterpret_cast<const u8 *>(hll.data()) + HEADER_SIZE;
+  const u8 *end = reinterpret_cast<const u8 *>(hll.data()) + hll.size();
+  size_t total = 0;
+  runs.clear();
+  while (p < end) {
+    Run run;
+    if ((*p & 0xc0) == 0) {
+      run = {0, static_cast<u16>((*p & 0x3f) + 1)};
+      p++;
+    } else if ((*p & 0xc0) == OP_XZERO) {
+      if (p + 1 >= end) {
+        return false;
+      }
+      run = {0, static_cast<u16>((((*p & 0x3f) << 8) | p[1]) + 1)};
+      p += 2;
+    } else {
+      run = {static_cast<u8>(((*p >> 2) & 0x1f) + 1),
+             static_cast<u16>((*p & 0x3) + 1)};
+      p++;
+    }
+    total += run.length;
+    if (total > REGISTERS) {
+      return false;
+    }
+    runs.push_back(run);
+  }
+  return total == REGISTERS;
+}
+
+static std::string sparse_encode(const std::vector<Run> &runs) {
+  std::string out = new_header(SPARSE);
+  size_t i = 0;
+  while (i < runs.size()) {
+    u8 value = runs[i].value;
+    size_t length = 0;
+    for (; i < runs.size() && runs[i].value == value; i++) {
+      length += runs[i].length;
+    }
+    while (length > 0) {
+      size_t n;
+      if (value != 0) {
+        n = std::min<size_t>(length, 4);
+        out += static_cast<char>(OP_VAL | ((value - 1) << 2) | (n - 1));
+      } else if (length > 64) {
+        n = std::min<size_t>(length, REGISTERS);
+        out += static_cast<char>(OP_XZERO | ((n - 1) >> 8));
+        out += static_cast<char>((n - 1) & 0xff);
+      } else {
+        n = length;
+        out += static_cast<char>(n - 1);
+      }
+      length -= n;
+    }
+  }
+  return out;
+}
+
+// Raises register index to value within the run list; false if it was
+// already at least that high.
+static bool sparse_set(std::vector<Run> &runs, size_t index, u8 value) {
+  size_t start = 0;
+  size_t r = 0;
+  while (start + runs[r].length <= index) {
+    start += runs[r++].length;
+  }
+  if (runs[r].value >= value) {
+    return false;
+  }
+  Run old = runs[r];
+  size_t before = index - start;
+  size_t after = old.length - before - 1;
+  Run pieces[3];
+  size_t n = 0;
+  if (before) {
+    pieces[n++] = {old.value, static_cast<u16>(before)};
+  }
+  pieces[n++] = {value, 1};
+  if (after) {
+    pieces[n++] = {old.value, static_cast<u16>(after)};
+  }
+  runs[r] = pieces[0];
+  runs.insert(runs.begin() + r + 1, pieces + 1, pieces + n);
+  return true;
+}
+
+static void runs_to_registers(const std::vector<Run> &runs, u8 *registers) {
+  size_t i = 0;
+  for (const Run &run : runs) {
+    std::memset(registers + i, run.value, run.length);
+    i += run.length;
+  }
+}
+
+// ---- public ----
+
+std::string create() {
+  std::vector<Run> empty = {{0, static_cast<u16>(REGISTERS)}};
+  return sparse_encode(empty);
+}
+
+Status add(std::string &hll, std::span<const std::string> elements,
+           bool &changed, size_t sparse_max_bytes) {
+  changed = false;
+  if (!is_hll(hll)) {
+    return Status::NOT_HLL;
+  }
+
+  size_t next = 0;
+  if (hll[4] == SPARSE) {
+    std::vector<Run> runs;
+    if (!sparse_decode(hll, runs)) {
+      return Status::CORRUPT;
+    }
+    bool promote = false;
+    for (; next < elements.size(); next++) {
+      size_t index;
+      u8 value = pattern(elements[next], index);
+      if (value > SPARSE_VAL_MAX) {
+        promote = true;
+        break;
+      }
+      changed |= sparse_set(runs, index, value);
+    }
+    if (!promote) {
+      if (!changed) {
+        return Status::OK;
+      }
+      std::string encoded = sparse_encode(runs);
+      if (encoded.size() <= sparse_max_bytes) {
+        hll = std::move(encoded);
+        invalidate_cache(hll);
+        return Status::OK;
+      }
+    }
+    std::array<u8, REGISTERS> registers;
+    runs_to_registers(runs, registers.data());
+    hll = from_registers(registers.data());
+  }
+
+  u8 *p = dense_registers(hll);
+  for (; next < elements.size(); next++) {
+    size_t index;
+    u8 value = pattern(elements[next], index);
+    if (value > dense_get(p, index)) {
+      dense_set(p, index, value);
+      changed = true;
+    }
+  }
+  if (changed) {
+    invalidate_cache(hll);
+  }
+  return Status::OK;
+}
+
+Status merge_into(u8 *registers, std::string_view hll) {
+  return merge_into_with(active_scan_impl(), registers, hll);
+}
+
+Status merge_into_with(ScanImpl impl, u8 *registers, std::string_view hll) {
+  if (!is_hll(hll)) {
+    return Status::NOT_HLL;
+  }
+  if (hll[4] == DENSE) {
+    max_packed6_with(impl, registers,
+                     reinterpret_cast<const u8 *>(hll.data()) + HEADER_SIZE,
+                     REGISTERS);
+    return Status::OK;
+  }
+
+  std::vector<Run> runs;
+  if (!sparse_decode(hll, runs)) {
+    return Status::CORRUPT;
+  }
+  size_t i = 0;
+  for (const Run &run : runs) {
+    if (run.value) {
+      for (size_t k = i; k < i + run.length; k++) {
+        registers[k] = std::max(registers[k], run.value);
+      }
+    }
+    i += run.length;
+  }
+  return Status::OK;
+}
+
+// Ertl's improved estimator ("New cardinality estimation algorithms for
+// HyperLogLog sketches"), as used by Redis since 5.0: needs only the
+// histogram of register values and has no bias-correction tables.
+static double tau(double x) {
+  if (x == 0.0 || x == 1.0) {
+    return 0.0;
+  }
+  double y = 1.0;
+  double z = 1 - x;
+  double prev;
+  do {
+    x = std::sqrt(x);
+    prev = z;
+    y *= 0.5;
+    z -= std::pow(1 - x, 2) * y;
+  } while (prev != z);
+  return z / 3;
+}
+
+static double sigma(double x) {
+  if (x == 1.0) {
+    return INFINITY;
+  }
+  double y = 1.0;
+  double z = x;
+  double prev;
+  do {
+    x *= x;
+    prev = z;
+    z += x * y;
+    y += y;
+  } while (prev != z);
+  return z;
+}
+
+// Indexed by register value. Valid registers stop at Q + 1, but a dense
+// payload from elsewhere can hold anything up to 63.
+using Histogram = std::array<u32, REGISTER_MAX + 1>;
+
+static u64 count_histogram(const Histogram &histogram) {
+  constexpr double m = REGISTERS;
+  constexpr double alpha_inf = 0.721347520444481703680;
+  double z = m * tau((m - histogram[Q + 1]) / m);
+  for (int j = Q; j >= 1; j--) {
+    z += histogram[j];
+    z *= 0.5;
+  }
+  z += m * sigma(histogram[0] / m);
+  return static_cast<u64>(std::llround(alpha_inf * m * m / z));
+}
+
+u64 count_registers(const u8 *registers) {
+  Histogram histogram{};
+  for (size_t i = 0; i < REGISTERS; i++) {
+    histogram[registers[i]]++;
+  }
+  return count_histogram(histogram);
+}
+
+Status count(std::string &hll, u64 &result, bool &cache_updated) {
+  cache_updated = false;
+  if (!is_hll(hll)) {
+    return Status::NOT_HLL;
+  }
+  auto *card = reinterpret_cast<u8 *>(hll.data()) + CARD_OFFSET;
+  if (!(card[7] & 0x80)) {
+    result = 0;
+    for (int i = 7; i >= 0; i--) {
+      result = (result << 8) | card[i];
+    }
+    return Status::OK;
+  }
+
+  Histogram histogram{};
+  if (hll[4] == DENSE) {
+    std::array<u8, REGISTERS> registers{};
+    max_packed6(registers.data(), dense_registers(hll), REGISTERS);
+    for (u8 r : registers) {
+      histogram[r]++;
+    }
+  } else {
+    std::vector<Run> runs;
+    if (!sparse_decode(hll, runs)) {
+      return Status::CORRUPT;
+    }
+    for (const Run &run : runs) {
+      histogram[run.value] += run.length;
+    }
+  }
+  result = count_histogram(histogram);
+  for (int i = 0; i < 8; i++) {
+    card[i] = static_cast<u8>(result >> (8 * i));
+  }
+  cache_updated = true;
+  return Status::OK;
+}
+
+} // namespace Redis::hll
@@ -0,0 +1,55 @@
+#pragma once
+#include "common/types.hpp"
+#include "util/simd_scan.hpp"
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace Redis {
+
+// HyperLogLog in Redis' own layout: a 16-byte "HYLL" header (encoding plus
+// a cached cardinality) followed by 16384 6-bit registers, either packed
+// (dense, 12 KB) or run-length encoded (sparse, for small sets). It lives in
+// an ordinary string value, so GET, SET, DUMP and MIGRATE carry it as is and
+// payloads are interchangeable with Redis.
+namespace hll {
+
+constexpr int P = 14;
+constexpr size_t REGISTERS = size_t{1} << P;
+constexpr size_t HEADER_SIZE = 16;
+constexpr size_t DENSE_SIZE = HEADER_SIZE + REGISTERS * 6 / 8;
+// Redis' hll-sparse-max-bytes default.
+constexpr size_t SPARSE_MAX_BYTES = 3000;
+
+enum class Status {
+  OK,
+  NOT_HLL, // not a HyperLogLog string (WRONGTYPE in Redis)
+  CORRUPT, // HYLL header, but registers that do not decode (INVALIDOBJ)
+};
+
+// An empty sparse HyperLogLog.
+std::string create();
+
+// Adds elements, promoting a sparse value to dense once it outgrows
+// sparse_max_bytes or needs a register above the sparse maximum of 32.
+// changed reports whether any register moved (PFADD's reply).
+Status add(std::string &hll, std::span<const std::string> elements,
+           bool &changed, size_t sparse_max_bytes = SPARSE_MAX_BYTES);
+
+// Cardinality of one value, from the header cache when it is valid;
+// otherwise computed and written back into the cache (cache_updated).
+Status count(std::string &hll, u64 &result, bool &cache_updated);
+
+// Raises registers (one byte each, REGISTERS of them) to hll's, for PFCOUNT
+// over several keys and PFMERGE. Dense values go through the max_packed6
+// kernel without being unpacked first; _with picks its implementation, for
+// benchmarks.
+Status merge_into(u8 *registers, std::string_view hll);
+Status merge_into_with(ScanImpl impl, u8 *registers, std::string_view hll);
+// Cardinality estimate of unpacked registers.
+u64 count_registers(const u8 *registers);
+// A dense value with the given registers and an invalid cache.
+std::string from_registers(const u8 *registers);
+
+} // namespace hll
+} // namespace Redis
@@ -0,0 +1,41 @@
+#include "common/keyslot.hpp"
+#include <array>
+
+namespace Redis {
+
+static constexpr std::array<u16, 256> make_crc16_table() {
+  std::array<u16, 256> table{};
+  for (u16 i = 0; i < 256; i++) {
+    u16 crc = static_cast<u16>(i << 8);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? static_cast<u16>((crc << 1) ^ 0x1021)
+                           : static_cast<u16>(crc << 1);
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+static constexpr std::array<u16, 256> crc16_table = make_crc16_table();
+
+u16 crc16(const char *buf, size_t len) {
+  u16 crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    u8 byte = static_cast<u8>(buf[i]);
+    crc = static_cast<u16>((crc << 8) ^ crc16_table[((crc >> 8) ^ byte) & 0xff]);
+  }
+  return crc;
+}
+
+u16 key_hash_slot(std::string_view key) {
+  size_t open = key.find('{');
+  if (open != std::string_view::npos) {
+    size_t close = key.find('}', open + 1);
+    if (close != std::string_view::npos && close != open + 1) {
+      key = key.substr(open + 1, close - open - 1);
+    }
+  }
+  return crc16(key.data(), key.size()) & (CLUSTER_SLOTS - 1);
+}
+
+} // namespace Redis
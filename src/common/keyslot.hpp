@@ -0,0 +1,15 @@
+#pragma once
+#include "common/types.hpp"
+#include <string_view>
+
+namespace Redis {
+
+constexpr u16 CLUSTER_SLOTS = 16384;
+
+// CRC16-CCITT (XMODEM), the variant Redis Cluster uses for key hashing.
+u16 crc16(const char *buf, size_t len);
+
+// Slot of a key: CRC16 of the key, or of the first non-empty "{hashtag}".
+u16 key_hash_slot(std::string_view key);
+
+} // namespace Redis
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <deque>
 #include <string>
@@ -20,11 +21,21 @@ using f64 = double;
 
 namespace Redis {
 using RedisList = std::deque<std::string>;
-using RedisData = std::variant<std::string, RedisList>;
+// Strings that are canonical decimal integers are held as i64 so counters
+// update in place; both encodings are the Redis "string" type.
+using RedisData = std::variant<std::string, RedisList, i64>;
 
 struct Value {
+  static constexpr int VERSION_BITS = 40;
+  static constexpr u64 VERSION_MASK = (u64{1} << VERSION_BITS) - 1;
+
   RedisData data;
   i64 expires_at;
+  // One word of per-key metadata. Bits 0-39: write version for WATCH,
+  // bumped from the shard's clock. Bits 40-47: Redis-style logarithmic
+  // access counter; bits 48-63: minute of its last decay. Readers holding
+  // only the shared lock update the counter through std::atomic_ref.
+  mutable u64 meta = 0;
 
   explicit Value(RedisData d) : data(std::move(d)), expires_at(0) {}
 
@@ -32,7 +43,13 @@ struct Value {
 
   bool is_persistent() const { return expires_at <= 0; }
 
-  bool is_string() const { return std::holds_alternative<std::string>(data); }
+  u64 version() const {
+    return std::atomic_ref<u64>(meta).load(std::memory_order_relaxed) &
+           VERSION_MASK;
+  }
+
+  bool is_string() const { return !is_list(); }
+  bool is_int() const { return std::holds_alternative<i64>(data); }
   bool is_list() const {
     return std::holds_alternative<std::deque<std::string>>(data);
   }
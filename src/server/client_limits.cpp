@@ -0,0 +1,146 @@
+#include "server/client_limits.hpp"
+#include "util/simd_scan.hpp"
+#include <cctype>
+#include <format>
+#include <sstream>
+#include <vector>
+
+namespace Redis {
+
+static constexpr std::string_view CLASS_NAMES[] = {"normal", "replica",
+                                                   "pubsub"};
+
+bool parse_memory_amount(std::string_view s, u64 &out) {
+  size_t digits = 0;
+  while (digits < s.size() &&
+         std::isdigit(static_cast<unsigned char>(s[digits])))
+    digits++;
+  if (digits == 0)
+    return false;
+
+  std::string unit;
+  for (char c : s.substr(digits))
+    unit += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  u64 mul;
+  if (unit.empty() || unit == "b")
+    mul = 1;
+  else if (unit == "k")
+    mul = 1000;
+  else if (unit == "kb")
+    mul = 1024;
+  else if (unit == "m")
+    mul = 1000 * 1000;
+  else if (unit == "mb")
+    mul = 1024 * 1024;
+  else if (unit == "g")
+    mul = 1000 * 1000 * 1000;
+  else if (unit == "gb")
+    mul = 1024 * 1024 * 1024;
+  else
+    return false;
+
+  long long value;
+  if (!parse_int_fast(s.data(), digits, value) ||
+      __builtin_mul_overflow(static_cast<u64>(value), mul, &out))
+    return false;
+  return true;
+}
+
+static bool parse_class(std::string_view name, size_t &idx) {
+  std::string lower;
+  for (char c : name)
+    lower += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  if (lower == "slave")
+    lower = "replica";
+  for (size_t i = 0; i < std::size(CLASS_NAMES); i++) {
+    if (lower == CLASS_NAMES[i]) {
+      idx = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Defaults match redis.conf, except that normal clients and the total are
+// bounded too: a client that never reads its replies or tracking pushes
+// otherwise holds them forever. Both stay above the largest bulk reply
+// (512mb).
+ClientLimits::ClientLimits()
+    : query_limit_(u64{1} << 30), total_output_limit_(u64{2} << 30) {
+  output_[static_cast<size_t>(ClientClass::NORMAL)].hard = 1ULL << 30;
+  output_[static_cast<size_t>(ClientClass::REPLICA)].hard = 256ULL << 20;
+  output_[static_cast<size_t>(ClientClass::REPLICA)].soft = 64ULL << 20;
+  output_[static_cast<size_t>(ClientClass::REPLICA)].soft_seconds = 60;
+  output_[static_cast<size_t>(ClientClass::PUBSUB)].hard = 32ULL << 20;
+  output_[static_cast<size_t>(ClientClass::PUBSUB)].soft = 8ULL << 20;
+  output_[static_cast<size_t>(ClientClass::PUBSUB)].soft_seconds = 60;
+}
+
+OutputLimit ClientLimits::output_limit(ClientClass cls) const {
+  const AtomicLimit &l = output_[static_cast<size_t>(cls)];
+  return {l.hard.load(std::memory_order_relaxed),
+          l.soft.load(std::memory_order_relaxed),
+          l.soft_seconds.load(std::memory_order_relaxed)};
+}
+
+bool ClientLimits::set_output_limits(std::string_view spec) {
+  std::istringstream in{std::string(spec)};
+  std::vector<std::string> words;
+  for (std::string w; in >> w;)
+    words.push_back(std::move(w));
+  if (words.empty() || words.size() % 4 != 0)
+    return false;
+
+  std::vector<std::pair<size_t, OutputLimit>> parsed;
+  for (size_t i = 0; i < words.size(); i += 4) {
+    size_t idx;
+    OutputLimit l;
+    long long seconds;
+    if (!parse_class(words[i], idx) ||
+        !parse_memory_amount(words[i + 1], l.hard) ||
+        !parse_memory_amount(words[i + 2], l.soft) ||
+        !parse_int_fast(words[i + 3].data(), words[i + 3].size(), seconds) ||
+        seconds < 0)
+      return false;
+    l.soft_seconds = static_cast<u64>(seconds);
+    parsed.emplace_back(idx, l);
+  }
+  for (const auto &[idx, l] : parsed) {
+    output_[idx].hard.store(l.hard);
+    output_[idx].soft.store(l.soft);
+    output_[idx].soft_seconds.store(l.soft_seconds);
+  }
+  return true;
+}
+
+std::string ClientLimits::output_limits_string() const {
+  std::string out;
+  for (size_t i = 0; i < CLASS_COUNT; i++) {
+    OutputLimit l = output_limit(static_cast<ClientClass>(i));
+    if (!out.empty())
+      out += ' ';
+    out += std::format("{} {} {} {}", CLASS_NAMES[i], l.hard, l.soft,
+                       l.soft_seconds);
+  }
+  return out;
+}
+
+// Like Redis, the soft limit only closes a client that is still over it after
+// soft_seconds; the first check over it just starts the clock.
+bool ClientLimits::output_over_limit(ClientClass cls, u64 pending,
+                                     i64 now_ms, i64 &soft_since) const {
+  OutputLimit l = output_limit(cls);
+  if (l.hard && pending >= l.hard)
+    return true;
+  if (!l.soft || pending < l.soft) {
+    soft_since = 0;
+    return false;
+  }
+  if (soft_since == 0) {
+    soft_since = now_ms;
+    return false;
+  }
+  return now_ms - soft_since > static_cast<i64>(l.soft_seconds * 1000);
+}
+
+} // namespace Redis
@@ -0,0 +1,110 @@
+#pragma once
+#include "common/types.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace Redis {
+
+// Redis' client-output-buffer-limit classes. Every connection here is
+// NORMAL (there is no pub/sub or replication), but all three are accepted so
+// that existing redis.conf lines apply unchanged.
+enum class ClientClass { NORMAL, REPLICA, PUBSUB };
+
+struct OutputLimit {
+  u64 hard = 0;         // bytes, 0 = none
+  u64 soft = 0;         // bytes, 0 = none
+  u64 soft_seconds = 0; // how long soft may be exceeded continuously
+};
+
+// Parses "100", "64kb", "1gb" etc. with Redis' units (k = 1000, kb = 1024).
+bool parse_memory_amount(std::string_view s, u64 &out);
+
+// Per-connection buffer limits, read lock-free from every connection thread.
+class ClientLimits {
+public:
+  ClientLimits();
+
+  u64 query_buffer_limit() const {
+    return query_limit_.load(std::memory_order_relaxed);
+  }
+  void set_query_buffer_limit(u64 bytes) { query_limit_.store(bytes); }
+
+  // maxmemory-clients: budget for pending output summed over all clients,
+  // 0 = none. Defaults to 2gb.
+  u64 total_output_limit() const {
+    return total_output_limit_.load(std::memory_order_relaxed);
+  }
+  void set_total_output_limit(u64 bytes) { total_output_limit_.store(bytes); }
+
+  OutputLimit output_limit(ClientClass cls) const;
+  // "class hard soft seconds [class hard soft seconds ...]" as in CONFIG SET;
+  // nothing changes unless the whole spec is valid.
+  bool set_output_limits(std::string_view spec);
+  std::string output_limits_string() const;
+
+  // True if a client holding pending output bytes has to be closed. soft_since
+  // is the caller's record of when the soft limit was first exceeded (0 when
+  // under it) and is updated here.
+  bool output_over_limit(ClientClass cls, u64 pending, i64 now_ms,
+                         i64 &soft_since) const;
+
+private:
+  static constexpr size_t CLASS_COUNT = 3;
+  struct AtomicLimit {
+    std::atomic<u64> hard{0};
+    std::atomic<u64> soft{0};
+    std::atomic<u64> soft_seconds{0};
+  };
+
+  std::atomic<u64> query_limit_;
+  std::atomic<u64> total_output_limit_;
+  std::array<AtomicLimit, CLASS_COUNT> output_;
+};
+
+// Output bytes handed to send() and not yet written, summed over every
+// connection. Connection threads paused for backpressure sleep here and are
+// woken as output drains; the wake-up costs a drained send one atomic load
+// unless someone is actually waiting.
+class OutputPressure {
+public:
+  void add(u64 bytes) { total_.fetch_add(bytes); }
+  void release(u64 bytes) {
+    total_.fetch_sub(bytes);
+    notify_waiters();
+  }
+  // For a waiter's condition that changed without a release.
+  void notify_waiters() {
+    if (waiters_.load() > 0)
+      wake_all();
+  }
+  u64 total() const { return total_.load(std::memory_order_relaxed); }
+
+  // Blocks while paused() holds. It is rechecked after every release and at
+  // least every 100 ms, for conditions that change without one (a limit
+  // raised by CONFIG SET, the server stopping).
+  template <typename Pred> void wait_while(Pred paused) {
+    std::unique_lock lock(mtx_);
+    waiters_++;
+    while (paused())
+      cv_.wait_for(lock, std::chrono::milliseconds(100));
+    waiters_--;
+  }
+
+  void wake_all() {
+    std::lock_guard lock(mtx_);
+    cv_.notify_all();
+  }
+
+private:
+  std::atomic<u64> total_{0};
+  std::atomic<int> waiters_{0};
+  std::mutex mtx_;
+  std::condition_variable cv_;
+};
+
+} // namespace Redis
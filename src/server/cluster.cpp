@@ -0,0 +1,224 @@
+#include "server/cluster.hpp"
+#include "common/concurrent_store.hpp"
+#include "util/RESP.hpp"
+#include <format>
+#include <mutex>
+#include <random>
+
+namespace Redis {
+
+static std::string random_node_id() {
+  static const char hex[] = "0123456789abcdef";
+  std::random_device rd;
+  std::string id(40, '0');
+  for (auto &c : id) {
+    c = hex[rd() % 16];
+  }
+  return id;
+}
+
+ClusterState::ClusterState(std::string host, int port) {
+  nodes_.push_back({.id = random_node_id(), .host = std::move(host),
+                    .port = port});
+  owner_.fill(-1);
+}
+
+ClusterNode ClusterState::myself() const {
+  std::shared_lock lock(mtx_);
+  return nodes_[0];
+}
+
+i32 ClusterState::node_index(const std::string &id) const {
+  for (size_t i = 0; i < nodes_.size(); i++) {
+    if (nodes_[i].id == id) {
+      return static_cast<i32>(i);
+    }
+  }
+  return -1;
+}
+
+std::optional<ClusterNode>
+ClusterState::find_node(const std::string &id) const {
+  std::shared_lock lock(mtx_);
+  i32 idx = node_index(id);
+  if (idx < 0) {
+    return std::nullopt;
+  }
+  return nodes_[idx];
+}
+
+void ClusterState::add_node(ClusterNode node) {
+  std::unique_lock lock(mtx_);
+  i32 idx = node_index(node.id);
+  if (idx >= 0) {
+    nodes_[idx] = std::move(node);
+  } else {
+    nodes_.push_back(std::move(node));
+  }
+}
+
+bool ClusterState::assign_slot(u16 slot, const std::string &node_id) {
+  std::unique_lock lock(mtx_);
+  i32 idx = node_index(node_id);
+  if (idx < 0 || slot >= CLUSTER_SLOTS) {
+    return false;
+  }
+  owner_[slot] = idx;
+  // Taking ownership ends the migration on both sides.
+  migrating_.erase(slot);
+  importing_.erase(slot);
+  return true;
+}
+
+bool ClusterState::unassign_slot(u16 slot) {
+  std::unique_lock lock(mtx_);
+  if (slot >= CLUSTER_SLOTS || owner_[slot] < 0) {
+    return false;
+  }
+  owner_[slot] = -1;
+  return true;
+}
+
+bool ClusterState::set_migrating(u16 slot, const std::string &node_id) {
+  std::unique_lock lock(mtx_);
+  i32 idx = node_index(node_id);
+  if (idx < 0 || slot >= CLUSTER_SLOTS || owner_[slot] != 0) {
+    return false;
+  }
+  migrating_[slot] = idx;
+  return true;
+}
+
+bool ClusterState::set_importing(u16 slot, const std::string &node_id) {
+  std::unique_lock lock(mtx_);
+  i32 idx = node_index(node_id);
+  if (idx < 0 || slot >= CLUSTER_SLOTS || owner_[slot] == 0) {
+    return false;
+  }
+  importing_[slot] = idx;
+  return true;
+}
+
+void ClusterState::set_stable(u16 slot) {
+  std::unique_lock lock(mtx_);
+  migrating_.erase(slot);
+  importing_.erase(slot);
+}
+
+ClusterState::Route ClusterState::route(u16 slot) const {
+  std::shared_lock lock(mtx_);
+  i32 owner = owner_[slot];
+
+  if (owner == 0) {
+    auto it = migrating_.find(slot);
+    if (it != migrating_.end()) {
+      return {RouteKind::MIGRATING, nodes_[it->second]};
+    }
+    return {RouteKind::LOCAL, {}};
+  }
+
+  auto it = importing_.find(slot);
+  if (it != importing_.end()) {
+    return {RouteKind::IMPORTING, nodes_[it->second]};
+  }
+  if (owner < 0) {
+    return {RouteKind::UNASSIGNED, {}};
+  }
+  return {RouteKind::MOVED, nodes_[owner]};
+}
+
+std::vector<std::tuple<u16, u16, ClusterNode>>
+ClusterState::slot_ranges() const {
+  std::shared_lock lock(mtx_);
+  std::vector<std::tuple<u16, u16, ClusterNode>> ranges;
+  u32 slot = 0;
+  while (slot < CLUSTER_SLOTS) {
+    i32 owner = owner_[slot];
+    u32 end = slot;
+    while (end + 1 < CLUSTER_SLOTS && owner_[end + 1] == owner) {
+      end++;
+    }
+    if (owner >= 0) {
+      ranges.emplace_back(slot, end, nodes_[owner]);
+    }
+    slot = end + 1;
+  }
+  return ranges;
+}
+
+std::string ClusterState::nodes_description() const {
+  auto ranges = slot_ranges();
+  std::shared_lock lock(mtx_);
+  std::string out;
+  for (size_t i = 0; i < nodes_.size(); i++) {
+    const ClusterNode &node = nodes_[i];
+    out += std::format("{} {}:{}@{} {} - 0 0 0 connected", node.id, node.host,
+                       node.port, node.port + 10000,
+                       i == 0 ? "myself,master" : "master");
+    for (const auto &[start, end, owner] : ranges) {
+      if (owner.id != node.id)
+        continue;
+      out += start == end ? std::format(" {}", start)
+                          : std::format(" {}-{}", start, end);
+    }
+    if (i == 0) {
+      for (const auto &[slot, idx] : migrating_) {
+        out += std::format(" [{}->-{}]", slot, nodes_[idx].id);
+      }
+      for (const auto &[slot, idx] : importing_) {
+        out += std::format(" [{}-<-{}]", slot, nodes_[idx].id);
+      }
+    }
+    out += "\n";
+  }
+  return out;
+}
+
+std::string ClusterState::info() const {
+  std::shared_lock lock(mtx_);
+  u32 assigned = 0;
+  for (i32 owner : owner_) {
+    if (owner >= 0)
+      assigned++;
+  }
+  return std::format("cluster_enabled:1\r\ncluster_state:{}\r\n"
+                     "cluster_slots_assigned:{}\r\ncluster_known_nodes:{}\r\n",
+                     assigned == CLUSTER_SLOTS ? "ok" : "fail", assigned,
+                     nodes_.size());
+}
+
+std::string dump_payload(const RedisData &data) {
+  RESP r;
+  if (const auto *str = std::get_if<std::string>(&data)) {
+    r = {.resp_type = RESP::type::BULK_STRING, .str = *str};
+  } else if (const auto *n = std::get_if<i64>(&data)) {
+    r = {.resp_type = RESP::type::BULK_STRING, .str = std::to_string(*n)};
+  } else {
+    r = {.resp_type = RESP::type::ARRAY};
+    for (const auto &item : std::get<RedisList>(data)) {
+      r.elements.push_back({.resp_type = RESP::type::BULK_STRING, .str = item});
+    }
+  }
+  return serialize_RESP(r);
+}
+
+std::optional<RedisData> restore_payload(const std::string &payload) {
+  try {
+    size_t pos = 0;
+    RESP r = parse_RESP(payload, pos);
+    if (r.resp_type == RESP::type::BULK_STRING && !r.is_null) {
+      return encode_string(std::move(r.str));
+    }
+    if (r.resp_type == RESP::type::ARRAY && !r.is_null) {
+      RedisList list;
+      for (auto &item : r.elements) {
+        list.push_back(std::move(item.str));
+      }
+      return RedisData{std::move(list)};
+    }
+  } catch (...) {
+  }
+  return std::nullopt;
+}
+
+} // namespace Redis
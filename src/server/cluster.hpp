@@ -0,0 +1,68 @@
+#pragma once
+#include "common/keyslot.hpp"
+#include "common/types.hpp"
+#include <array>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace Redis {
+
+struct ClusterNode {
+  std::string id;
+  std::string host;
+  int port;
+
+  std::string addr() const { return host + ":" + std::to_string(port); }
+};
+
+// Slot ownership as this node sees it. There is no cluster bus: topology is
+// pushed to every node by an operator (CLUSTER MEET/ADDSLOTS/SETSLOT), the
+// way redis-cli --cluster drives a fresh cluster.
+class ClusterState {
+public:
+  enum class RouteKind { LOCAL, MIGRATING, IMPORTING, MOVED, UNASSIGNED };
+  struct Route {
+    RouteKind kind;
+    ClusterNode target;
+  };
+
+  ClusterState(std::string host, int port);
+
+  ClusterNode myself() const;
+  std::optional<ClusterNode> find_node(const std::string &id) const;
+  void add_node(ClusterNode node);
+
+  bool assign_slot(u16 slot, const std::string &node_id);
+  bool unassign_slot(u16 slot);
+  bool set_migrating(u16 slot, const std::string &node_id);
+  bool set_importing(u16 slot, const std::string &node_id);
+  void set_stable(u16 slot);
+
+  // MIGRATING/IMPORTING carry the other side of the migration in target;
+  // MOVED carries the owner.
+  Route route(u16 slot) const;
+
+  std::vector<std::tuple<u16, u16, ClusterNode>> slot_ranges() const;
+  std::string nodes_description() const;
+  std::string info() const;
+
+private:
+  i32 node_index(const std::string &id) const;
+
+  mutable std::shared_mutex mtx_;
+  std::vector<ClusterNode> nodes_; // nodes_[0] is this node
+  std::array<i32, CLUSTER_SLOTS> owner_;
+  std::unordered_map<u16, i32> migrating_;
+  std::unordered_map<u16, i32> importing_;
+};
+
+// MIGRATE/RESTORE payload: the value itself, RESP encoded. restore_payload
+// returns nullopt for anything dump_payload could not have produced.
+std::string dump_payload(const RedisData &data);
+std::optional<RedisData> restore_payload(const std::string &payload);
+
+} // namespace Redis
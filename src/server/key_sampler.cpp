@@ -0,0 +1,76 @@
+#include "server/key_sampler.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+namespace Redis {
+
+u64 KeySampler::score(const KeySample &s, Metric metric) {
+  switch (metric) {
+  case Metric::FREQ:
+    return s.frequency;
+  case Metric::MEMORY:
+    return s.memory;
+  case Metric::ELEMENTS:
+    return s.elements;
+  }
+  return 0;
+}
+
+// Boards are a few dozen entries, sorted best first; a linear insert is
+// cheaper than keeping a heap per metric.
+void KeySampler::offer(Board &board, Metric metric,
+                       const KeySample &s) const {
+  u64 value = score(s, metric);
+  if (board.size() == top_n_ && value <= score(board.back(), metric))
+    return;
+  auto pos = std::find_if(board.begin(), board.end(), [&](const KeySample &b) {
+    return score(b, metric) < value;
+  });
+  board.insert(pos, s);
+  if (board.size() > top_n_)
+    board.pop_back();
+}
+
+void KeySampler::step(const ConcurrentStore &store, size_t count) {
+  batch_.clear();
+  cursor_ = store.sample(cursor_, count, batch_);
+
+  std::lock_guard lock(mtx_);
+  for (const KeySample &s : batch_) {
+    for (size_t m = 0; m < METRIC_COUNT; m++)
+      offer(current_[m], static_cast<Metric>(m), s);
+  }
+  if (cursor_ == 0) {
+    last_ = std::move(current_);
+    current_ = {};
+    passes_++;
+  }
+}
+
+std::vector<KeySample> KeySampler::top(Metric metric, size_t n) const {
+  std::vector<KeySample> out;
+  {
+    std::lock_guard lock(mtx_);
+    const Board &current = current_[static_cast<size_t>(metric)];
+    const Board &last = last_[static_cast<size_t>(metric)];
+    out.reserve(current.size() + last.size());
+    std::unordered_set<std::string_view> seen;
+    for (const KeySample &s : current) {
+      seen.insert(s.key);
+      out.push_back(s);
+    }
+    for (const KeySample &s : last) {
+      if (!seen.contains(s.key))
+        out.push_back(s);
+    }
+  }
+  std::stable_sort(out.begin(), out.end(),
+                   [&](const KeySample &a, const KeySample &b) {
+                     return score(a, metric) > score(b, metric);
+                   });
+  if (out.size() > n)
+    out.resize(n);
+  return out;
+}
+
+} // namespace Redis
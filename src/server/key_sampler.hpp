@@ -0,0 +1,47 @@
+#pragma once
+#include "common/concurrent_store.hpp"
+#include "common/types.hpp"
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace Redis {
+
+// Background hot/big key finder. Each step() walks one SCAN slice of the
+// keyspace, so no shard lock is held for longer than a SCAN call holds it,
+// and keeps the top keys seen by access frequency, memory and element count.
+// A full pass takes keys / slice steps; the board from the previous pass is
+// kept so results do not empty out when a new pass starts.
+class KeySampler {
+public:
+  enum class Metric { FREQ, MEMORY, ELEMENTS };
+  static constexpr size_t METRIC_COUNT = 3;
+
+  explicit KeySampler(size_t top_n = 32) : top_n_(top_n) {}
+
+  // Maintenance thread only.
+  void step(const ConcurrentStore &store, size_t count);
+
+  // Best n keys by metric across the current and previous pass; a key in
+  // both is reported as it was seen most recently.
+  std::vector<KeySample> top(Metric metric, size_t n) const;
+  u64 passes() const { return passes_.load(std::memory_order_relaxed); }
+
+private:
+  using Board = std::vector<KeySample>;
+
+  static u64 score(const KeySample &s, Metric metric);
+  void offer(Board &board, Metric metric, const KeySample &s) const;
+
+  size_t top_n_;
+  u64 cursor_ = 0;
+  std::vector<KeySample> batch_;
+  std::atomic<u64> passes_{0};
+
+  mutable std::mutex mtx_;
+  std::array<Board, METRIC_COUNT> current_;
+  std::array<Board, METRIC_COUNT> last_;
+};
+
+} // namespace Redis
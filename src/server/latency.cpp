@@ -0,0 +1,119 @@
+#include "server/latency.hpp"
+#include <algorithm>
+#include <chrono>
+#include <format>
+
+namespace Redis {
+
+static i64 get_unix_seconds() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+void LatencyMonitor::add_sample(const std::string &event, u64 latency_ms) {
+  i64 now = get_unix_seconds();
+  std::lock_guard lock(mtx_);
+  LatencyEvent &ev = events_[event];
+
+  // Samples within the same second are folded into one, keeping the worst.
+  if (ev.count > 0 && ev.latest().timestamp == now) {
+    LatencySample &last = ev.samples[(ev.next + LatencyEvent::HISTORY_LEN - 1) %
+                                     LatencyEvent::HISTORY_LEN];
+    last.latency_ms = std::max(last.latency_ms, latency_ms);
+  } else {
+    ev.samples[ev.next] = {.timestamp = now, .latency_ms = latency_ms};
+    ev.next = (ev.next + 1) % LatencyEvent::HISTORY_LEN;
+    ev.count = std::min(ev.count + 1, LatencyEvent::HISTORY_LEN);
+  }
+  ev.max_ms = std::max(ev.max_ms, latency_ms);
+}
+
+std::vector<std::pair<std::string, LatencyEvent>>
+LatencyMonitor::latest() const {
+  std::lock_guard lock(mtx_);
+  std::vector<std::pair<std::string, LatencyEvent>> out(events_.begin(),
+                                                        events_.end());
+  std::sort(out.begin(), out.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+  return out;
+}
+
+// Oldest sample first.
+std::vector<LatencySample>
+LatencyMonitor::history(const std::string &event) const {
+  std::lock_guard lock(mtx_);
+  std::vector<LatencySample> out;
+  auto it = events_.find(event);
+  if (it == events_.end()) {
+    return out;
+  }
+  const LatencyEvent &ev = it->second;
+  out.reserve(ev.count);
+  for (size_t i = ev.count; i > 0; i--) {
+    out.push_back(ev.samples[(ev.next + LatencyEvent::HISTORY_LEN - i) %
+                             LatencyEvent::HISTORY_LEN]);
+  }
+  return out;
+}
+
+// Resets the named events, or every event when none are given.
+size_t LatencyMonitor::reset(const std::vector<std::string> &events) {
+  std::lock_guard lock(mtx_);
+  if (events.empty()) {
+    size_t n = events_.size();
+    events_.clear();
+    return n;
+  }
+  size_t n = 0;
+  for (const auto &event : events) {
+    n += events_.erase(event);
+  }
+  return n;
+}
+
+std::string LatencyMonitor::doctor() const {
+  auto events = latest();
+  u64 threshold = threshold_ms_.load();
+
+  if (threshold == 0) {
+    return "Latency monitoring is disabled. Enable it with "
+           "CONFIG SET latency-monitor-threshold <milliseconds>.\n";
+  }
+  if (events.empty()) {
+    return std::format("No latency spikes above {} ms were observed.\n",
+                       threshold);
+  }
+
+  std::string out = std::format(
+      "Latency spikes above {} ms were observed for these events:\n\n",
+      threshold);
+  int n = 1;
+  for (const auto &[name, ev] : events) {
+    u64 sum = 0;
+    for (const auto &sample : history(name)) {
+      sum += sample.latency_ms;
+    }
+    out += std::format("{}. {}: {} latency spikes (average {} ms). Worst all "
+                       "time event {} ms.\n",
+                       n++, name, ev.count, ev.count ? sum / ev.count : 0,
+                       ev.max_ms);
+  }
+
+  for (const auto &[name, ev] : events) {
+    if (name == "command") {
+      out += "\n- Slow commands are being executed. Check SLOWLOG GET for the "
+             "offending commands and their arguments.\n";
+    } else if (name == "expire-cycle") {
+      out += "\n- The active expire cycle is taking long. Many keys may be "
+             "expiring at the same time.\n";
+    } else if (name == "rehash") {
+      out += "\n- Background rehashing of a shard's hash table is taking "
+             "long. Writes to that shard wait while a batch of buckets is "
+             "moved.\n";
+    }
+  }
+  return out;
+}
+
+} // namespace Redis
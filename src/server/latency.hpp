@@ -0,0 +1,62 @@
+#pragma once
+#include "common/types.hpp"
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Redis {
+
+struct LatencySample {
+  i64 timestamp;
+  u64 latency_ms;
+};
+
+struct LatencyEvent {
+  static constexpr size_t HISTORY_LEN = 160;
+
+  std::array<LatencySample, HISTORY_LEN> samples{};
+  size_t next = 0;
+  size_t count = 0;
+  u64 max_ms = 0;
+
+  const LatencySample &latest() const {
+    return samples[(next + HISTORY_LEN - 1) % HISTORY_LEN];
+  }
+};
+
+// Event-level latency spikes (expire cycles, slow commands, ...) kept as a
+// short per-event history, like LATENCY LATEST/HISTORY/DOCTOR in Redis.
+// Disabled while the threshold is 0.
+class LatencyMonitor {
+public:
+  bool should_record(u64 latency_ms) const {
+    u64 threshold = threshold_ms_.load(std::memory_order_relaxed);
+    return threshold > 0 && latency_ms >= threshold;
+  }
+
+  void add_sample_if_needed(const std::string &event, u64 latency_ms) {
+    if (should_record(latency_ms)) {
+      add_sample(event, latency_ms);
+    }
+  }
+
+  void add_sample(const std::string &event, u64 latency_ms);
+
+  std::vector<std::pair<std::string, LatencyEvent>> latest() const;
+  std::vector<LatencySample> history(const std::string &event) const;
+  size_t reset(const std::vector<std::string> &events);
+  std::string doctor() const;
+
+  u64 threshold() const { return threshold_ms_.load(); }
+  void set_threshold(u64 ms) { threshold_ms_.store(ms); }
+
+private:
+  std::atomic<u64> threshold_ms_{0};
+  mutable std::mutex mtx_;
+  std::unordered_map<std::string, LatencyEvent> events_;
+};
+
+} // namespace Redis
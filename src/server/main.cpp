@@ -1,16 +1,24 @@
 #include "server/tcp_server.hpp"
 #include <iostream>
+#include <string>
 #include <thread>
 
 int main(int argc, char **argv) {
   int port = 6379;
-  if (argc > 1)
-    port = std::stoi(argv[1]);
+  bool cluster_enabled = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--cluster-enabled")
+      cluster_enabled = true;
+    else
+      port = std::stoi(arg);
+  }
 
-  Redis::TCPServer server("0.0.0.0", port);
+  Redis::TCPServer server("0.0.0.0", port, cluster_enabled);
   std::thread t([&]() { server.start(); });
 
-  std::cout << "Redis clone running on port " << port << "...\n";
+  std::cout << "Redis clone running on port " << port
+            << (cluster_enabled ? " (cluster mode)" : "") << "...\n";
   t.join();
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,141 @@
+#include "server/request_reader.hpp"
+#include "util/RESP.hpp"
+#include "util/simd_scan.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Redis {
+
+static constexpr size_t COMPACT_THRESHOLD = 64 * 1024;
+// An unterminated header longer than this is garbage, not a slow client.
+static constexpr size_t MAX_HEADER_LEN = 64;
+
+std::span<char> RequestReader::direct_buffer() {
+  if (state_ != State::BIG_DATA || big_filled_ == bulk_len_) {
+    return {};
+  }
+  std::string &arg = args_.back();
+  return {arg.data() + big_filled_, bulk_len_ - big_filled_};
+}
+
+void RequestReader::direct_commit(size_t n) { big_filled_ += n; }
+
+void RequestReader::feed(const char *data, size_t len) {
+  if (pos_ == buf_.size()) {
+    buf_.clear();
+    pos_ = 0;
+  } else if (pos_ > COMPACT_THRESHOLD) {
+    buf_.erase(0, pos_);
+    pos_ = 0;
+  }
+  buf_.append(data, len);
+}
+
+bool RequestReader::read_header(char prefix, long long &value) {
+  size_t avail = buf_.size() - pos_;
+  size_t eol = find_crlf(buf_.data() + pos_, avail);
+  if (eol == std::string::npos) {
+    if (avail > MAX_HEADER_LEN) {
+      throw std::runtime_error("too big header");
+    }
+    return false;
+  }
+  if (buf_[pos_] != prefix) {
+    throw std::runtime_error(std::string("expected '") + prefix + "', got '" +
+                             buf_[pos_] + "'");
+  }
+  if (!parse_int_fast(buf_.data() + pos_ + 1, eol - 1, value)) {
+    throw std::runtime_error("invalid length");
+  }
+  pos_ += eol + 2;
+  return true;
+}
+
+bool RequestReader::next(std::vector<std::string> &tokens) {
+  if (pending_bytes() > limit_) {
+    throw QueryBufferLimitError("query buffer limit exceeded");
+  }
+  while (true) {
+    switch (state_) {
+    case State::ARRAY_HEADER: {
+      long long count;
+      if (!read_header('*', count)) {
+        return false;
+      }
+      if (count > MAX_ARRAY_COUNT) {
+        throw std::runtime_error("invalid multibulk length");
+      }
+      if (count <= 0) {
+        continue;
+      }
+      remaining_args_ = count;
+      args_.clear();
+      args_.reserve(static_cast<size_t>(count));
+      arg_bytes_ = 0;
+      state_ = State::BULK_HEADER;
+      break;
+    }
+    case State::BULK_HEADER: {
+      long long len;
+      if (!read_header('$', len)) {
+        return false;
+      }
+      if (len < 0 || len > MAX_BULK_LEN) {
+        throw std::runtime_error("invalid bulk length");
+      }
+      bulk_len_ = static_cast<size_t>(len);
+      if (arg_bytes_ + bulk_len_ > limit_) {
+        throw QueryBufferLimitError("query buffer limit exceeded");
+      }
+      if (bulk_len_ >= BIG_ARG) {
+        // Sized once up front; whatever is already buffered is moved in and
+        // the rest is received in place.
+        args_.emplace_back().resize(bulk_len_);
+        big_filled_ = std::min(bulk_len_, buf_.size() - pos_);
+        std::memcpy(args_.back().data(), buf_.data() + pos_, big_filled_);
+        pos_ += big_filled_;
+        state_ = State::BIG_DATA;
+      } else {
+        state_ = State::BULK_DATA;
+      }
+      break;
+    }
+    case State::BULK_DATA:
+    case State::BIG_DATA: {
+      bool big = state_ == State::BIG_DATA;
+      size_t need = big ? 2 : bulk_len_ + 2;
+      if (big && big_filled_ < bulk_len_) {
+        return false;
+      }
+      if (buf_.size() - pos_ < need) {
+        return false;
+      }
+      if (buf_[pos_ + need - 2] != '\r' || buf_[pos_ + need - 1] != '\n') {
+        throw std::runtime_error("bulk string missing trailing CRLF");
+      }
+      if (!big) {
+        args_.emplace_back(buf_, pos_, bulk_len_);
+      }
+      pos_ += need;
+      arg_bytes_ += bulk_len_;
+      state_ = State::BULK_HEADER;
+      if (--remaining_args_ == 0) {
+        state_ = State::ARRAY_HEADER;
+        tokens.swap(args_);
+        args_.clear();
+        arg_bytes_ = 0;
+        return true;
+      }
+      break;
+    }
+    }
+  }
+}
+
+size_t RequestReader::pending_bytes() const {
+  size_t big = state_ == State::BIG_DATA ? big_filled_ : 0;
+  return buf_.size() - pos_ + arg_bytes_ + big;
+}
+
+} // namespace Redis
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Redis {
+
+// Thrown by RequestReader::next() when a client exceeds the query buffer
+// limit; unlike a protocol error, the connection is closed without a reply.
+class QueryBufferLimitError : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+// Incremental parser for client requests (arrays of bulk strings). Small
+// arguments are parsed out of a connection buffer. A bulk argument of at
+// least BIG_ARG bytes instead gets a string sized to its final length, and
+// the caller reads the socket straight into it through direct_buffer(), so a
+// large SET holds one copy of its payload rather than four.
+class RequestReader {
+public:
+  static constexpr size_t BIG_ARG = 32 * 1024;
+
+  // Unfilled tail of the large argument being received, or an empty span
+  // when input should go through feed().
+  std::span<char> direct_buffer();
+  void direct_commit(size_t n);
+
+  void feed(const char *data, size_t len);
+
+  // Moves the next complete command into tokens. Returns false if more input
+  // is needed; throws std::runtime_error on malformed input.
+  bool next(std::vector<std::string> &tokens);
+
+  // Bytes held for the command being assembled, large arguments included.
+  size_t pending_bytes() const;
+
+  // client-query-buffer-limit: next() throws QueryBufferLimitError once
+  // pending_bytes() exceeds it or a bulk header announces an argument that
+  // would, so an unterminated huge argument is refused before it is
+  // allocated.
+  void set_limit(size_t bytes) { limit_ = bytes; }
+
+private:
+  enum class State { ARRAY_HEADER, BULK_HEADER, BULK_DATA, BIG_DATA };
+
+  bool read_header(char prefix, long long &value);
+
+  std::string buf_;
+  size_t pos_ = 0;
+
+  State state_ = State::ARRAY_HEADER;
+  long long remaining_args_ = 0;
+  size_t bulk_len_ = 0;
+  size_t big_filled_ = 0;
+  size_t arg_bytes_ = 0;
+  size_t limit_ = SIZE_MAX;
+  std::vector<std::string> args_;
+};
+
+} // namespace Redis
@@ -0,0 +1,99 @@
+#include "server/slowlog.hpp"
+#include <algorithm>
+#include <chrono>
+#include <format>
+
+namespace Redis {
+
+SlowLog::SlowLog(i64 slower_than_us, size_t max_len)
+    : slower_than_us_(slower_than_us), max_len_(max_len) {}
+
+void SlowLog::capture(const std::vector<std::string> &tokens,
+                      std::vector<std::string> &argv) {
+  size_t argc = std::min(tokens.size(), MAX_ARGC);
+  argv.resize(argc);
+  for (size_t i = 0; i < argc; i++) {
+    if (i == MAX_ARGC - 1 && tokens.size() > MAX_ARGC) {
+      argv[i] = std::format("... ({} more arguments)",
+                            tokens.size() - MAX_ARGC + 1);
+      break;
+    }
+    const std::string &arg = tokens[i];
+    if (arg.size() > MAX_ARG_LEN) {
+      argv[i].assign(arg, 0, MAX_ARG_LEN);
+      argv[i] += std::format("... ({} more bytes)", arg.size() - MAX_ARG_LEN);
+    } else {
+      argv[i].assign(arg);
+    }
+  }
+}
+
+void SlowLog::push(const std::vector<std::string> &argv, u64 duration_us,
+                   const std::string &client_addr) {
+  SlowLogEntry entry{
+      .duration_us = duration_us,
+      .argv = argv,
+      .client_addr = client_addr,
+  };
+  entry.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count();
+
+  std::lock_guard lock(mtx_);
+  if (max_len_ == 0) {
+    return;
+  }
+  entry.id = next_id_++;
+  if (ring_.size() < max_len_) {
+    ring_.push_back(std::move(entry));
+  } else {
+    ring_[head_] = std::move(entry);
+  }
+  head_ = (head_ + 1) % max_len_;
+}
+
+// Newest entries first, like SLOWLOG GET.
+std::vector<SlowLogEntry> SlowLog::get(size_t count) const {
+  std::lock_guard lock(mtx_);
+  std::vector<SlowLogEntry> out;
+  size_t n = std::min(count, ring_.size());
+  out.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    size_t idx = (head_ + ring_.size() - 1 - i) % ring_.size();
+    out.push_back(ring_[idx]);
+  }
+  return out;
+}
+
+size_t SlowLog::len() const {
+  std::lock_guard lock(mtx_);
+  return ring_.size();
+}
+
+void SlowLog::reset() {
+  std::lock_guard lock(mtx_);
+  ring_.clear();
+  head_ = 0;
+}
+
+size_t SlowLog::max_len() const {
+  std::lock_guard lock(mtx_);
+  return max_len_;
+}
+
+// Keeps the newest entries that still fit.
+void SlowLog::set_max_len(size_t len) {
+  std::lock_guard lock(mtx_);
+  std::vector<SlowLogEntry> kept;
+  size_t n = std::min(len, ring_.size());
+  kept.reserve(n);
+  for (size_t i = n; i > 0; i--) {
+    size_t idx = (head_ + ring_.size() - i) % ring_.size();
+    kept.push_back(std::move(ring_[idx]));
+  }
+  ring_ = std::move(kept);
+  max_len_ = len;
+  head_ = len == 0 ? 0 : ring_.size() % len;
+}
+
+} // namespace Redis
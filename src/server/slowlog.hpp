@@ -0,0 +1,62 @@
+#pragma once
+#include "common/types.hpp"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Redis {
+
+struct SlowLogEntry {
+  u64 id;
+  i64 timestamp;
+  u64 duration_us;
+  std::vector<std::string> argv;
+  std::string client_addr;
+};
+
+// Bounded ring of commands that ran longer than a threshold. The threshold
+// check is inline and lock-free so commands under it never allocate.
+class SlowLog {
+public:
+  static constexpr size_t MAX_ARGC = 32;
+  static constexpr size_t MAX_ARG_LEN = 128;
+
+  SlowLog(i64 slower_than_us = 10000, size_t max_len = 128);
+
+  bool enabled() const {
+    return slower_than_us_.load(std::memory_order_relaxed) >= 0;
+  }
+
+  bool should_log(u64 duration_us) const {
+    i64 threshold = slower_than_us_.load(std::memory_order_relaxed);
+    return threshold >= 0 && duration_us >= static_cast<u64>(threshold);
+  }
+
+  // Copies tokens into argv, truncated to MAX_ARGC arguments of MAX_ARG_LEN
+  // bytes. Taken before the command runs, since handlers may move arguments
+  // out; reusing argv keeps the copy free of allocations.
+  static void capture(const std::vector<std::string> &tokens,
+                      std::vector<std::string> &argv);
+  // argv as produced by capture().
+  void push(const std::vector<std::string> &argv, u64 duration_us,
+            const std::string &client_addr);
+  std::vector<SlowLogEntry> get(size_t count) const;
+  size_t len() const;
+  void reset();
+
+  i64 slower_than() const { return slower_than_us_.load(); }
+  void set_slower_than(i64 us) { slower_than_us_.store(us); }
+  size_t max_len() const;
+  void set_max_len(size_t len);
+
+private:
+  std::atomic<i64> slower_than_us_;
+  mutable std::mutex mtx_;
+  std::vector<SlowLogEntry> ring_;
+  size_t head_ = 0;
+  size_t max_len_;
+  u64 next_id_ = 0;
+};
+
+} // namespace Redis
@@ -0,0 +1,139 @@
+#include "server/stats.hpp"
+#include <bit>
+#include <cmath>
+
+namespace Redis {
+
+size_t LatencyBuckets::index_for(u64 usec) {
+  if (usec < SUB_COUNT) {
+    return static_cast<size_t>(usec);
+  }
+  int msb = 63 - std::countl_zero(usec);
+  if (msb >= MAX_EXPONENT) {
+    return COUNT - 1;
+  }
+  int shift = msb - SUB_BITS;
+  u64 sub = (usec >> shift) - SUB_COUNT;
+  return static_cast<size_t>((shift + 1) * SUB_COUNT + sub);
+}
+
+u64 LatencyBuckets::upper_bound(size_t idx) {
+  if (idx < SUB_COUNT) {
+    return idx;
+  }
+  int shift = static_cast<int>(idx / SUB_COUNT) - 1;
+  u64 sub = idx % SUB_COUNT;
+  return ((SUB_COUNT + sub) << shift) + (u64{1} << shift) - 1;
+}
+
+void CommandCounters::mark_reset() {
+  base_calls = calls.load(std::memory_order_relaxed);
+  base_usec = usec.load(std::memory_order_relaxed);
+  for (size_t b = 0; b < LatencyBuckets::COUNT; b++) {
+    base_buckets[b] = buckets[b].load(std::memory_order_relaxed);
+  }
+}
+
+u64 CommandSnapshot::percentile(f64 p) const {
+  u64 total = 0;
+  for (u64 b : buckets) {
+    total += b;
+  }
+  if (total == 0) {
+    return 0;
+  }
+
+  u64 target = static_cast<u64>(std::ceil(p / 100.0 * total));
+  if (target == 0) {
+    target = 1;
+  }
+  u64 seen = 0;
+  for (size_t i = 0; i < buckets.size(); i++) {
+    seen += buckets[i];
+    if (seen >= target) {
+      return LatencyBuckets::upper_bound(i);
+    }
+  }
+  return LatencyBuckets::upper_bound(buckets.size() - 1);
+}
+
+StatsShard::StatsShard(size_t command_count)
+    : slots_(new std::atomic<CommandCounters *>[command_count]),
+      command_count_(command_count) {
+  for (size_t i = 0; i < command_count_; i++) {
+    slots_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+StatsShard::~StatsShard() {
+  for (size_t i = 0; i < command_count_; i++) {
+    delete slots_[i].load(std::memory_order_relaxed);
+  }
+}
+
+CommandCounters *StatsShard::allocate(size_t command_idx) {
+  auto *c = new CommandCounters();
+  slots_[command_idx].store(c, std::memory_order_release);
+  return c;
+}
+
+CommandStats::CommandStats(size_t command_count)
+    : command_count_(command_count) {}
+
+StatsShard *CommandStats::acquire_shard() {
+  std::lock_guard lock(mtx_);
+  if (!free_.empty()) {
+    StatsShard *shard = free_.back();
+    free_.pop_back();
+    return shard;
+  }
+  shards_.push_back(std::make_unique<StatsShard>(command_count_));
+  return shards_.back().get();
+}
+
+void CommandStats::release_shard(StatsShard *shard) {
+  std::lock_guard lock(mtx_);
+  free_.push_back(shard);
+}
+
+std::vector<CommandSnapshot> CommandStats::snapshot() const {
+  std::vector<CommandSnapshot> out(command_count_);
+  for (auto &snap : out) {
+    snap.buckets.assign(LatencyBuckets::COUNT, 0);
+  }
+
+  std::lock_guard lock(mtx_);
+  for (const auto &shard : shards_) {
+    for (size_t i = 0; i < command_count_; i++) {
+      const CommandCounters *c =
+          shard->slots_[i].load(std::memory_order_acquire);
+      if (!c) {
+        continue;
+      }
+      out[i].calls += c->calls.load(std::memory_order_relaxed) - c->base_calls;
+      out[i].usec += c->usec.load(std::memory_order_relaxed) - c->base_usec;
+      for (size_t b = 0; b < LatencyBuckets::COUNT; b++) {
+        out[i].buckets[b] += c->buckets[b].load(std::memory_order_relaxed) -
+                             c->base_buckets[b];
+      }
+    }
+  }
+  return out;
+}
+
+// Safe against running commands: counters only ever grow, so nothing counted
+// before the reset can reappear. A command recorded while it runs may be
+// split, e.g. its call counted but not its latency bucket.
+void CommandStats::reset() {
+  std::lock_guard lock(mtx_);
+  for (const auto &shard : shards_) {
+    for (size_t i = 0; i < command_count_; i++) {
+      CommandCounters *c = shard->slots_[i].load(std::memory_order_acquire);
+      if (c) {
+        c->mark_reset();
+      }
+    }
+  }
+}
+
+} // namespace Redis
@@ -0,0 +1,99 @@
+#pragma once
+#include "common/types.hpp"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Redis {
+
+// Log-linear latency buckets in microseconds: values below 16us get their own
+// bucket, every power of two above that is split into 16 sub-buckets (~6%
+// relative error). Anything beyond 2^36us lands in the last bucket.
+struct LatencyBuckets {
+  static constexpr int SUB_BITS = 4;
+  static constexpr int SUB_COUNT = 1 << SUB_BITS;
+  static constexpr int MAX_EXPONENT = 36;
+  static constexpr size_t COUNT = (MAX_EXPONENT - SUB_BITS + 1) * SUB_COUNT;
+
+  static size_t index_for(u64 usec);
+  static u64 upper_bound(size_t idx);
+};
+
+// Counters for one command, written by a single connection thread only.
+// CONFIG RESETSTAT never writes them (a racing writer's plain store could
+// undo the reset); it records their values as a baseline that readers
+// subtract. The baseline is guarded by CommandStats' mutex.
+struct CommandCounters {
+  std::atomic<u64> calls{0};
+  std::atomic<u64> usec{0};
+  std::array<std::atomic<u64>, LatencyBuckets::COUNT> buckets{};
+
+  u64 base_calls = 0;
+  u64 base_usec = 0;
+  std::array<u64, LatencyBuckets::COUNT> base_buckets{};
+
+  void mark_reset();
+};
+
+// Merged view of one command's counters across all shards.
+struct CommandSnapshot {
+  u64 calls = 0;
+  u64 usec = 0;
+  std::vector<u64> buckets;
+
+  u64 percentile(f64 p) const;
+};
+
+// Per-connection counter shard. Each command slot is allocated on first use so
+// that idle commands cost one pointer per connection.
+class StatsShard {
+public:
+  explicit StatsShard(size_t command_count);
+  ~StatsShard();
+
+  // Fast path: single writer, so plain load/store instead of locked RMW.
+  void record(size_t command_idx, u64 usec) {
+    CommandCounters *c = slots_[command_idx].load(std::memory_order_relaxed);
+    if (!c) {
+      c = allocate(command_idx);
+    }
+    bump(c->calls, 1);
+    bump(c->usec, usec);
+    bump(c->buckets[LatencyBuckets::index_for(usec)], 1);
+  }
+
+private:
+  friend class CommandStats;
+
+  static void bump(std::atomic<u64> &counter, u64 delta) {
+    counter.store(counter.load(std::memory_order_relaxed) + delta,
+                  std::memory_order_relaxed);
+  }
+  CommandCounters *allocate(size_t command_idx);
+
+  std::unique_ptr<std::atomic<CommandCounters *>[]> slots_;
+  size_t command_count_;
+};
+
+// Registry of shards. Connections lease a shard for their lifetime; readers
+// (INFO) merge every shard ever handed out, so counters survive disconnects.
+class CommandStats {
+public:
+  explicit CommandStats(size_t command_count);
+
+  StatsShard *acquire_shard();
+  void release_shard(StatsShard *shard);
+
+  std::vector<CommandSnapshot> snapshot() const;
+  void reset();
+
+private:
+  size_t command_count_;
+  mutable std::mutex mtx_;
+  std::vector<std::unique_ptr<StatsShard>> shards_;
+  std::vector<StatsShard *> free_;
+};
+
+} // namespace Redis
@@ -1,16 +1,31 @@
 #include "../server/tcp_server.hpp"
+#include "common/keyslot.hpp"
 #include "common/types.hpp"
+#include "server/request_reader.hpp"
 #include "util/RESP.hpp"
+#include "util/bitops.hpp"
+#include "util/glob.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
 #include <atomic>
+#include <charconv>
 #include <chrono>
+#include <cctype>
+#include <climits>
 #include <cstring>
 // #include <deque>
 #include <format>
+#include <fstream>
+#include <future>
 #include <iostream>
 // #include <mutex>
 #include <netinet/in.h>
+#include <poll.h>
 #include <optional>
+#include <span>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <thread>
 #include <type_traits>
 #include <unistd.h>
@@ -19,169 +34,2357 @@ std::atomic<int> client_id_counter{0};
 
 namespace Redis {
 
-TCPServer::TCPServer(const std::string &address, int port)
-    : host_(address), port_(port), running_(false) {}
+const std::vector<TCPServer::CommandEntry> TCPServer::command_table_ = {
+    {"PING", &TCPServer::handle_ping, -1, 0, 0, 0},
+    {"ECHO", &TCPServer::handle_echo, 2, 0, 0, 0},
+    {"SET", &TCPServer::handle_set, -3, 1, 1, 1},
+    {"GET", &TCPServer::handle_get, 2, 1, 1, 1},
+    {"INCR", &TCPServer::handle_incr, 2, 1, 1, 1},
+    {"DECR", &TCPServer::handle_decr, 2, 1, 1, 1},
+    {"INCRBY", &TCPServer::handle_incrby, 3, 1, 1, 1},
+    {"DECRBY", &TCPServer::handle_decrby, 3, 1, 1, 1},
+    {"INCRBYFLOAT", &TCPServer::handle_incrbyfloat, 3, 1, 1, 1},
+    {"GETSET", &TCPServer::handle_getset, 3, 1, 1, 1},
+    {"GETDEL", &TCPServer::handle_getdel, 2, 1, 1, 1},
+    {"SETNX", &TCPServer::handle_setnx, 3, 1, 1, 1},
+    {"RPUSH", &TCPServer::handle_rpush, -3, 1, 1, 1},
+    {"SETBIT", &TCPServer::handle_setbit, 4, 1, 1, 1},
+    {"GETBIT", &TCPServer::handle_getbit, 3, 1, 1, 1},
+    {"BITCOUNT", &TCPServer::handle_bitcount, -2, 1, 1, 1},
+    {"BITPOS", &TCPServer::handle_bitpos, -3, 1, 1, 1},
+    {"BITOP", &TCPServer::handle_bitop, -4, 2, -1, 1},
+    {"PFADD", &TCPServer::handle_pfadd, -2, 1, 1, 1},
+    {"PFCOUNT", &TCPServer::handle_pfcount, -2, 1, -1, 1},
+    {"PFMERGE", &TCPServer::handle_pfmerge, -2, 1, -1, 1},
+    {"MULTI", &TCPServer::handle_multi, 1, 0, 0, 0},
+    {"EXEC", &TCPServer::handle_exec, 1, 0, 0, 0},
+    {"DISCARD", &TCPServer::handle_discard, 1, 0, 0, 0},
+    {"WATCH", &TCPServer::handle_watch, -2, 1, -1, 1},
+    {"UNWATCH", &TCPServer::handle_unwatch, 1, 0, 0, 0},
+    {"SCAN", &TCPServer::handle_scan, -2, 0, 0, 0},
+    {"KEYS", &TCPServer::handle_keys, 2, 0, 0, 0},
+    {"DBSIZE", &TCPServer::handle_dbsize, 1, 0, 0, 0},
+    {"HOTKEYS", &TCPServer::handle_hotkeys, -1, 0, 0, 0},
+    {"CLIENT", &TCPServer::handle_client_command, -2, 0, 0, 0},
+    {"INFO", &TCPServer::handle_info, -1, 0, 0, 0},
+    {"CONFIG", &TCPServer::handle_config, -2, 0, 0, 0},
+    {"SLOWLOG", &TCPServer::handle_slowlog, -2, 0, 0, 0},
+    {"LATENCY", &TCPServer::handle_latency, -2, 0, 0, 0},
+    {"CLUSTER", &TCPServer::handle_cluster, -2, 0, 0, 0},
+    {"ASKING", &TCPServer::handle_asking, 1, 0, 0, 0},
+    {"MIGRATE", &TCPServer::handle_migrate, -6, 0, 0, 0},
+    {"RESTORE", &TCPServer::handle_restore, -4, 1, 1, 1},
+};
+
+static std::string to_lower(std::string_view s) {
+  std::string out(s);
+  for (char &c : out) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return out;
+}
+
+static i64 now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Bytes in a send() that has not returned, per client and server-wide.
+static void output_begin(Client &client, size_t bytes) {
+  client.output_pending.fetch_add(bytes, std::memory_order_relaxed);
+  client.pressure->add(bytes);
+}
+
+static void output_end(Client &client, size_t bytes) {
+  client.output_pending.fetch_sub(bytes);
+  client.pressure->release(bytes);
+}
+
+// Connection thread only: writes the pushes other threads have queued.
+static void send_queued_pushes(Client &client) {
+  if (!client.has_pushes.load(std::memory_order_acquire))
+    return;
+  std::string pushes;
+  {
+    std::lock_guard lock(client.push_mtx);
+    pushes.swap(client.push_queue);
+    client.push_overflow = false;
+    client.has_pushes.store(false, std::memory_order_relaxed);
+  }
+  robust_send(client.fd, pushes.data(), pushes.size());
+  output_end(client, pushes.size());
+}
+
+// Any thread: queues a push for target's connection thread and wakes it.
+// flush_all replaces the queue once it would outgrow PUSH_QUEUE_LIMIT.
+static void enqueue_push(Client &target, const std::string &frame,
+                         const std::string &flush_all) {
+  {
+    std::lock_guard lock(target.push_mtx);
+    if (target.push_overflow)
+      return;
+    if (target.push_queue.size() + frame.size() > Client::PUSH_QUEUE_LIMIT) {
+      output_end(target, target.push_queue.size());
+      target.push_queue = flush_all;
+      target.push_overflow = true;
+    } else {
+      target.push_queue += frame;
+    }
+    output_begin(target, target.push_overflow ? flush_all.size()
+                                              : frame.size());
+    target.has_pushes.store(true, std::memory_order_release);
+  }
+  if (target.push_event >= 0)
+    eventfd_write(target.push_event, 1);
+  target.pressure->notify_waiters();
+}
+
+// Only the connection thread writes to its socket, and pushes queued for it
+// go out first, so a reply never overtakes an earlier invalidation.
+static void send_direct(Client &client, const std::string &data) {
+  send_queued_pushes(client);
+  output_begin(client, data.size());
+  robust_send(client.fd, data.c_str(), data.size());
+  output_end(client, data.size());
+}
+
+// Replies from the connection thread; inside EXEC they are collected into
+// the transaction's reply array instead.
+static void reply(Client &client, const std::string &data) {
+  if (client.reply_buffer) {
+    client.reply_buffer->append(data);
+    return;
+  }
+  send_direct(client, data);
+}
+
+// Bulk reply without building a RESP copy: large values go out with one
+// writev of header, payload and CRLF straight from the caller's string.
+static void reply_bulk(Client &client, const std::string &value) {
+  if (value.size() < RequestReader::BIG_ARG || client.reply_buffer) {
+    std::string serialized = std::format("${}\r\n", value.size());
+    serialized += value;
+    serialized += "\r\n";
+    reply(client, serialized);
+    return;
+  }
+  std::string header = std::format("${}\r\n", value.size());
+  static const char crlf[] = "\r\n";
+  iovec iov[3] = {
+      {.iov_base = header.data(), .iov_len = header.size()},
+      {.iov_base = const_cast<char *>(value.data()), .iov_len = value.size()},
+      {.iov_base = const_cast<char *>(crlf), .iov_len = 2},
+  };
+  size_t total = header.size() + value.size() + 2;
+  send_queued_pushes(client);
+  output_begin(client, total);
+  robust_sendv(client.fd, iov, 3);
+  output_end(client, total);
+}
+
+static void send_error(Client &client, const std::string &msg) {
+  RESP e{.resp_type = RESP::type::ERROR, .str = msg};
+  std::string serialized = serialize_RESP(e);
+  reply(client, serialized);
+}
+
+// Resident set size in bytes, read from /proc/self/statm.
+static u64 resident_memory_bytes() {
+  std::ifstream statm("/proc/self/statm");
+  u64 total_pages = 0, resident_pages = 0;
+  if (!(statm >> total_pages >> resident_pages)) {
+    return 0;
+  }
+  return resident_pages * static_cast<u64>(sysconf(_SC_PAGESIZE));
+}
+
+// Id of the client whose command this thread is running, for NOLOOP.
+static thread_local int t_current_client_id = 0;
+
+static void send_ok(Client &client) {
+  RESP response{.resp_type = RESP::type::SIMPLE_STRING, .str = "OK"};
+  std::string serialized = serialize_RESP(response);
+  reply(client, serialized);
+}
+
+static void send_integer(Client &client, i64 value) {
+  reply(client, std::format(":{}\r\n", value));
+}
+
+static void send_null(Client &client) {
+  RESP response{.resp_type = RESP::type::BULK_STRING, .is_null = true};
+  std::string serialized = serialize_RESP(response);
+  reply(client, serialized);
+}
+
+static std::string int_to_string(i64 v) {
+  char buf[24];
+  auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+  return std::string(buf, end);
+}
+
+// Bulk reply for a string value in either encoding; integers are only turned
+// into text here, on the way out.
+static void reply_string_value(Client &client, const RedisData &data) {
+  if (const auto *n = std::get_if<i64>(&data)) {
+    reply_bulk(client, int_to_string(*n));
+  } else {
+    reply_bulk(client, std::get<std::string>(data));
+  }
+}
+
+static void reply_optional_value(Client &client,
+                                 const std::optional<RedisData> &data) {
+  if (data) {
+    reply_string_value(client, *data);
+  } else {
+    send_null(client);
+  }
+}
+
+static void send_store_error(Client &client, StoreStatus status) {
+  switch (status) {
+  case StoreStatus::WRONG_TYPE:
+    send_error(client, "WRONGTYPE Operation against a key holding the wrong "
+                       "kind of value");
+    break;
+  case StoreStatus::NOT_INTEGER:
+    send_error(client, "ERR value is not an integer or out of range");
+    break;
+  case StoreStatus::OVERFLOW:
+    send_error(client, "ERR increment or decrement would overflow");
+    break;
+  case StoreStatus::NOT_FLOAT:
+    send_error(client, "ERR value is not a valid float");
+    break;
+  default:
+    break;
+  }
+}
+
+static void send_arity_error(Client &client, std::string_view command) {
+  send_error(client, std::format("ERR wrong number of arguments for '{}' "
+                                 "command",
+                                 to_lower(command)));
+}
+
+static bool parse_slot(const std::string &s, u16 &slot) {
+  try {
+    i64 v = std::stoll(s);
+    if (v < 0 || v >= CLUSTER_SLOTS)
+      return false;
+    slot = static_cast<u16>(v);
+    return true;
+  } catch (...) {
+    return false;
+  }
+}
+
+TCPServer::TCPServer(const std::string &address, int port,
+                     bool cluster_enabled)
+    : host_(address), port_(port), running_(false),
+      stats_(command_table_.size()) {
+  for (size_t i = 0; i < command_table_.size(); i++) {
+    command_index_.emplace(command_table_[i].name, i);
+  }
+  data_store_.set_key_observer(
+      [this](const std::string &key) { invalidate_key(key); });
+  data_store_.set_rehash_observer([this](u64 usec) {
+    latency_.add_sample_if_needed("rehash", usec / 1000);
+  });
+  if (cluster_enabled) {
+    // Announce loopback when bound to every interface.
+    std::string announce = address == "0.0.0.0" ? "127.0.0.1" : address;
+    cluster_ = std::make_unique<ClusterState>(announce, port);
+    data_store_.enable_slot_index();
+  }
+}
 
 TCPServer::~TCPServer() { stop(); }
 
-void TCPServer::execute_command(const std::vector<std::string> &tokens,
-                                int client_fd) {
-  if (tokens.empty())
+// Commands that run immediately even between MULTI and EXEC.
+static bool runs_inside_multi(std::string_view name) {
+  return name == "EXEC" || name == "DISCARD" || name == "MULTI" ||
+         name == "WATCH";
+}
+
+// Commands refused between MULTI and EXEC. MIGRATE would wait on the network
+// with every shard locked; CLUSTER and ASKING change routing state that the
+// batch was already checked against.
+static bool refused_inside_multi(std::string_view name) {
+  return name == "MIGRATE" || name == "CLUSTER" || name == "ASKING";
+}
+
+void TCPServer::execute_command(std::vector<std::string> &tokens,
+                                Client &client) {
+  if (tokens.empty())
+    return;
+  if (std::optional<size_t> idx = admit_command(tokens, client))
+    call(*idx, tokens, client);
+  else
+    client.command_clock = std::chrono::steady_clock::now();
+}
+
+// Returns the command to run, or nullopt once the request has been answered
+// here (rejected, redirected or queued for EXEC).
+std::optional<size_t>
+TCPServer::admit_command(std::vector<std::string> &tokens, Client &client) {
+  auto it = command_index_.find(tokens[0]);
+  if (it == command_index_.end()) {
+    unknown_commands_++;
+    client.multi_failed = client.in_multi;
+    send_error(client, std::format("ERR unknown command '{}'", tokens[0]));
+    return std::nullopt;
+  }
+
+  size_t idx = it->second;
+  const CommandEntry &cmd = command_table_[idx];
+  size_t argc = tokens.size();
+  if (cmd.arity > 0 ? argc != static_cast<size_t>(cmd.arity)
+                    : argc < static_cast<size_t>(-cmd.arity)) {
+    client.multi_failed = client.in_multi;
+    send_arity_error(client, tokens[0]);
+    return std::nullopt;
+  }
+  if (cluster_ && redirect_for_cluster(cmd, tokens, client)) {
+    client.asking = false;
+    client.multi_failed = client.in_multi;
+    return std::nullopt;
+  }
+
+  if (client.in_multi && refused_inside_multi(cmd.name)) {
+    client.multi_failed = true;
+    send_error(client, "ERR Command not allowed inside a transaction");
+    return std::nullopt;
+  }
+  if (client.in_multi && !runs_inside_multi(cmd.name)) {
+    client.queued.push_back({idx, std::move(tokens)});
+    client.multi_commands.store(static_cast<int>(client.queued.size()),
+                                std::memory_order_relaxed);
+    tokens.clear();
+    reply(client, "+QUEUED\r\n");
+    return std::nullopt;
+  }
+  return idx;
+}
+
+void TCPServer::call(size_t idx, std::vector<std::string> &tokens,
+                     Client &client) {
+  const CommandEntry &cmd = command_table_[idx];
+  client.last_command.store(static_cast<int>(idx), std::memory_order_relaxed);
+  bool slowlog = slowlog_.enabled();
+  if (slowlog)
+    SlowLog::capture(tokens, client.slowlog_argv);
+  auto start = client.command_clock;
+  (this->*cmd.handler)(tokens, client);
+  client.command_clock = std::chrono::steady_clock::now();
+  auto elapsed = client.command_clock - start;
+  if (cmd.handler != &TCPServer::handle_asking) {
+    client.asking = false;
+  }
+  u64 usec = static_cast<u64>(
+      std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+
+  client.stats->record(idx, usec);
+  if (slowlog && slowlog_.should_log(usec)) {
+    slowlog_.push(client.slowlog_argv, usec, client.addr);
+  }
+  latency_.add_sample_if_needed("command", usec / 1000);
+}
+
+void TCPServer::append_keys(const CommandEntry &cmd,
+                            const std::vector<std::string> &tokens,
+                            std::vector<std::string> &keys) {
+  if (cmd.first_key == 0 || tokens.size() <= static_cast<size_t>(cmd.first_key))
+    return;
+  size_t last = cmd.last_key < 0 ? tokens.size() + cmd.last_key
+                                 : static_cast<size_t>(cmd.last_key);
+  last = std::min(last, tokens.size() - 1);
+  for (size_t i = cmd.first_key; i <= last; i += cmd.key_step) {
+    keys.push_back(tokens[i]);
+  }
+}
+
+// Answers with MOVED/ASK/CROSSSLOT/CLUSTERDOWN when the keys of this command
+// are not served here. Returns true if the command must not run.
+bool TCPServer::redirect_for_cluster(const CommandEntry &cmd,
+                                     const std::vector<std::string> &tokens,
+                                     Client &client) {
+  if (cmd.first_key == 0 || tokens.size() <= static_cast<size_t>(cmd.first_key))
+    return false;
+
+  size_t last = cmd.last_key < 0 ? tokens.size() + cmd.last_key
+                                 : static_cast<size_t>(cmd.last_key);
+  last = std::min(last, tokens.size() - 1);
+
+  int slot = -1;
+  for (size_t i = cmd.first_key; i <= last; i += cmd.key_step) {
+    int s = key_hash_slot(tokens[i]);
+    if (slot >= 0 && s != slot) {
+      send_error(client,
+                 "CROSSSLOT Keys in request don't hash to the same slot");
+      return true;
+    }
+    slot = s;
+  }
+
+  auto route = cluster_->route(static_cast<u16>(slot));
+  switch (route.kind) {
+  case ClusterState::RouteKind::LOCAL:
+    return false;
+  case ClusterState::RouteKind::MIGRATING:
+    // Keys still here are served here; missing ones may already have moved.
+    for (size_t i = cmd.first_key; i <= last; i += cmd.key_step) {
+      if (!data_store_.contains(tokens[i])) {
+        send_error(client,
+                   std::format("ASK {} {}", slot, route.target.addr()));
+        return true;
+      }
+    }
+    return false;
+  case ClusterState::RouteKind::IMPORTING:
+    if (client.asking)
+      return false;
+    send_error(client,
+               std::format("MOVED {} {}", slot, route.target.addr()));
+    return true;
+  case ClusterState::RouteKind::MOVED:
+    send_error(client,
+               std::format("MOVED {} {}", slot, route.target.addr()));
+    return true;
+  case ClusterState::RouteKind::UNASSIGNED:
+    send_error(client, "CLUSTERDOWN Hash slot not served");
+    return true;
+  }
+  return false;
+}
+
+void TCPServer::handle_ping(std::vector<std::string> &tokens, Client &client) {
+  RESP response{.resp_type = RESP::type::SIMPLE_STRING, .str = "PONG"};
+  std::string serialized = serialize_RESP(response);
+  reply(client, serialized);
+}
+
+void TCPServer::handle_echo(std::vector<std::string> &tokens, Client &client) {
+  if (tokens.size() < 2)
+    return;
+
+  RESP response{.resp_type = RESP::type::BULK_STRING, .str = tokens[1]};
+  std::string serialized = serialize_RESP(response);
+  reply(client, serialized);
+}
+
+// SET key value [NX|XX] [GET] [EX seconds|PX milliseconds|KEEPTTL]
+void TCPServer::handle_set(std::vector<std::string> &tokens, Client &client) {
+  if (tokens.size() < 3) {
+    send_arity_error(client, tokens[0]);
+    return;
+  }
+
+  SetOptions opts;
+  bool get = false;
+  bool has_expire = false;
+  for (size_t i = 3; i < tokens.size(); i++) {
+    std::string opt = to_lower(tokens[i]);
+    bool has_next = i + 1 < tokens.size();
+    if (opt == "nx" && opts.condition == SetOptions::Condition::ALWAYS) {
+      opts.condition = SetOptions::Condition::IF_ABSENT;
+    } else if (opt == "xx" &&
+               opts.condition == SetOptions::Condition::ALWAYS) {
+      opts.condition = SetOptions::Condition::IF_PRESENT;
+    } else if (opt == "get") {
+      get = true;
+    } else if (opt == "keepttl" && !has_expire) {
+      opts.keep_ttl = true;
+    } else if ((opt == "ex" || opt == "px") && !opts.keep_ttl &&
+               !has_expire && has_next) {
+      i64 amount;
+      if (!parse_canonical_int(tokens[++i], amount)) {
+        send_store_error(client, StoreStatus::NOT_INTEGER);
+        return;
+      }
+      i64 scale = opt == "ex" ? 1000 : 1;
+      if (amount <= 0 || amount > INT64_MAX / 1000) {
+        send_error(client, "ERR invalid expire time in 'set' command");
+        return;
+      }
+      opts.ttl_ms = amount * scale;
+      has_expire = true;
+    } else {
+      send_error(client, "ERR syntax error");
+      return;
+    }
+  }
+
+  // The value is moved, never copied: a large argument was received straight
+  // into this string by the RequestReader.
+  std::optional<RedisData> old;
+  StoreStatus status = data_store_.set(
+      tokens[1], encode_string(std::move(tokens[2])), opts,
+      get ? &old : nullptr);
+  if (status == StoreStatus::WRONG_TYPE) {
+    send_store_error(client, status);
+  } else if (get) {
+    reply_optional_value(client, old);
+  } else if (status == StoreStatus::NOT_SET) {
+    send_null(client);
+  } else {
+    send_ok(client);
+  }
+}
+
+void TCPServer::handle_get(std::vector<std::string> &tokens, Client &client) {
+  if (tokens.size() < 2)
+    return;
+
+  std::string key = tokens[1];
+  // Remember before reading, so a write racing with this GET is always
+  // followed by an invalidation.
+  if (client.tracking && !client.tracking_bcast) {
+    std::vector<u32> evicted;
+    tracking_.remember(key, static_cast<u32>(client.id), evicted);
+    if (!evicted.empty())
+      send_invalidation(std::move(evicted), nullptr);
+  }
+  std::optional<RedisData> opt = data_store_.get(key);
+  if (opt && !std::holds_alternative<RedisList>(*opt)) {
+    reply_string_value(client, *opt);
+    return;
+  }
+  send_null(client);
+}
+
+void TCPServer::reply_incr(Client &client, const std::string &key,
+                           i64 delta) {
+  i64 result;
+  StoreStatus status = data_store_.incr_by(key, delta, result);
+  if (status != StoreStatus::OK) {
+    send_store_error(client, status);
+    return;
+  }
+  send_integer(client, result);
+}
+
+void TCPServer::handle_incr(std::vector<std::string> &tokens, Client &client) {
+  if (tokens.size() != 2) {
+    send_arity_error(client, tokens[0]);
+    return;
+  }
+  reply_incr(client, tokens[1], 1);
+}
+
+void TCPServer::handle_decr(std::vector<std::string> &tokens, Client &client) {
+  if (tokens.size() != 2) {
+    send_arity_error(client, tokens[0]);
+    return;
+  }
+  reply_incr(client, tokens[1], -1);
+}
+
+void TCPServer::handle_incrby(std::vector<std::string> &tokens,
+                              Client &client) {
+  if (tokens.size() != 3) {
+    send_arity_error(client, tokens[0]);
+    return;
+  }
+  i64 delta;
+  if (!parse_canonical_int(tokens[2], delta)) {
+    send_store_error(client, StoreStatus::NOT_INTEGER);
+    return;
+  }
+  reply_incr(client, tokens[1], delta);
+}
+
+void TCPServer::handle_decrby(std::vector<std::string> &tokens,
+                              Client &client) {
+  if (tokens.size() != 3) {
+    send_arity_error(client, tokens[0]);
+    return;
+  }
+  i64 delta;
+  if (!parse_canonical_int(tokens[2], delta)) {
+    send_store_error(client, StoreStatus::NOT_INTEGER);
+    return;
+  }
+  if (delta == INT64_MIN) {
+    send_error(client, "ERR decrement would overflow");
+    return;
+  }
+  reply_incr(client, tokens[1], -delta);
+}
+
+void TCPServer::handle_incrbyfloat(std::vector<std::string> &tokens,
+                                   Client &client) {
+  if (tokens.size() != 3) {
+    send_arity_error(client, tokens[0]);
+    return;
+  }
+  long double delta;
+  if (!parse_long_double(tokens[2], delta)) {
+    send_store_error(client, StoreStatus::NOT_FLOAT);
+    return;
+  }
+  std::string result;
+  StoreStatus status = data_store_.incr_by_float(tokens[1], delta, result);
+  if (status != StoreStatus::OK) {
+    send_store_error(client, status);
+    return;
+  }
+  reply_bulk(client, result);
+}
+
+void TCPServer::handle_getset(std::vector<std::string> &tokens,
+                              Client &client) {
+  if (tokens.size() != 3) {
+    send_arity_error(client, tokens[0]);
+    return;
+  }
+  std::optional<RedisData> old;
+  StoreStatus status = data_store_.set(
+      tokens[1], encode_string(std::move(tokens[2])), SetOptions{}, &old);
+  if (status != StoreStatus::OK) {
+    send_store_error(client, status);
+    return;
+  }
+  reply_optional_value(client, old);
+}
+
+void TCPServer::handle_getdel(std::vector<std::string> &tokens,
+                              Client &client) {
+  if (tokens.size() != 2) {
+    send_arity_error(client, tokens[0]);
+    return;
+  }
+  std::optional<RedisData> old;
+  StoreStatus status = data_store_.getdel(tokens[1], old);
+  if (status != StoreStatus::OK) {
+    send_store_error(client, status);
+    return;
+  }
+  reply_optional_value(client, old);
+}
+
+void TCPServer::handle_setnx(std::vector<std::string> &tokens,
+                             Client &client) {
+  if (tokens.size() != 3) {
+    send_arity_error(client, tokens[0]);
+    return;
+  }
+  SetOptions opts;
+  opts.condition = SetOptions::Condition::IF_ABSENT;
+  StoreStatus status =
+      data_store_.set(tokens[1], encode_string(std::move(tokens[2])), opts);
+  send_integer(client, status == StoreStatus::OK ? 1 : 0);
+}
+
+void TCPServer::handle_rpush(std::vector<std::string> &tokens, Client &client) {
+  if (tokens.size() < 3) {
+    RESP e{.resp_type=RESP::type::ERROR, .str="Wrong number of arguments for RPUSH"};
+    std::string serialized = serialize_RESP(e);
+    reply(client, serialized);
+    return;
+  }
+
+  const std::string& key = tokens[1];
+  auto length = data_store_.rpush(key, std::span(tokens).subspan(2));
+  if (!length) {
+    RESP e{.resp_type=RESP::type::ERROR, .str="KEY HOLDING WRONG TYPE VALUE"};
+    std::string serialized = serialize_RESP(e);
+    reply(client, serialized);
+    return;
+  }
+
+  RESP response {
+    .resp_type=RESP::type::INTEGER,
+    .integer=static_cast<i64>(*length),
+  };
+  std::string serialized = serialize_RESP(response);
+  reply(client, serialized);
+  return;
+}
+
+// Bitmaps are plain strings addressed from the most significant bit of byte
+// 0. Offsets stop at 2^32 - 1, Redis' 512 MB string limit.
+static bool parse_bit_offset(const std::string &s, u64 &offset) {
+  i64 n;
+  if (!parse_canonical_int(s, n) || n < 0 || n >= (i64{1} << 32))
+    return false;
+  offset = static_cast<u64>(n);
+  return true;
+}
+
+static bool bit_at(const u8 *p, u64 i) {
+  return (p[i >> 3] >> (7 - (i & 7))) & 1;
+}
+
+// Clamps Redis-style inclusive [start, end] (negative from the end) to a
+// string of len units; false when nothing is left.
+static bool clamp_range(i64 &start, i64 &end, i64 len) {
+  if (start < 0)
+    start += len;
+  if (end < 0)
+    end += len;
+  start = std::max<i64>(start, 0);
+  end = std::min(std::max<i64>(end, 0), len - 1);
+  return len > 0 && start <= end;
+}
+
+// Parses "start end [BYTE|BIT]" from tokens[at...] (BITCOUNT) or
+// "[start [end [BYTE|BIT]]]" (BITPOS). Returns false after replying.
+static bool parse_bit_range(Client &client,
+                            const std::vector<std::string> &tokens, size_t at,
+                            bool end_optional, i64 &start, i64 &end,
+                            bool &end_given, bool &bit_mode) {
+  start = 0;
+  end = -1;
+  end_given = false;
+  bit_mode = false;
+  size_t extra = tokens.size() - at;
+  if (extra == 0)
+    return true;
+  if (extra > 3 || (extra == 1 && !end_optional)) {
+    send_error(client, "ERR syntax error");
+    return false;
+  }
+  if (!parse_canonical_int(tokens[at], start) ||
+      (extra > 1 && !parse_canonical_int(tokens[at + 1], end))) {
+    send_store_error(client, StoreStatus::NOT_INTEGER);
+    return false;
+  }
+  end_given = extra > 1;
+  if (extra == 3) {
+    std::string unit = to_lower(tokens[at + 2]);
+    if (unit != "bit" && unit != "byte") {
+      send_error(client, "ERR syntax error");
+      return false;
+    }
+    bit_mode = unit == "bit";
+  }
+  return true;
+}
+
+void TCPServer::handle_setbit(std::vector<std::string> &tokens,
+                              Client &client) {
+  u64 offset;
+  if (!parse_bit_offset(tokens[2], offset)) {
+    send_error(client, "ERR bit offset is not an integer or out of range");
+    return;
+  }
+  if (tokens[3] != "0" && tokens[3] != "1") {
+    send_error(client, "ERR bit is not an integer or out of range");
+    return;
+  }
+  bool value = tokens[3] == "1";
+  bool old = false;
+  StoreStatus status =
+      data_store_.update_string(tokens[1], [&](std::string &s) {
+        u64 byte = offset >> 3;
+        if (byte >= s.size())
+          s.resize(byte + 1, '\0');
+        auto *p = reinterpret_cast<u8 *>(s.data());
+        u8 mask = static_cast<u8>(0x80 >> (offset & 7));
+        old = p[byte] & mask;
+        p[byte] = value ? (p[byte] | mask) : (p[byte] & ~mask);
+        return true;
+      });
+  if (status != StoreStatus::OK) {
+    send_store_error(client, status);
+    return;
+  }
+  send_integer(client, old ? 1 : 0);
+}
+
+void TCPServer::handle_getbit(std::vector<std::string> &tokens,
+                              Client &client) {
+  u64 offset;
+  if (!parse_bit_offset(tokens[2], offset)) {
+    send_error(client, "ERR bit offset is not an integer or out of range");
+    return;
+  }
+  bool bit = false;
+  StoreStatus status =
+      data_store_.read_string(tokens[1], [&](std::string_view s) {
+        bit = (offset >> 3) < s.size() &&
+              bit_at(reinterpret_cast<const u8 *>(s.data()), offset);
+      });
+  if (status != StoreStatus::OK) {
+    send_store_error(client, status);
+    return;
+  }
+  send_integer(client, bit ? 1 : 0);
+}
+
+// BITCOUNT key [start end [BYTE|BIT]]. The count runs under the shard's
+// shared lock, straight over the stored bytes.
+void TCPServer::handle_bitcount(std::vector<std::string> &tokens,
+                                Client &client) {
+  i64 start, end;
+  bool end_given, bit_mode;
+  if (!parse_bit_range(client, tokens, 2, false, start, end, end_given,
+                       bit_mode))
+    return;
+
+  u64 count = 0;
+  StoreStatus status =
+      data_store_.read_string(tokens[1], [&](std::string_view s) {
+        const auto *p = reinterpret_cast<const u8 *>(s.data());
+        i64 len = static_cast<i64>(s.size()) * (bit_mode ? 8 : 1);
+        if (!clamp_range(start, end, len))
+          return;
+        if (!bit_mode) {
+          count = popcount(p + start, static_cast<size_t>(end - start + 1));
+          return;
+        }
+        // Whole bytes, minus the bits of the edge bytes outside the range.
+        u64 first = static_cast<u64>(start) >> 3;
+        u64 last = static_cast<u64>(end) >> 3;
+        count = popcount(p + first, last - first + 1);
+        u8 head = static_cast<u8>(0xff00 >> (start & 7));
+        u8 tail = static_cast<u8>((1u << (7 - (end & 7))) - 1);
+        count -= __builtin_popcount(p[first] & head) +
+                 __builtin_popcount(p[last] & tail);
+      });
+  if (status != StoreStatus::OK) {
+    send_store_error(client, status);
+    return;
+  }
+  send_integer(client, static_cast<i64>(count));
+}
+
+// First bit equal to bit in bits [start, end], or -1. Whole bytes that
+// cannot hold it are skipped with the vector scan.
+static i64 find_bit(const u8 *p, u64 start, u64 end, bool bit) {
+  u64 i = start;
+  for (; i <= end && (i & 7); i++) {
+    if (bit_at(p, i) == bit)
+      return static_cast<i64>(i);
+  }
+  if (i > end)
+    return -1;
+  u64 first = i >> 3;
+  u64 full_end = (end + 1) >> 3;
+  if (full_end > first)
+    i = (first + find_byte_not(p + first, full_end - first,
+                               bit ? 0x00 : 0xff)) * 8;
+  for (; i <= end; i++) {
+    if (bit_at(p, i) == bit)
+      return static_cast<i64>(i);
+  }
+  return -1;
+}
+
+// BITPOS key bit [start [end [BYTE|BIT]]]. Looking for a 0 without an end
+// treats the string as followed by zeros, as Redis does.
+void TCPServer::handle_bitpos(std::vector<std::string> &tokens,
+                              Client &client) {
+  if (tokens[2] != "0" && tokens[2] != "1") {
+    send_error(client, "ERR The bit argument must be 1 or 0.");
+    return;
+  }
+  bool bit = tokens[2] == "1";
+  i64 start, end;
+  bool end_given, bit_mode;
+  if (!parse_bit_range(client, tokens, 3, true, start, end, end_given,
+                       bit_mode))
+    return;
+
+  bool found_key = false;
+  i64 pos = -1;
+  StoreStatus status =
+      data_store_.read_string(tokens[1], [&](std::string_view s) {
+        found_key = !s.empty();
+        const auto *p = reinterpret_cast<const u8 *>(s.data());
+        i64 unit = bit_mode ? 1 : 8;
+        i64 len = static_cast<i64>(s.size()) * 8 / unit;
+        if (!clamp_range(start, end, len))
+          return;
+        u64 first = static_cast<u64>(start * unit);
+        u64 last = static_cast<u64>(end * unit + unit - 1);
+        pos = find_bit(p, first, last, bit);
+        if (pos == -1 && !bit && !end_given)
+          pos = static_cast<i64>(last + 1);
+      });
+  if (status != StoreStatus::OK) {
+    send_store_error(client, status);
+    return;
+  }
+  if (!found_key)
+    pos = bit ? -1 : 0;
+  send_integer(client, pos);
+}
+
+// BITOP AND|OR|XOR|NOT dest src [src ...]. Shorter sources count as
+// zero-padded. The keys are locked together, so sources are combined in
+// place rather than copied out first.
+void TCPServer::handle_bitop(std::vector<std::string> &tokens,
+                             Client &client) {
+  std::string name = to_lower(tokens[1]);
+  BitOp op;
+  if (name == "and") {
+    op = BitOp::AND;
+  } else if (name == "or") {
+    op = BitOp::OR;
+  } else if (name == "xor") {
+    op = BitOp::XOR;
+  } else if (name == "not") {
+    op = BitOp::NOT;
+  } else {
+    send_error(client, "ERR syntax error");
+    return;
+  }
+  if (op == BitOp::NOT && tokens.size() != 4) {
+    send_error(client,
+               "ERR BITOP NOT must be called with a single source key.");
+    return;
+  }
+
+  // Replies wait until the keys are unlocked.
+  StoreStatus status = StoreStatus::OK;
+  i64 length = 0;
+  {
+    std::vector<std::string> keys(tokens.begin() + 2, tokens.end());
+    ConcurrentStore::KeyLock lock(data_store_, keys);
+    std::string result;
+    for (size_t i = 3; i < tokens.size() && status == StoreStatus::OK; i++) {
+      status = data_store_.read_string(tokens[i], [&](std::string_view s) {
+        const auto *src = reinterpret_cast<const u8 *>(s.data());
+        if (i == 3) {
+          result.assign(s);
+          if (op == BitOp::NOT)
+            bitop_apply(op, reinterpret_cast<u8 *>(result.data()), src,
+                        s.size());
+          return;
+        }
+        if (s.size() > result.size())
+          result.resize(s.size(), '\0');
+        auto *dst = reinterpret_cast<u8 *>(result.data());
+        bitop_apply(op, dst, src, s.size());
+        if (op == BitOp::AND)
+          std::fill(result.begin() + s.size(), result.end(), '\0');
+      });
+    }
+
+    if (status == StoreStatus::OK) {
+      length = static_cast<i64>(result.size());
+      if (result.empty()) {
+        data_store_.erase(tokens[2]);
+      } else {
+        data_store_.set(tokens[2], std::move(result), SetOptions{});
+      }
+    }
+  }
+  if (status != StoreStatus::OK) {
+    send_store_error(client, status);
+    return;
+  }
+  send_integer(client, length);
+}
+
+static void send_hll_error(Client &client, hll::Status status) {
+  if (status == hll::Status::CORRUPT) {
+    send_error(client, "INVALIDOBJ Corrupted HLL object detected");
+  } else {
+    send_error(client,
+               "WRONGTYPE Key is not a valid HyperLogLog string value.");
+  }
+}
+
+void TCPServer::handle_pfadd(std::vector<std::string> &tokens,
+                             Client &client) {
+  auto elements = std::span<const std::string>(tokens).subspan(2);
+  size_t sparse_max = hll_sparse_max_bytes_.load(std::memory_order_relaxed);
+  hll::Status result = hll::Status::OK;
+  bool updated = false;
+  StoreStatus status =
+      data_store_.update_string(tokens[1], [&](std::string &s) {
+        bool created = s.empty();
+        if (created)
+          s = hll::create();
+        bool changed;
+        result = hll::add(s, elements, changed, sparse_max);
+        updated = result == hll::Status::OK && (changed || created);
+        return updated;
+      });
+  if (status != StoreStatus::OK) {
+    send_store_error(client, status);
+    return;
+  }
+  if (result != hll::Status::OK) {
+    send_hll_error(client, result);
+    return;
+  }
+  send_integer(client, updated ? 1 : 0);
+}
+
+// Outcome of reading HyperLogLog values: WRONG_TYPE from the store for a
+// list, or an hll error for a string that is not a valid HyperLogLog.
+struct HllReadResult {
+  StoreStatus store = StoreStatus::OK;
+  hll::Status hll = hll::Status::OK;
+
+  bool ok() const {
+    return store == StoreStatus::OK && hll == hll::Status::OK;
+  }
+};
+
+static void send_hll_read_error(Client &client, const HllReadResult &result) {
+  if (result.store != StoreStatus::OK) {
+    send_store_error(client, result.store);
+  } else {
+    send_hll_error(client, result.hll);
+  }
+}
+
+// Merges the registers of keys (missing ones count as empty) into
+// registers, stopping at the first key that fails. Sends nothing, so callers
+// can reply once their KeyLock is released.
+static HllReadResult merge_hll_keys(ConcurrentStore &store,
+                                    std::span<const std::string> keys,
+                                    u8 *registers) {
+  HllReadResult result;
+  for (const std::string &key : keys) {
+    result.store = store.read_string(key, [&](std::string_view s) {
+      if (!s.empty())
+        result.hll = hll::merge_into(registers, s);
+    });
+    if (!result.ok())
+      break;
+  }
+  return result;
+}
+
+// PFCOUNT key [key ...]. One key uses and refreshes the value's cached
+// cardinality, which counts as a write like in Redis; several keys are
+// merged into a scratch register set under one lock.
+void TCPServer::handle_pfcount(std::vector<std::string> &tokens,
+                               Client &client) {
+  u64 count = 0;
+  if (tokens.size() == 2) {
+    hll::Status result = hll::Status::OK;
+    StoreStatus status =
+        data_store_.update_string(tokens[1], [&](std::string &s) {
+          if (s.empty())
+            return false;
+          bool cache_updated;
+          result = hll::count(s, count, cache_updated);
+          return result == hll::Status::OK && cache_updated;
+        });
+    if (status != StoreStatus::OK) {
+      send_store_error(client, status);
+      return;
+    }
+    if (result != hll::Status::OK) {
+      send_hll_error(client, result);
+      return;
+    }
+    send_integer(client, static_cast<i64>(count));
+    return;
+  }
+
+  std::vector<std::string> keys(tokens.begin() + 1, tokens.end());
+  std::vector<u8> registers(hll::REGISTERS, 0);
+  HllReadResult result;
+  {
+    ConcurrentStore::KeyLock lock(data_store_, keys);
+    result = merge_hll_keys(data_store_, keys, registers.data());
+  }
+  if (!result.ok()) {
+    send_hll_read_error(client, result);
+    return;
+  }
+  send_integer(client,
+               static_cast<i64>(hll::count_registers(registers.data())));
+}
+
+// PFMERGE dest [src ...]: dest's own registers take part, and the result is
+// always dense.
+void TCPServer::handle_pfmerge(std::vector<std::string> &tokens,
+                               Client &client) {
+  std::vector<std::string> keys(tokens.begin() + 1, tokens.end());
+  std::vector<u8> registers(hll::REGISTERS, 0);
+  HllReadResult result;
+  {
+    ConcurrentStore::KeyLock lock(data_store_, keys);
+    result = merge_hll_keys(data_store_, keys, registers.data());
+    if (result.ok())
+      data_store_.set(tokens[1], hll::from_registers(registers.data()),
+                      SetOptions{});
+  }
+  if (!result.ok()) {
+    send_hll_read_error(client, result);
+    return;
+  }
+  send_ok(client);
+}
+
+// CLIENT ID | LIST | TRACKING ON|OFF [BCAST] [PREFIX prefix ...] [NOLOOP]
+// Invalidations are RESP3 push frames on the tracking connection itself;
+// there is no pub/sub, so REDIRECT is not available.
+void TCPServer::handle_client_command(std::vector<std::string> &tokens,
+                                      Client &client) {
+  if (tokens.size() < 2) {
+    send_error(client, "ERR wrong number of arguments for 'client' command");
+    return;
+  }
+
+  std::string sub = to_lower(tokens[1]);
+  if (sub == "id") {
+    RESP response{.resp_type = RESP::type::INTEGER, .integer = client.id};
+    std::string serialized = serialize_RESP(response);
+    reply(client, serialized);
+    return;
+  }
+
+  if (sub == "list" && tokens.size() == 2) {
+    reply_bulk(client, client_list());
+    return;
+  }
+
+  if (sub != "tracking" || tokens.size() < 3) {
+    send_error(client,
+               std::format("ERR unknown CLIENT subcommand '{}'", tokens[1]));
+    return;
+  }
+
+  std::string mode = to_lower(tokens[2]);
+  if (mode == "off") {
+    disable_tracking(client);
+    send_ok(client);
+    return;
+  }
+  if (mode != "on") {
+    send_error(client, "ERR syntax error");
+    return;
+  }
+
+  bool bcast = false, noloop = false;
+  std::vector<std::string> prefixes;
+  for (size_t i = 3; i < tokens.size(); i++) {
+    std::string opt = to_lower(tokens[i]);
+    if (opt == "bcast") {
+      bcast = true;
+    } else if (opt == "noloop") {
+      noloop = true;
+    } else if (opt == "prefix" && i + 1 < tokens.size()) {
+      prefixes.push_back(tokens[++i]);
+    } else if (opt == "redirect") {
+      send_error(client, "ERR REDIRECT is not supported, invalidations are "
+                         "pushed on the tracking connection");
+      return;
+    } else {
+      send_error(client, "ERR syntax error");
+      return;
+    }
+  }
+  if (!bcast && !prefixes.empty()) {
+    send_error(client,
+               "ERR PREFIX option requires BCAST mode to be enabled");
+    return;
+  }
+
+  enable_tracking(client, bcast, noloop, std::move(prefixes));
+  send_ok(client);
+}
+
+void TCPServer::enable_tracking(Client &client, bool bcast, bool noloop,
+                                std::vector<std::string> prefixes) {
+  disable_tracking(client);
+  if (client.push_event < 0)
+    client.push_event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  std::unique_lock lock(tracking_clients_mtx_);
+  client.tracking = true;
+  client.tracking_bcast = bcast;
+  client.tracking_noloop = noloop;
+  tracking_clients_[static_cast<u32>(client.id)] = &client;
+  tracking_count_++;
+
+  if (bcast) {
+    if (prefixes.empty())
+      prefixes.emplace_back();
+    for (auto &prefix : prefixes) {
+      tracking_.subscribe_prefix(static_cast<u32>(client.id),
+                                 std::move(prefix));
+    }
+  }
+}
+
+void TCPServer::disable_tracking(Client &client) {
+  if (!client.tracking)
+    return;
+
+  std::unique_lock lock(tracking_clients_mtx_);
+  if (client.tracking_bcast)
+    tracking_.unsubscribe(static_cast<u32>(client.id));
+  tracking_clients_.erase(static_cast<u32>(client.id));
+  tracking_count_--;
+  client.tracking = false;
+  client.tracking_bcast = false;
+  client.tracking_noloop = false;
+}
+
+// Store write hook: runs on the writing thread after the shard lock is
+// released, so the push can never reach a reader before the new value can.
+// The pushes are only queued: a reader that stops reading never holds up the
+// writer.
+void TCPServer::invalidate_key(const std::string &key) {
+  if (tracking_count_.load(std::memory_order_relaxed) == 0)
+    return;
+
+  std::vector<u32> ids;
+  tracking_.collect(key, ids);
+  if (!ids.empty())
+    send_invalidation(std::move(ids), &key);
+}
+
+// ["invalidate", [key]], or ["invalidate", nil] to flush everything.
+static std::string invalidation_frame(const std::string *key) {
+  RESP keys{.resp_type = RESP::type::ARRAY, .is_null = key == nullptr};
+  if (key)
+    keys.elements.push_back(
+        {.resp_type = RESP::type::BULK_STRING, .str = *key});
+  RESP push{.resp_type = RESP::type::PUSH};
+  push.elements.push_back(
+      {.resp_type = RESP::type::BULK_STRING, .str = "invalidate"});
+  push.elements.push_back(std::move(keys));
+  return serialize_RESP(push);
+}
+
+void TCPServer::send_invalidation(std::vector<u32> client_ids,
+                                  const std::string *key) {
+  std::sort(client_ids.begin(), client_ids.end());
+  client_ids.erase(std::unique(client_ids.begin(), client_ids.end()),
+                   client_ids.end());
+
+  static const std::string flush_all = invalidation_frame(nullptr);
+  std::string serialized = key ? invalidation_frame(key) : flush_all;
+
+  std::shared_lock lock(tracking_clients_mtx_);
+  for (u32 id : client_ids) {
+    auto it = tracking_clients_.find(id);
+    if (it == tracking_clients_.end())
+      continue;
+    Client &target = *it->second;
+    if (target.tracking_noloop && static_cast<int>(id) == t_current_client_id)
+      continue;
+    enqueue_push(target, serialized, flush_all);
+  }
+}
+
+void TCPServer::handle_multi(std::vector<std::string> &tokens,
+                             Client &client) {
+  if (client.in_multi) {
+    send_error(client, "ERR MULTI calls can not be nested");
+    return;
+  }
+  client.in_multi = true;
+  client.multi_commands.store(0, std::memory_order_relaxed);
+  send_ok(client);
+}
+
+static void reset_transaction(Client &client) {
+  client.in_multi = false;
+  client.multi_commands.store(-1, std::memory_order_relaxed);
+  client.multi_failed = false;
+  client.queued.clear();
+  client.watched.clear();
+}
+
+// Runs the queued batch with every shard it (or a WATCHed key) touches
+// locked once, in shard order, and answers with a single array. Commands
+// without key specs that walk the keyspace lock every shard instead, since
+// they would otherwise take shard locks out of order.
+void TCPServer::handle_exec(std::vector<std::string> &tokens,
+                            Client &client) {
+  if (!client.in_multi) {
+    send_error(client, "ERR EXEC without MULTI");
+    return;
+  }
+  std::vector<QueuedCommand> queued = std::move(client.queued);
+  std::vector<std::pair<std::string, u64>> watched =
+      std::move(client.watched);
+  bool failed = client.multi_failed;
+  reset_transaction(client);
+  if (failed) {
+    send_error(client, "EXECABORT Transaction discarded because of previous "
+                       "errors.");
     return;
+  }
 
-  std::string command = tokens[0];
+  std::vector<std::string> keys;
+  bool all_shards = false;
+  for (const auto &[key, version] : watched) {
+    keys.push_back(key);
+  }
+  for (const auto &q : queued) {
+    const CommandEntry &cmd = command_table_[q.command];
+    append_keys(cmd, q.tokens, keys);
+    all_shards |= cmd.handler == &TCPServer::handle_scan ||
+                  cmd.handler == &TCPServer::handle_keys;
+  }
 
-  if (command == "PING") {
-    handle_ping(client_fd);
-  } else if (command == "ECHO") {
-    handle_echo(tokens, client_fd);
-  } else if (command == "SET") {
-    handle_set(tokens, client_fd);
-  } else if (command == "GET") {
-    handle_get(tokens, client_fd);
-  } else if (command == "RPUSH") {
-    handle_rpush(tokens, client_fd);
-  } else {
-    std::cout << "Unknown command: " << command << "\n";
+  std::string out;
+  {
+    ConcurrentStore::KeyLock lock(data_store_, keys, all_shards);
+    bool changed = std::any_of(watched.begin(), watched.end(), [&](auto &w) {
+      return data_store_.version(w.first) != w.second;
+    });
+    if (changed) {
+      out = "*-1\r\n";
+    } else {
+      out = std::format("*{}\r\n", queued.size());
+      client.reply_buffer = &out;
+      client.command_clock = std::chrono::steady_clock::now();
+      for (auto &q : queued) {
+        call(q.command, q.tokens, client);
+      }
+      client.reply_buffer = nullptr;
+    }
   }
+  reply(client, out);
 }
 
-void TCPServer::handle_ping(int client_fd) {
-  RESP response{.resp_type = RESP::type::SIMPLE_STRING, .str = "PONG"};
+void TCPServer::handle_discard(std::vector<std::string> &tokens,
+                               Client &client) {
+  if (!client.in_multi) {
+    send_error(client, "ERR DISCARD without MULTI");
+    return;
+  }
+  reset_transaction(client);
+  send_ok(client);
+}
+
+void TCPServer::handle_watch(std::vector<std::string> &tokens,
+                             Client &client) {
+  if (client.in_multi) {
+    send_error(client, "ERR WATCH inside MULTI is not allowed");
+    return;
+  }
+  for (size_t i = 1; i < tokens.size(); i++) {
+    client.watched.emplace_back(tokens[i], data_store_.version(tokens[i]));
+  }
+  send_ok(client);
+}
+
+void TCPServer::handle_unwatch(std::vector<std::string> &tokens,
+                               Client &client) {
+  client.watched.clear();
+  send_ok(client);
+}
+
+// One line per connection, in Redis' CLIENT LIST format (the fields this
+// server has). qbuf is the request bytes held for the command being read,
+// omem the reply and push bytes still waiting to be written.
+std::string TCPServer::client_list() {
+  i64 now = now_ms();
+  std::string out;
+  std::shared_lock lock(clients_mtx_);
+  std::shared_lock tracking_lock(tracking_clients_mtx_);
+  for (const auto &[id, c] : clients_) {
+    int multi = c->multi_commands.load(std::memory_order_relaxed);
+    std::string flags;
+    if (multi >= 0)
+      flags += 'x';
+    if (c->tracking)
+      flags += 't';
+    if (flags.empty())
+      flags = "N";
+    int cmd = c->last_command.load(std::memory_order_relaxed);
+    out += std::format(
+        "id={} addr={} fd={} age={} idle={} flags={} multi={} qbuf={} "
+        "omem={} cmd={}\n",
+        id, c->addr, c->fd, (now - c->created_ms) / 1000,
+        (now - c->last_interaction_ms.load(std::memory_order_relaxed)) / 1000,
+        flags, multi, c->query_buffer.load(std::memory_order_relaxed),
+        c->output_pending.load(std::memory_order_relaxed),
+        cmd < 0 ? "NULL" : to_lower(command_table_[cmd].name));
+  }
+  return out;
+}
+
+static const char *type_name(size_t type_index) {
+  return type_index == 1 ? "list" : "string";
+}
+
+// SCAN cursor [MATCH pattern] [COUNT count] [TYPE type]
+void TCPServer::handle_scan(std::vector<std::string> &tokens, Client &client) {
+  if (tokens.size() < 2) {
+    send_error(client, "ERR wrong number of arguments for 'scan' command");
+    return;
+  }
+
+  u64 cursor;
+  try {
+    size_t used = 0;
+    cursor = std::stoull(tokens[1], &used);
+    if (used != tokens[1].size() || tokens[1][0] == '-')
+      throw std::invalid_argument("cursor");
+  } catch (...) {
+    send_error(client, "ERR invalid cursor");
+    return;
+  }
+
+  std::optional<std::string> pattern, type;
+  size_t count = 10;
+  for (size_t i = 2; i < tokens.size(); i += 2) {
+    if (i + 1 >= tokens.size()) {
+      send_error(client, "ERR syntax error");
+      return;
+    }
+    std::string opt = to_lower(tokens[i]);
+    if (opt == "match") {
+      pattern = tokens[i + 1];
+    } else if (opt == "type") {
+      type = to_lower(tokens[i + 1]);
+    } else if (opt == "count") {
+      try {
+        i64 n = std::stoll(tokens[i + 1]);
+        if (n < 1)
+          throw std::out_of_range("count");
+        count = static_cast<size_t>(n);
+      } catch (...) {
+        send_error(client, "ERR value is not an integer or out of range");
+        return;
+      }
+    } else {
+      send_error(client, "ERR syntax error");
+      return;
+    }
+  }
+
+  // Filters run after the shard lock is released.
+  std::vector<ScanEntry> found;
+  cursor = data_store_.scan(cursor, count, found);
+
+  RESP keys{.resp_type = RESP::type::ARRAY};
+  for (auto &entry : found) {
+    if (type && *type != type_name(entry.type))
+      continue;
+    if (pattern && !glob_match(*pattern, entry.key))
+      continue;
+    keys.elements.push_back(
+        {.resp_type = RESP::type::BULK_STRING, .str = std::move(entry.key)});
+  }
+
+  RESP response{.resp_type = RESP::type::ARRAY};
+  response.elements.push_back({.resp_type = RESP::type::BULK_STRING,
+                               .str = std::to_string(cursor)});
+  response.elements.push_back(std::move(keys));
   std::string serialized = serialize_RESP(response);
-  robust_send(client_fd, serialized.c_str(), serialized.size());
+  reply(client, serialized);
 }
 
-void TCPServer::handle_echo(const std::vector<std::string> &tokens,
-                            int client_fd) {
-  if (tokens.size() < 2)
+// Built on the SCAN iterator, so writers are only ever blocked on one shard
+// for one batch rather than for the whole walk.
+void TCPServer::handle_keys(std::vector<std::string> &tokens, Client &client) {
+  if (tokens.size() != 2) {
+    send_error(client, "ERR wrong number of arguments for 'keys' command");
     return;
+  }
 
-  RESP response{.resp_type = RESP::type::BULK_STRING, .str = tokens[1]};
+  const std::string &pattern = tokens[1];
+  std::vector<std::string> matches;
+  if (glob_is_literal(pattern)) {
+    if (data_store_.contains(pattern))
+      matches.push_back(pattern);
+  } else {
+    std::vector<ScanEntry> batch;
+    u64 cursor = 0;
+    do {
+      batch.clear();
+      cursor = data_store_.scan(cursor, 1024, batch);
+      for (auto &entry : batch) {
+        if (glob_match(pattern, entry.key))
+          matches.push_back(std::move(entry.key));
+      }
+    } while (cursor != 0);
+    // A shard shrinking mid-walk can return a key twice.
+    std::sort(matches.begin(), matches.end());
+    matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+  }
+
+  RESP response{.resp_type = RESP::type::ARRAY};
+  for (auto &key : matches) {
+    response.elements.push_back(
+        {.resp_type = RESP::type::BULK_STRING, .str = std::move(key)});
+  }
+  std::string serialized = serialize_RESP(response);
+  reply(client, serialized);
+}
+
+void TCPServer::handle_dbsize(std::vector<std::string> &tokens,
+                              Client &client) {
+  RESP response{.resp_type = RESP::type::INTEGER,
+                .integer = static_cast<i64>(data_store_.size())};
+  std::string serialized = serialize_RESP(response);
+  reply(client, serialized);
+}
+
+// HOTKEYS [FREQ|MEMORY|ELEMENTS] [COUNT n]: the sampler's current leaders,
+// each as [key, type, value]. Answering never walks the keyspace, so it is
+// cheap to poll; results lag by up to one sampler pass.
+void TCPServer::handle_hotkeys(std::vector<std::string> &tokens,
+                               Client &client) {
+  KeySampler::Metric metric = KeySampler::Metric::FREQ;
+  size_t count = 10;
+  for (size_t i = 1; i < tokens.size(); i++) {
+    std::string opt = to_lower(tokens[i]);
+    if (opt == "freq") {
+      metric = KeySampler::Metric::FREQ;
+    } else if (opt == "memory") {
+      metric = KeySampler::Metric::MEMORY;
+    } else if (opt == "elements") {
+      metric = KeySampler::Metric::ELEMENTS;
+    } else if (opt == "count" && i + 1 < tokens.size()) {
+      try {
+        i64 n = std::stoll(tokens[++i]);
+        if (n < 1)
+          throw std::out_of_range("count");
+        count = static_cast<size_t>(n);
+      } catch (...) {
+        send_error(client, "ERR value is not an integer or out of range");
+        return;
+      }
+    } else {
+      send_error(client, "ERR syntax error");
+      return;
+    }
+  }
+
+  RESP response{.resp_type = RESP::type::ARRAY};
+  for (const KeySample &s : sampler_.top(metric, count)) {
+    u64 value = metric == KeySampler::Metric::FREQ     ? s.frequency
+                : metric == KeySampler::Metric::MEMORY ? s.memory
+                                                       : s.elements;
+    RESP entry{.resp_type = RESP::type::ARRAY};
+    entry.elements.push_back(
+        {.resp_type = RESP::type::BULK_STRING, .str = s.key});
+    entry.elements.push_back(
+        {.resp_type = RESP::type::BULK_STRING, .str = type_name(s.type)});
+    entry.elements.push_back({.resp_type = RESP::type::INTEGER,
+                              .integer = static_cast<i64>(value)});
+    response.elements.push_back(std::move(entry));
+  }
+  std::string serialized = serialize_RESP(response);
+  reply(client, serialized);
+}
+
+void TCPServer::handle_info(std::vector<std::string> &tokens, Client &client) {
+  std::vector<std::string> sections;
+  if (tokens.size() < 2) {
+    sections = {"clients", "memory", "stats"};
+  } else if (to_lower(tokens[1]) == "all" ||
+             to_lower(tokens[1]) == "everything") {
+    sections = {"clients", "memory", "stats", "commandstats", "latencystats"};
+  } else {
+    for (size_t i = 1; i < tokens.size(); i++) {
+      sections.push_back(to_lower(tokens[i]));
+    }
+  }
+
+  std::string body;
+  for (const auto &section : sections) {
+    std::string text = info_section(section);
+    if (text.empty())
+      continue;
+    if (!body.empty())
+      body += "\r\n";
+    body += text;
+  }
+
+  RESP response{.resp_type = RESP::type::BULK_STRING, .str = body};
   std::string serialized = serialize_RESP(response);
-  robust_send(client_fd, serialized.c_str(), serialized.size());
+  reply(client, serialized);
+}
+
+std::string TCPServer::info_section(std::string_view section) {
+  if (section == "clients") {
+    size_t max_input = 0, max_output = 0;
+    {
+      std::shared_lock lock(clients_mtx_);
+      for (const auto &[id, c] : clients_) {
+        max_input = std::max(max_input, c->query_buffer.load());
+        max_output = std::max(max_output, c->output_pending.load());
+      }
+    }
+    return std::format("# Clients\r\nconnected_clients:{}\r\n"
+                       "tracking_clients:{}\r\n"
+                       "client_recent_max_input_buffer:{}\r\n"
+                       "client_recent_max_output_buffer:{}\r\n",
+                       connected_clients_.load(), tracking_count_.load(),
+                       max_input, max_output);
+  }
+
+  if (section == "memory") {
+    u64 rss = resident_memory_bytes();
+    return std::format("# Memory\r\nused_memory_rss:{}\r\n"
+                       "used_memory_rss_human:{:.2f}M\r\n"
+                       "mem_clients_normal:{}\r\nmaxmemory_clients:{}\r\n"
+                       "keys:{}\r\n",
+                       rss, rss / (1024.0 * 1024.0), output_pressure_.total(),
+                       limits_.total_output_limit(), data_store_.size());
+  }
+
+  if (section == "stats") {
+    u64 processed = 0;
+    for (const auto &snap : stats_.snapshot()) {
+      processed += snap.calls;
+    }
+    return std::format("# Stats\r\ntotal_connections_received:{}\r\n"
+                       "total_commands_processed:{}\r\n"
+                       "unknown_commands:{}\r\nexpired_keys:{}\r\n"
+                       "tracking_total_keys:{}\r\n"
+                       "tracking_total_prefixes:{}\r\n"
+                       "client_query_buffer_limit_disconnections:{}\r\n"
+                       "client_output_buffer_limit_disconnections:{}\r\n"
+                       "evicted_clients:{}\r\n"
+                       "hotkeys_sampler_passes:{}\r\n",
+                       total_connections_.load(), processed,
+                       unknown_commands_.load(),
+                       data_store_.expired_keys() - expired_keys_base_.load(),
+                       tracking_.tracked_keys(), tracking_.prefixes(),
+                       query_limit_disconnections_.load(),
+                       output_limit_disconnections_.load(),
+                       evicted_clients_.load(), sampler_.passes());
+  }
+
+  if (section == "commandstats") {
+    std::string out = "# Commandstats\r\n";
+    auto snaps = stats_.snapshot();
+    for (size_t i = 0; i < snaps.size(); i++) {
+      if (snaps[i].calls == 0)
+        continue;
+      out += std::format(
+          "cmdstat_{}:calls={},usec={},usec_per_call={:.2f}\r\n",
+          to_lower(command_table_[i].name), snaps[i].calls, snaps[i].usec,
+          static_cast<f64>(snaps[i].usec) / snaps[i].calls);
+    }
+    return out;
+  }
+
+  if (section == "latencystats") {
+    std::string out = "# Latencystats\r\n";
+    auto snaps = stats_.snapshot();
+    for (size_t i = 0; i < snaps.size(); i++) {
+      if (snaps[i].calls == 0)
+        continue;
+      out += std::format(
+          "latency_percentiles_usec_{}:p50={},p99={},p99.9={}\r\n",
+          to_lower(command_table_[i].name), snaps[i].percentile(50.0),
+          snaps[i].percentile(99.0), snaps[i].percentile(99.9));
+    }
+    return out;
+  }
+
+  return "";
 }
 
-void TCPServer::handle_set(const std::vector<std::string> &tokens,
-                           int client_fd) {
-  if (tokens.size() < 3)
+void TCPServer::handle_config(std::vector<std::string> &tokens,
+                              Client &client) {
+  if (tokens.size() < 2) {
+    send_error(client, "ERR wrong number of arguments for 'config' command");
     return;
+  }
 
-  std::string key = tokens[1];
-  std::string value = tokens[2];
-  i64 ttl_ms = -1;
+  std::string sub = to_lower(tokens[1]);
+  if (sub == "resetstat") {
+    stats_.reset();
+    total_connections_ = 0;
+    unknown_commands_ = 0;
+    expired_keys_base_ = data_store_.expired_keys();
+    query_limit_disconnections_ = 0;
+    output_limit_disconnections_ = 0;
+    evicted_clients_ = 0;
+  } else if (sub == "get" && tokens.size() == 3) {
+    std::string pattern = to_lower(tokens[2]);
+    std::vector<std::pair<std::string, std::string>> params = {
+        {"slowlog-log-slower-than", std::to_string(slowlog_.slower_than())},
+        {"slowlog-max-len", std::to_string(slowlog_.max_len())},
+        {"latency-monitor-threshold", std::to_string(latency_.threshold())},
+        {"tracking-table-max-keys", std::to_string(tracking_.max_keys())},
+        {"client-query-buffer-limit",
+         std::to_string(limits_.query_buffer_limit())},
+        {"client-output-buffer-limit", limits_.output_limits_string()},
+        {"maxmemory-clients", std::to_string(limits_.total_output_limit())},
+        {"hotkeys-sample-keys", std::to_string(hotkeys_sample_keys_.load())},
+        {"hll-sparse-max-bytes", std::to_string(hll_sparse_max_bytes_.load())},
+    };
 
-  if (tokens.size() >= 5) {
+    RESP response{.resp_type = RESP::type::ARRAY};
+    for (const auto &[name, value] : params) {
+      if (pattern != "*" && pattern != name)
+        continue;
+      response.elements.push_back(
+          {.resp_type = RESP::type::BULK_STRING, .str = name});
+      response.elements.push_back(
+          {.resp_type = RESP::type::BULK_STRING, .str = value});
+    }
+    std::string serialized = serialize_RESP(response);
+    reply(client, serialized);
+    return;
+  } else if (sub == "set" && tokens.size() == 4 &&
+             (to_lower(tokens[2]).starts_with("client-") ||
+              to_lower(tokens[2]) == "maxmemory-clients")) {
+    std::string param = to_lower(tokens[2]);
+    u64 bytes;
+    if (param == "client-output-buffer-limit") {
+      if (!limits_.set_output_limits(tokens[3])) {
+        send_error(client, std::format("ERR invalid value for '{}'", param));
+        return;
+      }
+    } else if (param == "client-query-buffer-limit") {
+      // Same floor as Redis, so a typo cannot cut off every client.
+      if (!parse_memory_amount(tokens[3], bytes) || bytes < 1024 * 1024) {
+        send_error(client, std::format("ERR invalid value for '{}'", param));
+        return;
+      }
+      limits_.set_query_buffer_limit(bytes);
+    } else if (param == "maxmemory-clients") {
+      if (!parse_memory_amount(tokens[3], bytes)) {
+        send_error(client, std::format("ERR invalid value for '{}'", param));
+        return;
+      }
+      limits_.set_total_output_limit(bytes);
+      output_pressure_.wake_all();
+    } else {
+      send_error(client,
+                 std::format("ERR unsupported CONFIG parameter '{}'", param));
+      return;
+    }
+  } else if (sub == "set" && tokens.size() == 4) {
+    std::string param = to_lower(tokens[2]);
+    i64 value;
     try {
-      std::string opt = tokens[3];
-      i64 amount = std::stoll(tokens[4]);
-      if (opt == "EX")
-        ttl_ms = amount * 1000;
-      else if (opt == "PX")
-        ttl_ms = amount;
+      value = std::stoll(tokens[3]);
     } catch (...) {
+      send_error(client, std::format("ERR invalid value for '{}'", param));
+      return;
+    }
+
+    if (param == "slowlog-log-slower-than") {
+      slowlog_.set_slower_than(value);
+    } else if (param == "slowlog-max-len" && value >= 0) {
+      slowlog_.set_max_len(static_cast<size_t>(value));
+    } else if (param == "latency-monitor-threshold" && value >= 0) {
+      latency_.set_threshold(static_cast<u64>(value));
+    } else if (param == "tracking-table-max-keys" && value > 0) {
+      tracking_.set_max_keys(static_cast<size_t>(value));
+    } else if (param == "hotkeys-sample-keys" && value >= 0) {
+      hotkeys_sample_keys_.store(static_cast<u64>(value));
+    } else if (param == "hll-sparse-max-bytes" && value >= 0) {
+      hll_sparse_max_bytes_.store(static_cast<u64>(value));
+    } else {
+      send_error(client,
+                 std::format("ERR unsupported CONFIG parameter '{}'", param));
       return;
     }
+  } else {
+    send_error(client,
+               std::format("ERR unknown CONFIG subcommand '{}'", tokens[1]));
+    return;
   }
-  Value v{value, ttl_ms};
-  data_store_.set(key, v, ttl_ms);
 
   RESP response{.resp_type = RESP::type::SIMPLE_STRING, .str = "OK"};
   std::string serialized = serialize_RESP(response);
-  robust_send(client_fd, serialized.c_str(), serialized.size());
+  reply(client, serialized);
 }
 
-void TCPServer::handle_get(const std::vector<std::string> &tokens,
-                           int client_fd) {
-  if (tokens.size() < 2)
+void TCPServer::handle_slowlog(std::vector<std::string> &tokens,
+                               Client &client) {
+  if (tokens.size() < 2) {
+    send_error(client,
+               "ERR wrong number of arguments for 'slowlog' command");
     return;
-
-  std::string key = tokens[1];
-  std::optional<RedisData> opt = data_store_.get(key);
-  std::optional<std::string> result;
-  if (opt) {
-    std::visit(
-        [&result](const auto &value) {
-          using T = std::decay_t<decltype(value)>;
-          if constexpr (std::is_same_v<T, std::string>) {
-            result = value;
-          }
-        },
-        *opt);
   }
 
+  std::string sub = to_lower(tokens[1]);
   RESP response;
-  if (result) {
-    response = {.resp_type = RESP::type::BULK_STRING, .str = *result};
+  if (sub == "get") {
+    size_t count = 10;
+    if (tokens.size() > 2) {
+      try {
+        i64 n = std::stoll(tokens[2]);
+        count = n < 0 ? SIZE_MAX : static_cast<size_t>(n);
+      } catch (...) {
+        send_error(client, "ERR value is not an integer or out of range");
+        return;
+      }
+    }
+
+    response = {.resp_type = RESP::type::ARRAY};
+    for (const auto &entry : slowlog_.get(count)) {
+      RESP argv{.resp_type = RESP::type::ARRAY};
+      for (const auto &arg : entry.argv) {
+        argv.elements.push_back(
+            {.resp_type = RESP::type::BULK_STRING, .str = arg});
+      }
+      RESP item{.resp_type = RESP::type::ARRAY};
+      item.elements = {
+          {.resp_type = RESP::type::INTEGER,
+           .integer = static_cast<i64>(entry.id)},
+          {.resp_type = RESP::type::INTEGER, .integer = entry.timestamp},
+          {.resp_type = RESP::type::INTEGER,
+           .integer = static_cast<i64>(entry.duration_us)},
+          std::move(argv),
+          {.resp_type = RESP::type::BULK_STRING, .str = entry.client_addr},
+          {.resp_type = RESP::type::BULK_STRING, .str = ""},
+      };
+      response.elements.push_back(std::move(item));
+    }
+  } else if (sub == "len") {
+    response = {.resp_type = RESP::type::INTEGER,
+                .integer = static_cast<i64>(slowlog_.len())};
+  } else if (sub == "reset") {
+    slowlog_.reset();
+    response = {.resp_type = RESP::type::SIMPLE_STRING, .str = "OK"};
   } else {
-    response = {.resp_type = RESP::type::BULK_STRING, .is_null = true};
+    send_error(client,
+               std::format("ERR unknown SLOWLOG subcommand '{}'", tokens[1]));
+    return;
   }
 
   std::string serialized = serialize_RESP(response);
-  robust_send(client_fd, serialized.c_str(), serialized.size());
+  reply(client, serialized);
 }
 
-void TCPServer::handle_rpush(const std::vector<std::string> &tokens,
-                             int client_fd) {
-  if (tokens.size() < 3) {
-    RESP e{.resp_type=RESP::type::ERROR, .str="Wrong number of arguments for RPUSH"};
-    std::string serialized = serialize_RESP(e);
-    robust_send(client_fd, serialized.c_str(), serialized.size());
+void TCPServer::handle_latency(std::vector<std::string> &tokens,
+                               Client &client) {
+  if (tokens.size() < 2) {
+    send_error(client,
+               "ERR wrong number of arguments for 'latency' command");
     return;
   }
 
-  const std::string& key = tokens[1];
-  Value *v = data_store_.get_or_create(key);
-  RedisData &d = v->data;
+  std::string sub = to_lower(tokens[1]);
+  RESP response;
+  if (sub == "latest") {
+    response = {.resp_type = RESP::type::ARRAY};
+    for (const auto &[name, ev] : latency_.latest()) {
+      const LatencySample &last = ev.latest();
+      RESP item{.resp_type = RESP::type::ARRAY};
+      item.elements = {
+          {.resp_type = RESP::type::BULK_STRING, .str = name},
+          {.resp_type = RESP::type::INTEGER, .integer = last.timestamp},
+          {.resp_type = RESP::type::INTEGER,
+           .integer = static_cast<i64>(last.latency_ms)},
+          {.resp_type = RESP::type::INTEGER,
+           .integer = static_cast<i64>(ev.max_ms)},
+      };
+      response.elements.push_back(std::move(item));
+    }
+  } else if (sub == "history" && tokens.size() == 3) {
+    response = {.resp_type = RESP::type::ARRAY};
+    for (const auto &sample : latency_.history(tokens[2])) {
+      RESP item{.resp_type = RESP::type::ARRAY};
+      item.elements = {
+          {.resp_type = RESP::type::INTEGER, .integer = sample.timestamp},
+          {.resp_type = RESP::type::INTEGER,
+           .integer = static_cast<i64>(sample.latency_ms)},
+      };
+      response.elements.push_back(std::move(item));
+    }
+  } else if (sub == "reset") {
+    std::vector<std::string> events(tokens.begin() + 2, tokens.end());
+    response = {.resp_type = RESP::type::INTEGER,
+                .integer = static_cast<i64>(latency_.reset(events))};
+  } else if (sub == "doctor") {
+    response = {.resp_type = RESP::type::BULK_STRING,
+                .str = latency_.doctor()};
+  } else {
+    send_error(client,
+               std::format("ERR unknown LATENCY subcommand '{}'", tokens[1]));
+    return;
+  }
 
-  auto *list = std::get_if<RedisList>(&d);
-  if (!list) {
-    RESP e{.resp_type=RESP::type::ERROR, .str="KEY HOLDING WRONG TYPE VALUE"};
-    std::string serialized = serialize_RESP(e);
-    robust_send(client_fd, serialized.c_str(), serialized.size());
+  std::string serialized = serialize_RESP(response);
+  reply(client, serialized);
+}
+
+void TCPServer::handle_cluster(std::vector<std::string> &tokens,
+                               Client &client) {
+  if (!cluster_) {
+    send_error(client, "ERR This instance has cluster support disabled");
+    return;
+  }
+  if (tokens.size() < 2) {
+    send_error(client,
+               "ERR wrong number of arguments for 'cluster' command");
     return;
   }
 
-  for (auto i = 2; i < tokens.size(); i++) {
-    list->push_back(tokens[i]);
+  std::string sub = to_lower(tokens[1]);
+  RESP response;
+
+  if (sub == "myid") {
+    response = {.resp_type = RESP::type::BULK_STRING,
+                .str = cluster_->myself().id};
+  } else if (sub == "keyslot" && tokens.size() == 3) {
+    response = {.resp_type = RESP::type::INTEGER,
+                .integer = key_hash_slot(tokens[2])};
+  } else if (sub == "info") {
+    response = {.resp_type = RESP::type::BULK_STRING, .str = cluster_->info()};
+  } else if (sub == "nodes") {
+    response = {.resp_type = RESP::type::BULK_STRING,
+                .str = cluster_->nodes_description()};
+  } else if (sub == "slots") {
+    response = {.resp_type = RESP::type::ARRAY};
+    for (const auto &[start, end, node] : cluster_->slot_ranges()) {
+      RESP node_info{.resp_type = RESP::type::ARRAY};
+      node_info.elements = {
+          {.resp_type = RESP::type::BULK_STRING, .str = node.host},
+          {.resp_type = RESP::type::INTEGER, .integer = node.port},
+          {.resp_type = RESP::type::BULK_STRING, .str = node.id},
+      };
+      RESP range{.resp_type = RESP::type::ARRAY};
+      range.elements = {
+          {.resp_type = RESP::type::INTEGER, .integer = start},
+          {.resp_type = RESP::type::INTEGER, .integer = end},
+          std::move(node_info),
+      };
+      response.elements.push_back(std::move(range));
+    }
+  } else if (sub == "meet" && tokens.size() == 4) {
+    // No cluster bus: ask the peer for its id directly, within one timeout.
+    try {
+      int port = std::stoi(tokens[3]);
+      auto deadline = std::chrono::steady_clock::now() + MEET_TIMEOUT;
+      AsyncConnection peer(tokens[2], port, MEET_TIMEOUT);
+      std::future<RESP> reply = peer.command({"CLUSTER", "MYID"});
+      if (reply.wait_until(deadline) != std::future_status::ready) {
+        send_error(client, "ERR timeout waiting for the peer");
+        return;
+      }
+      RESP id = reply.get();
+      if (id.resp_type != RESP::type::BULK_STRING) {
+        send_error(client, "ERR peer is not a cluster node");
+        return;
+      }
+      cluster_->add_node({.id = id.str, .host = tokens[2], .port = port});
+    } catch (const std::exception &e) {
+      send_error(client, std::format("ERR {}", e.what()));
+      return;
+    }
+    response = {.resp_type = RESP::type::SIMPLE_STRING, .str = "OK"};
+  } else if ((sub == "addslots" || sub == "delslots") && tokens.size() > 2) {
+    std::vector<u16> slots;
+    for (size_t i = 2; i < tokens.size(); i++) {
+      u16 slot;
+      if (!parse_slot(tokens[i], slot)) {
+        send_error(client, "ERR Invalid or out of range slot");
+        return;
+      }
+      slots.push_back(slot);
+    }
+    std::string myid = cluster_->myself().id;
+    for (u16 slot : slots) {
+      if (sub == "addslots")
+        cluster_->assign_slot(slot, myid);
+      else
+        cluster_->unassign_slot(slot);
+    }
+    response = {.resp_type = RESP::type::SIMPLE_STRING, .str = "OK"};
+  } else if (sub == "addslotsrange" && tokens.size() >= 4 &&
+             tokens.size() % 2 == 0) {
+    std::string myid = cluster_->myself().id;
+    for (size_t i = 2; i + 1 < tokens.size(); i += 2) {
+      u16 start, end;
+      if (!parse_slot(tokens[i], start) || !parse_slot(tokens[i + 1], end) ||
+          start > end) {
+        send_error(client, "ERR Invalid or out of range slot");
+        return;
+      }
+      for (u32 slot = start; slot <= end; slot++) {
+        cluster_->assign_slot(static_cast<u16>(slot), myid);
+      }
+    }
+    response = {.resp_type = RESP::type::SIMPLE_STRING, .str = "OK"};
+  } else if (sub == "setslot" && tokens.size() >= 4) {
+    u16 slot;
+    if (!parse_slot(tokens[2], slot)) {
+      send_error(client, "ERR Invalid or out of range slot");
+      return;
+    }
+    std::string action = to_lower(tokens[3]);
+    bool ok = false;
+    if (action == "stable") {
+      cluster_->set_stable(slot);
+      ok = true;
+    } else if (tokens.size() == 5 && action == "node") {
+      ok = cluster_->assign_slot(slot, tokens[4]);
+    } else if (tokens.size() == 5 && action == "migrating") {
+      ok = cluster_->set_migrating(slot, tokens[4]);
+    } else if (tokens.size() == 5 && action == "importing") {
+      ok = cluster_->set_importing(slot, tokens[4]);
+    }
+    if (!ok) {
+      send_error(client, "ERR Invalid CLUSTER SETSLOT action or node");
+      return;
+    }
+    response = {.resp_type = RESP::type::SIMPLE_STRING, .str = "OK"};
+  } else if (sub == "countkeysinslot" && tokens.size() == 3) {
+    u16 slot;
+    if (!parse_slot(tokens[2], slot)) {
+      send_error(client, "ERR Invalid slot");
+      return;
+    }
+    response = {.resp_type = RESP::type::INTEGER,
+                .integer = static_cast<i64>(
+                    data_store_.count_keys_in_slot(slot))};
+  } else if (sub == "getkeysinslot" && tokens.size() == 4) {
+    u16 slot;
+    i64 count;
+    try {
+      count = std::stoll(tokens[3]);
+    } catch (...) {
+      count = -1;
+    }
+    if (!parse_slot(tokens[2], slot) || count < 0) {
+      send_error(client, "ERR Invalid slot or number of keys");
+      return;
+    }
+    response = {.resp_type = RESP::type::ARRAY};
+    for (auto &key :
+         data_store_.keys_in_slot(slot, static_cast<size_t>(count))) {
+      response.elements.push_back(
+          {.resp_type = RESP::type::BULK_STRING, .str = std::move(key)});
+    }
+  } else {
+    send_error(client,
+               std::format("ERR unknown CLUSTER subcommand '{}'", tokens[1]));
+    return;
   }
 
-  RESP response {
-    .resp_type=RESP::type::INTEGER,
-    .integer=static_cast<i64>(list->size()),
-  };
   std::string serialized = serialize_RESP(response);
-  robust_send(client_fd, serialized.c_str(), serialized.size());
-  return;
+  reply(client, serialized);
+}
+
+void TCPServer::handle_asking(std::vector<std::string> &tokens,
+                              Client &client) {
+  if (!cluster_) {
+    send_error(client, "ERR This instance has cluster support disabled");
+    return;
+  }
+  client.asking = true;
+  send_ok(client);
+}
+
+std::shared_ptr<AsyncConnection>
+TCPServer::migrate_connection(const std::string &host, int port,
+                              std::chrono::milliseconds timeout) {
+  std::lock_guard lock(migrate_mtx_);
+  auto &conn = migrate_conns_[std::format("{}:{}", host, port)];
+  if (!conn || !conn->connected()) {
+    conn = std::make_shared<AsyncConnection>(host, port, timeout);
+  }
+  return conn;
+}
+
+// MIGRATE host port key|"" db timeout [COPY] [REPLACE] [KEYS key ...]
+// All keys travel as one pipelined batch of ASKING + RESTORE.
+void TCPServer::handle_migrate(std::vector<std::string> &tokens,
+                               Client &client) {
+  if (tokens.size() < 6) {
+    send_error(client,
+               "ERR wrong number of arguments for 'migrate' command");
+    return;
+  }
+
+  int port;
+  i64 timeout_ms;
+  try {
+    port = std::stoi(tokens[2]);
+    timeout_ms = std::stoll(tokens[5]);
+  } catch (...) {
+    send_error(client, "ERR value is not an integer or out of range");
+    return;
+  }
+  if (timeout_ms <= 0)
+    timeout_ms = 1000;
+
+  bool copy = false, replace = false;
+  std::vector<std::string> keys;
+  if (!tokens[3].empty())
+    keys.push_back(tokens[3]);
+  for (size_t i = 6; i < tokens.size(); i++) {
+    std::string opt = to_lower(tokens[i]);
+    if (opt == "copy") {
+      copy = true;
+    } else if (opt == "replace") {
+      replace = true;
+    } else if (opt == "keys" && tokens[3].empty()) {
+      keys.assign(tokens.begin() + i + 1, tokens.end());
+      break;
+    } else {
+      send_error(client, "ERR syntax error");
+      return;
+    }
+  }
+
+  // Each key's version at dump time: a key written while the batch is in
+  // flight is kept here rather than erased, and reported as an error.
+  std::vector<std::string> moved;
+  std::vector<u64> versions;
+  std::vector<std::vector<std::string>> batch;
+  for (const auto &key : keys) {
+    u64 version = 0;
+    auto dumped = data_store_.dump(key, &version);
+    if (!dumped)
+      continue;
+    std::vector<std::string> restore = {"RESTORE", key,
+                                        std::to_string(dumped->second),
+                                        dump_payload(dumped->first)};
+    if (replace)
+      restore.push_back("REPLACE");
+    batch.push_back({"ASKING"});
+    batch.push_back(std::move(restore));
+    moved.push_back(key);
+    versions.push_back(version);
+  }
+
+  if (moved.empty()) {
+    RESP response{.resp_type = RESP::type::SIMPLE_STRING, .str = "NOKEY"};
+    std::string serialized = serialize_RESP(response);
+    reply(client, serialized);
+    return;
+  }
+
+  std::vector<std::future<RESP>> replies;
+  try {
+    replies = migrate_connection(tokens[1], port,
+                                 std::chrono::milliseconds(timeout_ms))
+                  ->pipeline(batch);
+  } catch (const std::exception &e) {
+    send_error(client, std::format("IOERR error or timeout connecting to "
+                                      "target instance: {}",
+                                      e.what()));
+    return;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(timeout_ms);
+  for (size_t i = 0; i < replies.size(); i++) {
+    if (replies[i].wait_until(deadline) != std::future_status::ready) {
+      send_error(client,
+                 "IOERR error or timeout reading to target instance");
+      return;
+    }
+    RESP r = replies[i].get();
+    if (r.resp_type == RESP::type::ERROR) {
+      send_error(client,
+                 std::format("ERR Target instance replied with error: {}",
+                             r.str));
+      return;
+    }
+  }
+
+  if (!copy) {
+    std::vector<std::string> changed;
+    for (size_t i = 0; i < moved.size(); i++) {
+      if (!data_store_.erase_if_version(moved[i], versions[i]))
+        changed.push_back(moved[i]);
+    }
+    if (!changed.empty()) {
+      send_error(client,
+                 std::format("ERR {} key(s) modified during MIGRATE were "
+                             "kept on this node, first: '{}'",
+                             changed.size(), changed.front()));
+      return;
+    }
+  }
+  send_ok(client);
+}
+
+// RESTORE key ttl payload [REPLACE]
+void TCPServer::handle_restore(std::vector<std::string> &tokens,
+                               Client &client) {
+  if (tokens.size() < 4) {
+    send_error(client,
+               "ERR wrong number of arguments for 'restore' command");
+    return;
+  }
+
+  i64 ttl_ms;
+  try {
+    ttl_ms = std::stoll(tokens[2]);
+  } catch (...) {
+    send_error(client, "ERR Invalid TTL value, must be >= 0");
+    return;
+  }
+  bool replace = tokens.size() > 4 && to_lower(tokens[4]) == "replace";
+
+  const std::string &key = tokens[1];
+  if (!replace && data_store_.contains(key)) {
+    send_error(client, "BUSYKEY Target key name already exists.");
+    return;
+  }
+
+  auto data = restore_payload(tokens[3]);
+  if (!data) {
+    send_error(client, "ERR DUMP payload version or checksum are wrong");
+    return;
+  }
+  data_store_.set(key, Value{std::move(*data)}, ttl_ms > 0 ? ttl_ms : -1);
+  send_ok(client);
 }
 
-void TCPServer::handle_client(int client_fd, int client_id) {
-  std::string buffer;
+void TCPServer::handle_client(int client_fd, int client_id, std::string addr) {
+  Client client{.fd = client_fd, .id = client_id, .addr = std::move(addr),
+                .stats = stats_.acquire_shard(),
+                .pressure = &output_pressure_};
+  client.created_ms = now_ms();
+  client.last_interaction_ms.store(client.created_ms);
+  {
+    std::unique_lock lock(clients_mtx_);
+    clients_[client_id] = &client;
+  }
+  connected_clients_++;
+  total_connections_++;
+  t_current_client_id = client_id;
+
+  RequestReader reader;
+  std::vector<std::string> tokens;
+  char temp[16384];
   while (running_) {
-    char temp[4096];
-    ssize_t n = recv(client_fd, temp, sizeof(temp), 0);
+    wait_for_output_drain(client);
+    if (client.tracking && !wait_for_request(client))
+      break;
+    // Large bulk arguments are received in place; everything else is
+    // buffered and parsed.
+    std::span<char> direct = reader.direct_buffer();
+    ssize_t n = direct.empty()
+                    ? recv(client_fd, temp, sizeof(temp), 0)
+                    : recv(client_fd, direct.data(), direct.size(), 0);
     if (n <= 0)
       break;
+    if (direct.empty())
+      reader.feed(temp, static_cast<size_t>(n));
+    else
+      reader.direct_commit(static_cast<size_t>(n));
 
-    buffer.append(temp, n);
+    client.command_clock = std::chrono::steady_clock::now();
+    client.last_interaction_ms.store(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            client.command_clock.time_since_epoch())
+            .count(),
+        std::memory_order_relaxed);
 
-    while (true) {
-      size_t pos = 0;
-      try {
-        RESP r = parse_RESP(buffer, pos);
-        buffer.erase(0, pos);
-        if (r.resp_type == RESP::type::ARRAY) {
-          std::vector<std::string> tokens = RESP_to_tokens(r);
-          execute_command(tokens, client_fd);
-        }
-      } catch (...) {
-        break;
+    try {
+      reader.set_limit(limits_.query_buffer_limit());
+      while (reader.next(tokens)) {
+        execute_command(tokens, client);
       }
+      client.query_buffer.store(reader.pending_bytes(),
+                                std::memory_order_relaxed);
+    } catch (const QueryBufferLimitError &) {
+      query_limit_disconnections_++;
+      std::cerr << std::format("Closing client {} ({}): query buffer limit "
+                               "reached\n",
+                               client.id, client.addr);
+      break;
+    } catch (const std::runtime_error &e) {
+      send_error(client, std::format("ERR Protocol error: {}", e.what()));
+      break;
     }
   }
+  {
+    std::unique_lock lock(clients_mtx_);
+    clients_.erase(client_id);
+  }
+  disable_tracking(client);
+  // No writer can reach the client now; give back what it never sent.
+  output_end(client, client.push_queue.size());
+  if (client.push_event >= 0)
+    close(client.push_event);
+  stats_.release_shard(client.stats);
+  connected_clients_--;
   close(client_fd);
 }
 
+// Tracking connections only: waits for request bytes while sending the
+// pushes other threads queue in the meantime. False once the server stops.
+bool TCPServer::wait_for_request(Client &client) {
+  pollfd fds[2] = {{.fd = client.fd, .events = POLLIN, .revents = 0},
+                   {.fd = client.push_event, .events = POLLIN, .revents = 0}};
+  while (running_) {
+    send_queued_pushes(client);
+    if (poll(fds, 2, -1) < 0 && errno != EINTR)
+      return true; // recv reports the error
+    if (fds[1].revents & POLLIN) {
+      eventfd_t ignored;
+      eventfd_read(client.push_event, &ignored);
+    }
+    if (fds[0].revents)
+      return true;
+  }
+  return false;
+}
+
+// A client whose pending output is over its soft (or else hard) limit is not
+// reading what it already asked for. Its requests are not read until that
+// drains or enforce_output_limits() closes it, instead of producing more.
+// While pending output across all clients is over maxmemory-clients, no
+// connection reads requests, so no new replies or pushes pile up.
+void TCPServer::wait_for_output_drain(Client &client) {
+  auto paused = [&] {
+    if (!running_ || client.closing.load())
+      return false;
+    OutputLimit limit = limits_.output_limit(ClientClass::NORMAL);
+    u64 threshold = limit.soft ? limit.soft : limit.hard;
+    if (threshold && client.output_pending.load() >= threshold)
+      return true;
+    u64 budget = limits_.total_output_limit();
+    return budget && output_pressure_.total() >= budget;
+  };
+  // Queued pushes are this thread's own output to drain, so they wake it.
+  auto idle = [&] { return !client.has_pushes.load() && paused(); };
+  for (;;) {
+    send_queued_pushes(client);
+    if (!paused())
+      return;
+    output_pressure_.wait_while(idle);
+  }
+}
+
+// Runs on the maintenance thread. Shutting the socket down fails every send
+// blocked on it and ends the connection thread's recv, which then cleans up.
+// Over maxmemory-clients, the client with the most pending output is closed
+// as well, one per call, like Redis' client eviction.
+void TCPServer::enforce_output_limits() {
+  i64 now = now_ms();
+  std::shared_lock lock(clients_mtx_);
+  Client *largest = nullptr;
+  size_t largest_pending = 0;
+  for (auto &[id, c] : clients_) {
+    size_t pending = c->output_pending.load(std::memory_order_relaxed);
+    if (!limits_.output_over_limit(ClientClass::NORMAL, pending, now,
+                                   c->soft_limit_since)) {
+      if (pending > largest_pending && !c->closing.load()) {
+        largest = c;
+        largest_pending = pending;
+      }
+      continue;
+    }
+    if (c->closing.exchange(true))
+      continue;
+    output_limit_disconnections_++;
+    std::cerr << std::format("Closing client {} ({}): output buffer limit "
+                             "reached ({} bytes pending)\n",
+                             id, c->addr, pending);
+    shutdown(c->fd, SHUT_RDWR);
+  }
+
+  u64 budget = limits_.total_output_limit();
+  if (!budget || output_pressure_.total() < budget || !largest ||
+      largest->closing.exchange(true))
+    return;
+  evicted_clients_++;
+  std::cerr << std::format("Evicting client {} ({}): maxmemory-clients "
+                           "reached ({} bytes pending)\n",
+                           largest->id, largest->addr, largest_pending);
+  shutdown(largest->fd, SHUT_RDWR);
+}
+
 void TCPServer::start() {
   std::cout << std::unitbuf;
   running_ = true;
@@ -189,7 +2392,17 @@ void TCPServer::start() {
   std::thread maintenance_thread([this]() {
     while (running_) {
       std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      auto cycle_start = std::chrono::steady_clock::now();
       data_store_.active_expiry_cycle();
+      latency_.add_sample_if_needed(
+          "expire-cycle",
+          static_cast<u64>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::steady_clock::now() - cycle_start)
+                               .count()));
+      enforce_output_limits();
+      if (u64 keys = hotkeys_sample_keys_.load(); keys > 0) {
+        sampler_.step(data_store_, keys);
+      }
     }
   });
 
@@ -225,7 +2438,10 @@ void TCPServer::start() {
   close(server_fd);
 }
 
-void TCPServer::stop() { running_ = false; }
+void TCPServer::stop() {
+  running_ = false;
+  output_pressure_.wake_all();
+}
 
 void TCPServer::accept_clients(int server_fd) {
   while (running_) {
@@ -234,10 +2450,15 @@ void TCPServer::accept_clients(int server_fd) {
     int client_fd = accept(server_fd, (struct sockaddr *)&client, &addrlen);
     if (client_fd < 0)
       continue;
+    configure_socket_safety(client_fd);
+
+    char ip[INET_ADDRSTRLEN] = {0};
+    inet_ntop(AF_INET, &client.sin_addr, ip, sizeof(ip));
+    std::string addr = std::format("{}:{}", ip, ntohs(client.sin_port));
 
     int client_id = ++client_id_counter;
-    std::thread([this, client_fd, client_id]() {
-      handle_client(client_fd, client_id);
+    std::thread([this, client_fd, client_id, addr = std::move(addr)]() {
+      handle_client(client_fd, client_id, addr);
     }).detach();
   }
 }
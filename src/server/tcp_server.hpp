@@ -1,14 +1,93 @@
 #pragma once
+#include "client/async_connection.hpp"
 #include "common/concurrent_store.hpp"
+#include "common/hyperloglog.hpp"
+#include "server/client_limits.hpp"
+#include "server/cluster.hpp"
+#include "server/key_sampler.hpp"
+#include "server/latency.hpp"
+#include "server/slowlog.hpp"
+#include "server/stats.hpp"
+#include "server/tracking.hpp"
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace Redis {
 
+// A command held between MULTI and EXEC.
+struct QueuedCommand {
+  size_t command; // index into the command table
+  std::vector<std::string> tokens;
+};
+
+// Per-connection state owned by the thread serving the client.
+struct Client {
+  int fd;
+  int id;
+  std::string addr;
+  StatsShard *stats;
+  OutputPressure *pressure; // the server's, shared by every client
+  bool asking = false;
+
+  // CLIENT TRACKING. Changed only under the server's tracking registry lock,
+  // since invalidating threads read them.
+  bool tracking = false;
+  bool tracking_bcast = false;
+  bool tracking_noloop = false;
+
+  // MULTI/EXEC. WATCH records each key's version; EXEC compares them under
+  // the shard locks, so writers never look for watchers.
+  bool in_multi = false;
+  bool multi_failed = false; // a command was rejected while queueing
+  std::vector<QueuedCommand> queued;
+  std::vector<std::pair<std::string, u64>> watched;
+  // Set while EXEC runs: replies are collected here and sent as one array.
+  std::string *reply_buffer = nullptr;
+  // Slow log copy of the running command's arguments, reused across commands.
+  std::vector<std::string> slowlog_argv;
+  // When the previous command in this read finished (or the read returned).
+  // call() times each command from here, so it reads the clock only once.
+  std::chrono::steady_clock::time_point command_clock;
+
+  // Read by CLIENT LIST and the maintenance thread while the connection
+  // thread and invalidating writers update them.
+  i64 created_ms = 0;
+  std::atomic<i64> last_interaction_ms{0};
+  std::atomic<int> last_command{-1};
+  std::atomic<int> multi_commands{-1}; // queued so far, -1 outside MULTI
+  std::atomic<size_t> query_buffer{0};
+  // Bytes handed to a send that has not completed yet: a client that stops
+  // reading makes writers pile up here.
+  std::atomic<size_t> output_pending{0};
+  i64 soft_limit_since = 0; // maintenance thread only
+  std::atomic<bool> closing{false};
+
+  // Tracking pushes from other threads. Only the connection's own thread
+  // writes to fd: it sends these ahead of its next reply, or when woken
+  // through push_event while waiting for a request, so a writer never blocks
+  // on this socket. The queued bytes count as output_pending. Past
+  // PUSH_QUEUE_LIMIT the queue collapses into one flush-everything frame.
+  static constexpr size_t PUSH_QUEUE_LIMIT = 1 << 20;
+  std::mutex push_mtx;
+  std::string push_queue;
+  bool push_overflow = false;
+  std::atomic<bool> has_pushes{false};
+  int push_event = -1; // eventfd, created when tracking is first enabled
+};
+
 class TCPServer {
 public:
-  TCPServer(const std::string &address, int port);
+  TCPServer(const std::string &address, int port,
+            bool cluster_enabled = false);
   ~TCPServer();
 
   void start();
@@ -16,21 +95,139 @@ public:
 
 private:
   void accept_clients(int server_fd);
-  void handle_client(int client_fd, int client_id);
+  void handle_client(int client_fd, int client_id, std::string addr);
+  void wait_for_output_drain(Client &client);
+  bool wait_for_request(Client &client);
+  void enforce_output_limits();
+  std::string client_list();
+
+  void execute_command(std::vector<std::string> &tokens, Client &client);
+  std::optional<size_t> admit_command(std::vector<std::string> &tokens,
+                                      Client &client);
+  void call(size_t command, std::vector<std::string> &tokens, Client &client);
+
+  void handle_ping(std::vector<std::string> &tokens, Client &client);
+  void handle_echo(std::vector<std::string> &tokens, Client &client);
+  void handle_set(std::vector<std::string> &tokens, Client &client);
+  void handle_get(std::vector<std::string> &tokens, Client &client);
+  void handle_incr(std::vector<std::string> &tokens, Client &client);
+  void handle_decr(std::vector<std::string> &tokens, Client &client);
+  void handle_incrby(std::vector<std::string> &tokens, Client &client);
+  void handle_decrby(std::vector<std::string> &tokens, Client &client);
+  void handle_incrbyfloat(std::vector<std::string> &tokens, Client &client);
+  void handle_getset(std::vector<std::string> &tokens, Client &client);
+  void handle_getdel(std::vector<std::string> &tokens, Client &client);
+  void handle_setnx(std::vector<std::string> &tokens, Client &client);
+  void handle_rpush(std::vector<std::string> &tokens, Client &client);
+  void handle_setbit(std::vector<std::string> &tokens, Client &client);
+  void handle_getbit(std::vector<std::string> &tokens, Client &client);
+  void handle_bitcount(std::vector<std::string> &tokens, Client &client);
+  void handle_bitpos(std::vector<std::string> &tokens, Client &client);
+  void handle_bitop(std::vector<std::string> &tokens, Client &client);
+  void handle_pfadd(std::vector<std::string> &tokens, Client &client);
+  void handle_pfcount(std::vector<std::string> &tokens, Client &client);
+  void handle_pfmerge(std::vector<std::string> &tokens, Client &client);
+  void handle_multi(std::vector<std::string> &tokens, Client &client);
+  void handle_exec(std::vector<std::string> &tokens, Client &client);
+  void handle_discard(std::vector<std::string> &tokens, Client &client);
+  void handle_watch(std::vector<std::string> &tokens, Client &client);
+  void handle_unwatch(std::vector<std::string> &tokens, Client &client);
+  void handle_scan(std::vector<std::string> &tokens, Client &client);
+  void handle_keys(std::vector<std::string> &tokens, Client &client);
+  void handle_dbsize(std::vector<std::string> &tokens, Client &client);
+  void handle_hotkeys(std::vector<std::string> &tokens, Client &client);
+  void handle_client_command(std::vector<std::string> &tokens,
+                             Client &client);
+  void handle_info(std::vector<std::string> &tokens, Client &client);
+  void handle_config(std::vector<std::string> &tokens, Client &client);
+  void handle_slowlog(std::vector<std::string> &tokens, Client &client);
+  void handle_latency(std::vector<std::string> &tokens, Client &client);
+  void handle_cluster(std::vector<std::string> &tokens, Client &client);
+  void handle_asking(std::vector<std::string> &tokens, Client &client);
+  void handle_migrate(std::vector<std::string> &tokens, Client &client);
+  void handle_restore(std::vector<std::string> &tokens, Client &client);
 
-  void execute_command(const std::vector<std::string> &tokens, int client_fd);
+  void reply_incr(Client &client, const std::string &key, i64 delta);
 
-  void handle_ping(int client_fd);
-  void handle_echo(const std::vector<std::string> &tokens, int client_fd);
-  void handle_set(const std::vector<std::string> &tokens, int client_fd);
-  void handle_get(const std::vector<std::string> &tokens, int client_fd);
-  void handle_rpush(const std::vector<std::string> &tokens, int client_fd);
+  std::string info_section(std::string_view section);
+
+  // Handlers may consume their arguments (SET moves the value out).
+  using Handler = void (TCPServer::*)(std::vector<std::string> &, Client &);
+  // Arity and key positions follow Redis: arity counts the name and is
+  // negated for "at least"; first/last argument index and step, with a
+  // negative last counting from the end. first_key == 0 means no keys.
+  struct CommandEntry {
+    std::string_view name;
+    Handler handler;
+    int arity;
+    int first_key;
+    int last_key;
+    int key_step;
+  };
+  static const std::vector<CommandEntry> command_table_;
+
+  // Appends the key arguments of a command to keys.
+  static void append_keys(const CommandEntry &cmd,
+                          const std::vector<std::string> &tokens,
+                          std::vector<std::string> &keys);
+
+  bool redirect_for_cluster(const CommandEntry &cmd,
+                            const std::vector<std::string> &tokens,
+                            Client &client);
+  // MIGRATE connects within the command's own timeout.
+  std::shared_ptr<AsyncConnection>
+  migrate_connection(const std::string &host, int port,
+                     std::chrono::milliseconds timeout);
+  // CLUSTER MEET gives up on an unresponsive peer after this long.
+  static constexpr std::chrono::milliseconds MEET_TIMEOUT{2000};
+
+  void enable_tracking(Client &client, bool bcast, bool noloop,
+                       std::vector<std::string> prefixes);
+  void disable_tracking(Client &client);
+  void invalidate_key(const std::string &key);
+  // Pushes an invalidation for key to the given clients; nullptr means
+  // "flush everything".
+  void send_invalidation(std::vector<u32> client_ids, const std::string *key);
 
   std::string host_;
   int port_;
   std::atomic<bool> running_;
 
   ConcurrentStore data_store_;
+
+  std::unordered_map<std::string_view, size_t> command_index_;
+  CommandStats stats_;
+  SlowLog slowlog_;
+  LatencyMonitor latency_;
+  std::atomic<u64> connected_clients_{0};
+  std::atomic<u64> total_connections_{0};
+  std::atomic<u64> unknown_commands_{0};
+  // The store's expired_keys count at the last CONFIG RESETSTAT.
+  std::atomic<u64> expired_keys_base_{0};
+
+  ClientLimits limits_;
+  std::shared_mutex clients_mtx_;
+  std::unordered_map<int, Client *> clients_;
+  std::atomic<u64> query_limit_disconnections_{0};
+  std::atomic<u64> output_limit_disconnections_{0};
+  OutputPressure output_pressure_;
+  std::atomic<u64> evicted_clients_{0};
+
+  std::atomic<u64> hll_sparse_max_bytes_{hll::SPARSE_MAX_BYTES};
+
+  KeySampler sampler_;
+  // Keys visited per maintenance tick (10/s); 0 turns the sampler off.
+  std::atomic<u64> hotkeys_sample_keys_{1000};
+
+  TrackingTable tracking_;
+  std::shared_mutex tracking_clients_mtx_;
+  std::unordered_map<u32, Client *> tracking_clients_;
+  std::atomic<u32> tracking_count_{0};
+
+  std::unique_ptr<ClusterState> cluster_;
+  std::mutex migrate_mtx_;
+  std::unordered_map<std::string, std::shared_ptr<AsyncConnection>>
+      migrate_conns_;
 };
 
 } // namespace Redis
@@ -0,0 +1,97 @@
+#include "server/tracking.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace Redis {
+
+static u64 key_hash(std::string_view key) {
+  return std::hash<std::string_view>{}(key);
+}
+
+TrackingTable::TrackingTable(size_t max_keys) : max_keys_(max_keys) {}
+
+void TrackingTable::remember(std::string_view key, u32 client_id,
+                             std::vector<u32> &evicted) {
+  u64 hash = key_hash(key);
+  Stripe &stripe = stripes_[hash >> (64 - STRIPE_BITS)];
+  size_t limit = std::max<size_t>(max_keys() / STRIPE_COUNT, 1);
+
+  std::lock_guard lock(stripe.mtx);
+  auto it = stripe.readers.find(hash);
+  if (it == stripe.readers.end()) {
+    while (stripe.readers.size() >= limit) {
+      auto victim = stripe.readers.begin();
+      evicted.insert(evicted.end(), victim->second.begin(),
+                     victim->second.end());
+      stripe.readers.erase(victim);
+    }
+    it = stripe.readers.emplace(hash, std::vector<u32>{}).first;
+  }
+  auto &ids = it->second;
+  if (std::find(ids.begin(), ids.end(), client_id) == ids.end()) {
+    ids.push_back(client_id);
+  }
+}
+
+void TrackingTable::subscribe_prefix(u32 client_id, std::string prefix) {
+  std::unique_lock lock(prefix_mtx_);
+  auto it = std::find_if(prefixes_.begin(), prefixes_.end(),
+                         [&](const auto &p) { return p.first == prefix; });
+  if (it == prefixes_.end()) {
+    prefixes_.emplace_back(std::move(prefix), std::vector<u32>{});
+    it = prefixes_.end() - 1;
+  }
+  if (std::find(it->second.begin(), it->second.end(), client_id) ==
+      it->second.end()) {
+    it->second.push_back(client_id);
+  }
+  has_prefixes_.store(true, std::memory_order_release);
+}
+
+void TrackingTable::unsubscribe(u32 client_id) {
+  std::unique_lock lock(prefix_mtx_);
+  for (auto &[prefix, ids] : prefixes_) {
+    std::erase(ids, client_id);
+  }
+  std::erase_if(prefixes_, [](const auto &p) { return p.second.empty(); });
+  has_prefixes_.store(!prefixes_.empty(), std::memory_order_release);
+}
+
+void TrackingTable::collect(std::string_view key, std::vector<u32> &out) {
+  u64 hash = key_hash(key);
+  Stripe &stripe = stripes_[hash >> (64 - STRIPE_BITS)];
+  {
+    std::lock_guard lock(stripe.mtx);
+    auto it = stripe.readers.find(hash);
+    if (it != stripe.readers.end()) {
+      out.insert(out.end(), it->second.begin(), it->second.end());
+      stripe.readers.erase(it);
+    }
+  }
+
+  if (!has_prefixes_.load(std::memory_order_acquire)) {
+    return;
+  }
+  std::shared_lock lock(prefix_mtx_);
+  for (const auto &[prefix, ids] : prefixes_) {
+    if (key.starts_with(prefix)) {
+      out.insert(out.end(), ids.begin(), ids.end());
+    }
+  }
+}
+
+size_t TrackingTable::tracked_keys() const {
+  size_t total = 0;
+  for (const Stripe &stripe : stripes_) {
+    std::lock_guard lock(stripe.mtx);
+    total += stripe.readers.size();
+  }
+  return total;
+}
+
+size_t TrackingTable::prefixes() const {
+  std::shared_lock lock(prefix_mtx_);
+  return prefixes_.size();
+}
+
+} // namespace Redis
@@ -0,0 +1,61 @@
+#pragma once
+#include "common/types.hpp"
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Redis {
+
+// Which connections may hold a client-side cached copy of which keys, for
+// CLIENT TRACKING. Default mode records reads keyed by the 64-bit key hash, so
+// no key names are stored and a collision only costs a spurious invalidation.
+// The table is striped and bounded; when a stripe is full an entry is dropped
+// and its clients are reported back, since without the key name they can only
+// be told to flush everything. BCAST mode instead matches every write against
+// registered prefixes. Entries of disconnected clients are not purged eagerly:
+// ids are never reused, so the sender just skips unknown ids.
+class TrackingTable {
+public:
+  static constexpr int STRIPE_BITS = 4;
+  static constexpr size_t STRIPE_COUNT = size_t{1} << STRIPE_BITS;
+
+  explicit TrackingTable(size_t max_keys = 1'000'000);
+
+  // Records that client read key; appends clients whose entries were evicted
+  // to make room to `evicted`.
+  void remember(std::string_view key, u32 client_id,
+                std::vector<u32> &evicted);
+
+  void subscribe_prefix(u32 client_id, std::string prefix);
+  void unsubscribe(u32 client_id);
+
+  // Clients to notify for a write to key. Default-mode entries are consumed:
+  // a client is invalidated once per read, as in Redis.
+  void collect(std::string_view key, std::vector<u32> &out);
+
+  size_t tracked_keys() const;
+  size_t prefixes() const;
+  size_t max_keys() const { return max_keys_.load(std::memory_order_relaxed); }
+  void set_max_keys(size_t n) { max_keys_.store(n, std::memory_order_relaxed); }
+
+private:
+  struct alignas(64) Stripe {
+    mutable std::mutex mtx;
+    std::unordered_map<u64, std::vector<u32>> readers;
+  };
+
+  std::array<Stripe, STRIPE_COUNT> stripes_;
+  std::atomic<size_t> max_keys_;
+
+  mutable std::shared_mutex prefix_mtx_;
+  std::vector<std::pair<std::string, std::vector<u32>>> prefixes_;
+  std::atomic<bool> has_prefixes_{false};
+};
+
+} // namespace Redis
@@ -1,4 +1,5 @@
 #include "RESP.hpp"
+#include "simd_scan.hpp"
 #include <cerrno>
 #include <cstring>
 #include <iostream>
@@ -32,21 +33,28 @@ std::string vector_to_str(const std::vector<std::string> &vec) {
   return oss.str();
 }
 
-// reads line of string until \r\n is no longer found
-static std::string read_line_CRLF(const std::string &data, size_t &pos) {
-  size_t e = data.find("\r\n", pos);
+// reads line of string until \r\n is no longer found; the view points into
+// data, so it is only valid until data changes
+static std::string_view read_line_CRLF(const std::string &data, size_t &pos) {
+  size_t e = find_crlf(data.data() + pos, data.size() - pos);
   if (e == std::string::npos) {
     throw std::runtime_error("CRLF not found");
   }
-  std::string out = data.substr(pos, e - pos);
-  pos = e + 2;
+  std::string_view out(data.data() + pos, e);
+  pos += e + 2;
   return out;
 }
-// attempts to convert to long long
-static long long stoll_safe(const std::string &line) {
+// attempts to convert to long long; canonical digits take the non-throwing
+// fast path, anything else (signs, whitespace, errors) goes through stoll
+static long long stoll_safe(std::string_view line) {
+  long long fast;
+  if (parse_int_fast(line.data(), line.size(), fast)) {
+    return fast;
+  }
+
   try {
     size_t pos;
-    long long val = std::stoll(line, &pos);
+    long long val = std::stoll(std::string(line), &pos);
 
     if (pos != line.length()) {
       throw std::runtime_error("Invalid characters in number string");
@@ -105,7 +113,7 @@ static RESP parse_RESP_internal(const std::string &data, size_t &pos,
   }
 
   char prefix = data[pos++];
-  std::string line;
+  std::string_view line;
 
   switch (prefix) {
   case '+':
@@ -113,7 +121,7 @@ static RESP parse_RESP_internal(const std::string &data, size_t &pos,
     RESP resp{};
     resp.resp_type =
         (prefix == '+') ? RESP::type::SIMPLE_STRING : RESP::type::ERROR;
-    resp.str = read_line_CRLF(data, pos);
+    resp.str = std::string(read_line_CRLF(data, pos));
     return resp;
   }
   case ':': {
@@ -156,11 +164,12 @@ static RESP parse_RESP_internal(const std::string &data, size_t &pos,
     pos += safe_len + 2;
     return resp;
   }
-  case '*': {
+  case '*':
+  case '>': {
     line = read_line_CRLF(data, pos);
     long long count = stoll_safe(line);
 
-    if (count == -1) {
+    if (count == -1 && prefix == '*') {
       RESP resp{};
       resp.resp_type = RESP::type::ARRAY;
       resp.is_null = true;
@@ -172,7 +181,7 @@ static RESP parse_RESP_internal(const std::string &data, size_t &pos,
     }
 
     RESP resp{};
-    resp.resp_type = RESP::type::ARRAY;
+    resp.resp_type = prefix == '*' ? RESP::type::ARRAY : RESP::type::PUSH;
     resp.elements.reserve(static_cast<size_t>(count));
     for (long long i = 0; i < count; ++i) {
       resp.elements.emplace_back(parse_RESP_internal(data, pos, depth + 1));
@@ -210,6 +219,13 @@ std::string serialize_RESP(const RESP &resp) {
       return ss.str();
     }
     break;
+  case RESP::type::PUSH: {
+    std::string out = ">" + std::to_string(resp.elements.size()) + "\r\n";
+    for (const auto &element : resp.elements) {
+      out += serialize_RESP(element);
+    }
+    return out;
+  }
   default:
     throw std::runtime_error("Unsupported RESP type for serialization");
   }
@@ -251,6 +267,39 @@ bool robust_send(int sock_fd, const char *data, size_t len) {
   return true;
 }
 
+bool robust_sendv(int sock_fd, struct iovec *iov, int iovcnt) {
+  if (sock_fd < 0) {
+    return false;
+  }
+
+  while (iovcnt > 0) {
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = static_cast<size_t>(iovcnt);
+    ssize_t n = sendmsg(sock_fd, &msg, MSG_NOSIGNAL);
+
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+
+    size_t sent = static_cast<size_t>(n);
+    while (iovcnt > 0 && sent >= iov->iov_len) {
+      sent -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = static_cast<char *>(iov->iov_base) + sent;
+      iov->iov_len -= sent;
+    }
+  }
+
+  return true;
+}
+
 // tokenize a RESP struct into a vector
 std::vector<std::string> RESP_to_tokens(const RESP &resp) {
   std::vector<std::string> tokens;
@@ -280,6 +329,7 @@ void print_RESP(const RESP &resp) {
     std::cout << resp.integer << '\n';
     break;
   case RESP::type::ARRAY:
+  case RESP::type::PUSH:
     for (auto ele : resp.elements) {
       print_RESP(ele);
     }
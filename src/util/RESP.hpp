@@ -4,11 +4,15 @@
 #include <netinet/tcp.h>
 // #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <vector>
 
 struct RESP {
-  enum class type { SIMPLE_STRING, ERROR, INTEGER, BULK_STRING, ARRAY };
+  // PUSH ('>') is the RESP3 out-of-band frame used for tracking
+  // invalidations; everything else is RESP2.
+  enum class type { SIMPLE_STRING, ERROR, INTEGER, BULK_STRING, ARRAY, PUSH };
   type resp_type;
   std::string str;
   long long integer = 0;
@@ -20,8 +24,8 @@ constexpr int MAX_RESP_DEPTH = 128;
 constexpr long long MAX_BULK_LEN = 512 * 1024 * 1024;
 constexpr long long MAX_ARRAY_COUNT = 1024 * 1024;
 
-static std::string read_line_CRLF(const std::string &data, size_t &pos);
-static long long stoll_safe(const std::string &line);
+static std::string_view read_line_CRLF(const std::string &data, size_t &pos);
+static long long stoll_safe(std::string_view line);
 static RESP parse_RESP_internal(const std::string &data, size_t &pos,
                                 int depth);
 static std::vector<std::string> split_lines(const std::string &data);
@@ -30,6 +34,8 @@ RESP parse_RESP(const std::string &data, size_t &pos);
 std::string serialize_RESP(const RESP &resp);
 void send_RESP(int sock_fd, const RESP &resp);
 bool robust_send(int sock_fd, const char *data, size_t len);
+// Gathered send; iov is advanced in place on partial writes.
+bool robust_sendv(int sock_fd, struct iovec *iov, int iovcnt);
 std::vector<std::string> RESP_to_tokens(const RESP &resp);
 void print_RESP(const RESP &resp);
 void read();
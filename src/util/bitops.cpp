@@ -0,0 +1,248 @@
+#include "bitops.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITOPS_X86 1
+#endif
+
+static uint64_t load64(const uint8_t *p) {
+  uint64_t w;
+  std::memcpy(&w, p, sizeof(w));
+  return w;
+}
+
+static void store64(uint8_t *p, uint64_t w) { std::memcpy(p, &w, sizeof(w)); }
+
+static size_t popcount_scalar(const uint8_t *data, size_t len) {
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    count += __builtin_popcountll(load64(data + i));
+  }
+  for (; i < len; i++) {
+    count += __builtin_popcount(data[i]);
+  }
+  return count;
+}
+
+static uint64_t combine(BitOp op, uint64_t a, uint64_t b) {
+  switch (op) {
+  case BitOp::AND:
+    return a & b;
+  case BitOp::OR:
+    return a | b;
+  case BitOp::XOR:
+    return a ^ b;
+  case BitOp::NOT:
+    return ~b;
+  }
+  return a;
+}
+
+static void bitop_scalar(BitOp op, uint8_t *dst, const uint8_t *src,
+                         size_t len) {
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    store64(dst + i, combine(op, load64(dst + i), load64(src + i)));
+  }
+  for (; i < len; i++) {
+    dst[i] = static_cast<uint8_t>(combine(op, dst[i], src[i]));
+  }
+}
+
+static void max_packed6_scalar(uint8_t *dst, const uint8_t *packed,
+                               size_t count) {
+  for (size_t i = 0; i < count; i += 4, packed += 3) {
+    uint32_t bits = packed[0] | (packed[1] << 8) | (packed[2] << 16);
+    for (size_t k = 0; k < 4; k++) {
+      dst[i + k] = std::max(dst[i + k], static_cast<uint8_t>(bits & 63));
+      bits >>= 6;
+    }
+  }
+}
+
+static size_t find_byte_not_scalar(const uint8_t *data, size_t len,
+                                   uint8_t skip) {
+  const uint64_t pattern = 0x0101010101010101ULL * skip;
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    if (load64(data + i) != pattern) {
+      break;
+    }
+  }
+  while (i < len && data[i] == skip) {
+    i++;
+  }
+  return i;
+}
+
+#ifdef BITOPS_X86
+// Per-byte bit counts of v via a nibble lookup table.
+__attribute__((target("avx2"))) static inline __m256i
+count_bytes_avx2(__m256i v) {
+  const __m256i lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1,
+                       1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  __m256i lo = _mm256_and_si256(v, low_mask);
+  __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+  return _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                         _mm256_shuffle_epi8(lookup, hi));
+}
+
+// Mula's algorithm: vpshufb counts each nibble, vpsadbw folds the byte
+// counts into four 64-bit lanes. Two vectors per iteration keep both ports
+// busy; per-byte counts stay below 256 because each step is folded at once.
+__attribute__((target("avx2"))) static size_t
+popcount_avx2(const uint8_t *data, size_t len) {
+  __m256i acc = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 32));
+    __m256i bytes = _mm256_add_epi8(count_bytes_avx2(a), count_bytes_avx2(b));
+    acc = _mm256_add_epi64(acc,
+                           _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+  }
+  size_t count = static_cast<size_t>(_mm256_extract_epi64(acc, 0)) +
+                 static_cast<size_t>(_mm256_extract_epi64(acc, 1)) +
+                 static_cast<size_t>(_mm256_extract_epi64(acc, 2)) +
+                 static_cast<size_t>(_mm256_extract_epi64(acc, 3));
+  return count + popcount_scalar(data + i, len - i);
+}
+
+__attribute__((target("avx2"))) static void
+bitop_avx2(BitOp op, uint8_t *dst, const uint8_t *src, size_t len) {
+  size_t i = 0;
+  const __m256i ones = _mm256_set1_epi8(-1);
+  for (; i + 32 <= len; i += 32) {
+    __m256i *d = reinterpret_cast<__m256i *>(dst + i);
+    __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    __m256i r;
+    switch (op) {
+    case BitOp::AND:
+      r = _mm256_and_si256(_mm256_loadu_si256(d), s);
+      break;
+    case BitOp::OR:
+      r = _mm256_or_si256(_mm256_loadu_si256(d), s);
+      break;
+    case BitOp::XOR:
+      r = _mm256_xor_si256(_mm256_loadu_si256(d), s);
+      break;
+    default:
+      r = _mm256_xor_si256(s, ones);
+      break;
+    }
+    _mm256_storeu_si256(d, r);
+  }
+  bitop_scalar(op, dst + i, src + i, len - i);
+}
+
+// 24 packed bytes become 32 fields per step: each 128-bit lane takes 12
+// bytes, vpshufb spreads every 3-byte group into its own dword, and shifts
+// move fields 1-3 up to the byte they belong in. The two 16-byte loads read
+// 4 bytes past the group, so the last step is left to the scalar loop.
+__attribute__((target("avx2"))) static void
+max_packed6_avx2(uint8_t *dst, const uint8_t *packed, size_t count) {
+  const __m256i spread = _mm256_setr_epi8(
+      0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, 0, 1, 2, -1, 3, 4,
+      5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m256i field0 = _mm256_set1_epi32(0x0000003f);
+  const __m256i field1 = _mm256_set1_epi32(0x00003f00);
+  const __m256i field2 = _mm256_set1_epi32(0x003f0000);
+  const __m256i field3 = _mm256_set1_epi32(0x3f000000);
+  size_t bytes = count / 4 * 3;
+  size_t i = 0;
+  size_t in = 0;
+  for (; in + 28 <= bytes; i += 32, in += 24) {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + in));
+    __m128i hi =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + in + 12));
+    __m256i x = _mm256_shuffle_epi8(
+        _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), spread);
+    __m256i fields = _mm256_or_si256(
+        _mm256_or_si256(_mm256_and_si256(x, field0),
+                        _mm256_and_si256(_mm256_slli_epi32(x, 2), field1)),
+        _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi32(x, 4), field2),
+                        _mm256_and_si256(_mm256_slli_epi32(x, 6), field3)));
+    __m256i *d = reinterpret_cast<__m256i *>(dst + i);
+    _mm256_storeu_si256(d, _mm256_max_epu8(_mm256_loadu_si256(d), fields));
+  }
+  max_packed6_scalar(dst + i, packed + in, count - i);
+}
+
+__attribute__((target("avx2"))) static size_t
+find_byte_not_avx2(const uint8_t *data, size_t len, uint8_t skip) {
+  const __m256i pattern = _mm256_set1_epi8(static_cast<char>(skip));
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    uint32_t same = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, pattern)));
+    if (same != 0xffffffffu) {
+      return i + __builtin_ctz(~same);
+    }
+  }
+  return i + find_byte_not_scalar(data + i, len - i, skip);
+}
+#endif
+
+size_t popcount_with(ScanImpl impl, const uint8_t *data, size_t len) {
+#ifdef BITOPS_X86
+  if (impl == ScanImpl::AVX2) {
+    return popcount_avx2(data, len);
+  }
+#endif
+  return popcount_scalar(data, len);
+}
+
+void bitop_apply_with(ScanImpl impl, BitOp op, uint8_t *dst,
+                      const uint8_t *src, size_t len) {
+#ifdef BITOPS_X86
+  if (impl == ScanImpl::AVX2) {
+    bitop_avx2(op, dst, src, len);
+    return;
+  }
+#endif
+  bitop_scalar(op, dst, src, len);
+}
+
+void max_packed6_with(ScanImpl impl, uint8_t *dst, const uint8_t *packed,
+                      size_t count) {
+#ifdef BITOPS_X86
+  if (impl == ScanImpl::AVX2) {
+    max_packed6_avx2(dst, packed, count);
+    return;
+  }
+#endif
+  max_packed6_scalar(dst, packed, count);
+}
+
+size_t find_byte_not_with(ScanImpl impl, const uint8_t *data, size_t len,
+                          uint8_t skip) {
+#ifdef BITOPS_X86
+  if (impl == ScanImpl::AVX2) {
+    return find_byte_not_avx2(data, len, skip);
+  }
+#endif
+  return find_byte_not_scalar(data, len, skip);
+}
+
+size_t popcount(const uint8_t *data, size_t len) {
+  return popcount_with(active_scan_impl(), data, len);
+}
+
+void bitop_apply(BitOp op, uint8_t *dst, const uint8_t *src, size_t len) {
+  bitop_apply_with(active_scan_impl(), op, dst, src, len);
+}
+
+void max_packed6(uint8_t *dst, const uint8_t *packed, size_t count) {
+  max_packed6_with(active_scan_impl(), dst, packed, count);
+}
+
+size_t find_byte_not(const uint8_t *data, size_t len, uint8_t skip) {
+  return find_byte_not_with(active_scan_impl(), data, len, skip);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "util/simd_scan.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Bulk kernels for bitmaps (BITCOUNT, BITPOS, BITOP) and HyperLogLog register
+// merges. Dispatch follows find_crlf: AVX2 when the CPU has it, otherwise
+// 64-bit scalar loops; SSE2 has no byte shuffle for the popcount lookup, so
+// it takes the scalar path too. The _with variants exist for tests and
+// benchmarks.
+
+enum class BitOp { AND, OR, XOR, NOT };
+
+// Number of set bits in [data, data + len).
+size_t popcount(const uint8_t *data, size_t len);
+size_t popcount_with(ScanImpl impl, const uint8_t *data, size_t len);
+
+// dst[i] = dst[i] op src[i]; NOT ignores dst and stores ~src[i].
+void bitop_apply(BitOp op, uint8_t *dst, const uint8_t *src, size_t len);
+void bitop_apply_with(ScanImpl impl, BitOp op, uint8_t *dst,
+                      const uint8_t *src, size_t len);
+
+// dst[i] = max(dst[i], field i of packed) for count 6-bit fields packed
+// least significant bit first, four to every three bytes (HyperLogLog dense
+// registers). count must be a multiple of 4.
+void max_packed6(uint8_t *dst, const uint8_t *packed, size_t count);
+void max_packed6_with(ScanImpl impl, uint8_t *dst, const uint8_t *packed,
+                      size_t count);
+
+// Offset of the first byte that is not skip, or len. BITPOS uses it to jump
+// over runs of 0x00 (looking for a 1) or 0xff (looking for a 0).
+size_t find_byte_not(const uint8_t *data, size_t len, uint8_t skip);
+size_t find_byte_not_with(ScanImpl impl, const uint8_t *data, size_t len,
+                          uint8_t skip);
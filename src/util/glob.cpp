@@ -0,0 +1,81 @@
+#include "util/glob.hpp"
+#include <utility>
+
+// Matches one pattern element starting at p[pi] against c. On success pi is
+// advanced past the element.
+static bool match_one(std::string_view p, size_t &pi, char c) {
+  switch (p[pi]) {
+  case '?':
+    pi++;
+    return true;
+  case '\\':
+    if (pi + 1 < p.size()) {
+      pi += 2;
+      return p[pi - 1] == c;
+    }
+    pi++;
+    return c == '\\';
+  case '[': {
+    size_t i = pi + 1;
+    bool negate = i < p.size() && p[i] == '^';
+    if (negate) {
+      i++;
+    }
+    bool matched = false;
+    // An unterminated class runs to the end of the pattern, as in Redis.
+    while (i < p.size() && p[i] != ']') {
+      if (p[i] == '\\' && i + 1 < p.size()) {
+        matched |= p[i + 1] == c;
+        i += 2;
+      } else if (i + 2 < p.size() && p[i + 1] == '-' && p[i + 2] != ']') {
+        char lo = p[i], hi = p[i + 2];
+        if (lo > hi) {
+          std::swap(lo, hi);
+        }
+        matched |= c >= lo && c <= hi;
+        i += 3;
+      } else {
+        matched |= p[i] == c;
+        i++;
+      }
+    }
+    pi = i < p.size() ? i + 1 : i;
+    return matched != negate;
+  }
+  default:
+    return p[pi++] == c;
+  }
+}
+
+bool glob_match(std::string_view pattern, std::string_view subject) {
+  size_t pi = 0, si = 0;
+  size_t star = std::string_view::npos, mark = 0;
+
+  while (si < subject.size()) {
+    if (pi < pattern.size() && pattern[pi] == '*') {
+      star = ++pi;
+      mark = si;
+      continue;
+    }
+    size_t next = pi;
+    if (pi < pattern.size() && match_one(pattern, next, subject[si])) {
+      pi = next;
+      si++;
+      continue;
+    }
+    if (star == std::string_view::npos) {
+      return false;
+    }
+    pi = star;
+    si = ++mark;
+  }
+
+  while (pi < pattern.size() && pattern[pi] == '*') {
+    pi++;
+  }
+  return pi == pattern.size();
+}
+
+bool glob_is_literal(std::string_view pattern) {
+  return pattern.find_first_of("*?[\\") == std::string_view::npos;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <string_view>
+
+// Redis glob patterns: '*', '?', '[abc]', '[^a-z]' and '\' escapes.
+// Backtracks only to the last '*', so matching is O(pattern * subject).
+bool glob_match(std::string_view pattern, std::string_view subject);
+
+// True if pattern has no special characters and matches only itself.
+bool glob_is_literal(std::string_view pattern);
@@ -0,0 +1,202 @@
+#include "simd_scan.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RESP_SCAN_X86 1
+#endif
+
+static size_t find_crlf_scalar(const char *data, size_t len) {
+  const char *p = data;
+  const char *end = data + len;
+  while (p < end) {
+    p = static_cast<const char *>(std::memchr(p, '\r', end - p));
+    if (!p || p + 1 >= end) {
+      return std::string::npos;
+    }
+    if (p[1] == '\n') {
+      return p - data;
+    }
+    p++;
+  }
+  return std::string::npos;
+}
+
+#ifdef RESP_SCAN_X86
+// Returns the first '\r' in mask (bit i = data[base + i]) that is followed by
+// '\n', or npos. Lone carriage returns are rare, so this is normally one step.
+static size_t first_crlf_in_mask(const char *data, size_t len, size_t base,
+                                 uint64_t mask) {
+  while (mask) {
+    size_t at = base + __builtin_ctzll(mask);
+    if (at + 1 < len && data[at + 1] == '\n') {
+      return at;
+    }
+    mask &= mask - 1;
+  }
+  return std::string::npos;
+}
+
+// Both vector scans look for '\r' only and confirm the '\n' in scalar code,
+// which keeps the hot loop to one compare per vector. The tail is scalar.
+static size_t find_crlf_sse2(const char *data, size_t len) {
+  const __m128i cr = _mm_set1_epi8('\r');
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 16));
+    uint64_t mask =
+        static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, cr))) |
+        (static_cast<uint64_t>(static_cast<uint32_t>(
+             _mm_movemask_epi8(_mm_cmpeq_epi8(b, cr))))
+         << 16);
+    if (mask) {
+      size_t at = first_crlf_in_mask(data, len, i, mask);
+      if (at != std::string::npos) {
+        return at;
+      }
+    }
+  }
+  size_t rest = find_crlf_scalar(data + i, len - i);
+  return rest == std::string::npos ? rest : i + rest;
+}
+
+__attribute__((target("avx2"))) static size_t
+find_crlf_avx2(const char *data, size_t len) {
+  const __m256i cr = _mm256_set1_epi8('\r');
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 32));
+    __m256i ea = _mm256_cmpeq_epi8(a, cr);
+    __m256i eb = _mm256_cmpeq_epi8(b, cr);
+    if (_mm256_testz_si256(_mm256_or_si256(ea, eb), _mm256_or_si256(ea, eb))) {
+      continue;
+    }
+    uint64_t mask =
+        static_cast<uint32_t>(_mm256_movemask_epi8(ea)) |
+        (static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(eb)))
+         << 32);
+    size_t at = first_crlf_in_mask(data, len, i, mask);
+    if (at != std::string::npos) {
+      return at;
+    }
+  }
+  size_t rest = find_crlf_scalar(data + i, len - i);
+  return rest == std::string::npos ? rest : i + rest;
+}
+#endif
+
+bool scan_impl_supported(ScanImpl impl) {
+  switch (impl) {
+  case ScanImpl::SCALAR:
+    return true;
+#ifdef RESP_SCAN_X86
+  case ScanImpl::SSE2:
+    return true;
+  case ScanImpl::AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+const char *scan_impl_name(ScanImpl impl) {
+  switch (impl) {
+  case ScanImpl::SCALAR:
+    return "scalar";
+  case ScanImpl::SSE2:
+    return "sse2";
+  case ScanImpl::AVX2:
+    return "avx2";
+  }
+  return "unknown";
+}
+
+static ScanImpl detect_scan_impl() {
+#ifdef RESP_SCAN_X86
+  // Runs from a static initializer, possibly before libgcc's own CPU probe.
+  __builtin_cpu_init();
+#endif
+  if (scan_impl_supported(ScanImpl::AVX2))
+    return ScanImpl::AVX2;
+  if (scan_impl_supported(ScanImpl::SSE2))
+    return ScanImpl::SSE2;
+  return ScanImpl::SCALAR;
+}
+
+static const ScanImpl g_scan_impl = detect_scan_impl();
+
+ScanImpl active_scan_impl() { return g_scan_impl; }
+
+size_t find_crlf_with(ScanImpl impl, const char *data, size_t len) {
+  switch (impl) {
+#ifdef RESP_SCAN_X86
+  case ScanImpl::AVX2:
+    return find_crlf_avx2(data, len);
+  case ScanImpl::SSE2:
+    return find_crlf_sse2(data, len);
+#endif
+  default:
+    return find_crlf_scalar(data, len);
+  }
+}
+
+// Header lines are short, so only the first window goes through the vector
+// scanner, where it resolves the common early hit in one step. Past that,
+// glibc's memchr is already vectorized and unrolled further than we are.
+size_t find_crlf(const char *data, size_t len) {
+  constexpr size_t VECTOR_WINDOW = 64;
+  if (len < 16 || g_scan_impl == ScanImpl::SCALAR) {
+    return find_crlf_scalar(data, len);
+  }
+
+  size_t head = std::min(len, VECTOR_WINDOW + 1);
+  size_t at = find_crlf_with(g_scan_impl, data, head);
+  if (at != std::string::npos || head == len) {
+    return at;
+  }
+  size_t rest = find_crlf_scalar(data + VECTOR_WINDOW, len - VECTOR_WINDOW);
+  return rest == std::string::npos ? rest : VECTOR_WINDOW + rest;
+}
+
+bool parse_int_fast(const char *data, size_t len, long long &out) {
+  if (len == 0 || len > 20) {
+    return false;
+  }
+
+  bool negative = data[0] == '-';
+  size_t i = negative ? 1 : 0;
+  if (i == len) {
+    return false;
+  }
+
+  uint64_t v = 0;
+  for (; i < len; i++) {
+    unsigned digit = static_cast<unsigned char>(data[i]) - '0';
+    if (digit > 9 || __builtin_mul_overflow(v, 10u, &v) ||
+        __builtin_add_overflow(v, digit, &v)) {
+      return false;
+    }
+  }
+
+  constexpr uint64_t max_positive = std::numeric_limits<long long>::max();
+  if (negative) {
+    if (v > max_positive + 1) {
+      return false;
+    }
+    out = static_cast<long long>(0 - v);
+  } else {
+    if (v > max_positive) {
+      return false;
+    }
+    out = static_cast<long long>(v);
+  }
+  return true;
+}
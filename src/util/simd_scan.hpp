@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Delimiter scanning for the RESP parser. The widest implementation the CPU
+// supports is picked once at startup; the others stay callable so tests and
+// benchmarks can compare them.
+
+enum class ScanImpl { SCALAR, SSE2, AVX2 };
+
+bool scan_impl_supported(ScanImpl impl);
+const char *scan_impl_name(ScanImpl impl);
+ScanImpl active_scan_impl();
+
+// Offset of the first "\r\n" in [data, data + len), or std::string::npos.
+size_t find_crlf(const char *data, size_t len);
+size_t find_crlf_with(ScanImpl impl, const char *data, size_t len);
+
+// Parses a canonical decimal ("-?[0-9]+") without exceptions. Returns false on
+// anything else, including overflow.
+bool parse_int_fast(const char *data, size_t len, long long &out);
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "common/concurrent_store.hpp"
+#include "util/bitops.hpp"
+
+using Redis::ConcurrentStore;
+using Redis::StoreStatus;
+
+static std::vector<uint8_t> random_bytes(size_t n, u64 seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<uint8_t> out(n);
+    for (auto& b : out) b = static_cast<uint8_t>(rng());
+    return out;
+}
+
+static std::vector<ScanImpl> supported_impls() {
+    std::vector<ScanImpl> impls;
+    for (ScanImpl impl : {ScanImpl::SCALAR, ScanImpl::SSE2, ScanImpl::AVX2}) {
+        if (scan_impl_supported(impl)) impls.push_back(impl);
+    }
+    return impls;
+}
+
+// Lengths around the vector widths catch tail handling bugs.
+TEST(BitKernels, ImplementationsAgree) {
+    for (size_t len : {0, 1, 7, 31, 32, 33, 63, 64, 65, 1000, 4099}) {
+        auto a = random_bytes(len, len);
+        auto b = random_bytes(len, len + 1);
+        size_t expected_bits = 0;
+        for (uint8_t byte : a) expected_bits += __builtin_popcount(byte);
+
+        for (ScanImpl impl : supported_impls()) {
+            EXPECT_EQ(popcount_with(impl, a.data(), len), expected_bits)
+                << scan_impl_name(impl) << " len " << len;
+            for (BitOp op : {BitOp::AND, BitOp::OR, BitOp::XOR, BitOp::NOT}) {
+                auto dst = a;
+                bitop_apply_with(impl, op, dst.data(), b.data(), len);
+                for (size_t i = 0; i < len; i++) {
+                    uint8_t want = op == BitOp::AND   ? a[i] & b[i]
+                                   : op == BitOp::OR  ? a[i] | b[i]
+                                   : op == BitOp::XOR ? a[i] ^ b[i]
+                                                      : ~b[i];
+                    ASSERT_EQ(dst[i], want) << scan_impl_name(impl);
+                }
+            }
+        }
+    }
+}
+
+TEST(BitKernels, FindByteNotStopsAtFirstDifference) {
+    std::vector<uint8_t> data(1000, 0xff);
+    for (ScanImpl impl : supported_impls()) {
+        EXPECT_EQ(find_byte_not_with(impl, data.data(), data.size(), 0xff),
+                  data.size());
+        for (size_t at : {0, 5, 31, 32, 500, 999}) {
+            data[at] = 0xfe;
+            EXPECT_EQ(find_byte_not_with(impl, data.data(), data.size(), 0xff),
+                      at);
+            data[at] = 0xff;
+        }
+    }
+}
+
+TEST(BitKernels, MaxPacked6MatchesFieldByField) {
+    const size_t count = 16384;
+    auto packed = random_bytes(count * 3 / 4, 7);
+    auto start = random_bytes(count, 8);
+    for (auto& b : start) b &= 63;
+
+    for (ScanImpl impl : supported_impls()) {
+        auto dst = start;
+        max_packed6_with(impl, dst.data(), packed.data(), count);
+        for (size_t i = 0; i < count; i++) {
+            size_t bit = i * 6;
+            unsigned word = packed[bit / 8] |
+                            (bit / 8 + 1 < packed.size()
+                                 ? packed[bit / 8 + 1] << 8
+                                 : 0);
+            uint8_t field = (word >> (bit % 8)) & 63;
+            ASSERT_EQ(dst[i], std::max(start[i], field))
+                << scan_impl_name(impl) << " field " << i;
+        }
+    }
+}
+
+TEST(StoreStrings, UpdateCreatesOnlyOnChangeAndExpandsIntegers) {
+    ConcurrentStore store;
+    EXPECT_EQ(store.update_string("k", [](std::string&) { return false; }),
+              StoreStatus::OK);
+    EXPECT_FALSE(store.contains("k"));
+
+    store.update_string("k", [](std::string& s) {
+        s.resize(2, '\0');
+        s[1] = '\x80';
+        return true;
+    });
+    std::string seen;
+    store.read_string("k", [&](std::string_view s) { seen = s; });
+    EXPECT_EQ(seen, std::string("\0\x80", 2));
+
+    store.set("n", Redis::encode_string("12"), Redis::SetOptions{});
+    store.read_string("n", [&](std::string_view s) { seen = s; });
+    EXPECT_EQ(seen, "12");
+    // A no-op edit leaves the integer and its version alone.
+    u64 version = store.version("n");
+    store.update_string("n", [](std::string&) { return false; });
+    EXPECT_EQ(std::get<i64>(*store.get("n")), 12);
+    EXPECT_EQ(store.version("n"), version);
+    store.update_string("n", [](std::string& s) {
+        s[1] = '3';
+        return true;
+    });
+    EXPECT_EQ(std::get<std::string>(*store.get("n")), "13");
+
+    std::string items[] = {"a"};
+    store.rpush("l", items);
+    bool called = false;
+    EXPECT_EQ(store.read_string("l", [&](std::string_view) { called = true; }),
+              StoreStatus::WRONG_TYPE);
+    EXPECT_EQ(store.update_string("l",
+                                  [&](std::string&) { return called = true; }),
+              StoreStatus::WRONG_TYPE);
+    EXPECT_FALSE(called);
+}
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/concurrent_store.hpp"
+#include "common/keyslot.hpp"
+#include "server/cluster.hpp"
+
+using Redis::ClusterNode;
+using Redis::ClusterState;
+using Redis::ConcurrentStore;
+using Redis::RedisData;
+using Redis::RedisList;
+using Redis::SetOptions;
+using Redis::key_hash_slot;
+
+TEST(KeySlot, Crc16MatchesReferenceVectors) {
+    // The check value from the Redis Cluster spec.
+    const char *check = "123456789";
+    EXPECT_EQ(Redis::crc16(check, std::strlen(check)), 0x31C3);
+    EXPECT_EQ(Redis::crc16("", 0), 0);
+}
+
+TEST(KeySlot, SlotsMatchRedis) {
+    EXPECT_EQ(key_hash_slot("foo"), 12182);
+    EXPECT_EQ(key_hash_slot("bar"), 5061);
+    EXPECT_EQ(key_hash_slot("hello"), 866);
+    EXPECT_EQ(key_hash_slot("somekey"), 11058);
+    EXPECT_EQ(key_hash_slot("foo{hash_tag}"), 2515);
+}
+
+TEST(KeySlot, HashTags) {
+    EXPECT_EQ(key_hash_slot("{user1000}.following"), key_hash_slot("user1000"));
+    EXPECT_EQ(key_hash_slot("{user1000}.followers"), key_hash_slot("user1000"));
+    // Only the first tag counts.
+    EXPECT_EQ(key_hash_slot("foo{bar}{zap}"), key_hash_slot("bar"));
+    // The tag ends at the first '}', so it is "{bar".
+    EXPECT_EQ(key_hash_slot("foo{{bar}}zap"), key_hash_slot("{bar"));
+    // An empty or unterminated tag hashes the whole key.
+    EXPECT_EQ(key_hash_slot("foo{}{bar}"),
+              Redis::crc16("foo{}{bar}", 10) & 16383);
+    EXPECT_EQ(key_hash_slot("foo{bar"), Redis::crc16("foo{bar", 7) & 16383);
+}
+
+TEST(SlotIndex, TracksSetEraseAndExpiry) {
+    ConcurrentStore store;
+    store.enable_slot_index();
+    u16 slot = key_hash_slot("{t}a");
+
+    store.set("{t}a", std::string("1"), SetOptions{});
+    store.set("{t}b", std::string("2"), SetOptions{});
+    store.set("{t}a", std::string("3"), SetOptions{});
+    RedisList list;
+    list.push_back("x");
+    store.set("{t}c", Redis::Value(RedisData{list}));
+    EXPECT_EQ(store.count_keys_in_slot(slot), 3u);
+    EXPECT_EQ(store.count_keys_in_slot(key_hash_slot("other")), 0u);
+
+    auto keys = store.keys_in_slot(slot, 10);
+    std::sort(keys.begin(), keys.end());
+    EXPECT_EQ(keys, (std::vector<std::string>{"{t}a", "{t}b", "{t}c"}));
+    EXPECT_EQ(store.keys_in_slot(slot, 2).size(), 2u);
+
+    store.erase("{t}b");
+    EXPECT_EQ(store.count_keys_in_slot(slot), 2u);
+
+    SetOptions ttl;
+    ttl.ttl_ms = 1;
+    store.set("{t}d", std::string("4"), ttl);
+    store.set("{t}e", std::string("5"), ttl);
+    EXPECT_EQ(store.count_keys_in_slot(slot), 4u);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_FALSE(store.get("{t}d"));
+    EXPECT_EQ(store.count_keys_in_slot(slot), 3u);
+    for (int i = 0; i < 100 && store.count_keys_in_slot(slot) > 2; i++) {
+        store.active_expiry_cycle();
+    }
+    EXPECT_EQ(store.count_keys_in_slot(slot), 2u);
+}
+
+TEST(ClusterRoute, MigratingAndImporting) {
+    ClusterState cluster("127.0.0.1", 7000);
+    std::string me = cluster.myself().id;
+    ClusterNode other{.id = std::string(40, 'b'), .host = "127.0.0.1",
+                      .port = 7001};
+    cluster.add_node(other);
+
+    EXPECT_EQ(cluster.route(10).kind, ClusterState::RouteKind::UNASSIGNED);
+
+    ASSERT_TRUE(cluster.assign_slot(10, me));
+    ASSERT_TRUE(cluster.assign_slot(20, other.id));
+    EXPECT_EQ(cluster.route(10).kind, ClusterState::RouteKind::LOCAL);
+    auto moved = cluster.route(20);
+    EXPECT_EQ(moved.kind, ClusterState::RouteKind::MOVED);
+    EXPECT_EQ(moved.target.port, 7001);
+
+    // Only the owner can migrate a slot, and only a non-owner import it.
+    EXPECT_FALSE(cluster.set_migrating(20, other.id));
+    EXPECT_FALSE(cluster.set_importing(10, other.id));
+
+    ASSERT_TRUE(cluster.set_migrating(10, other.id));
+    auto migrating = cluster.route(10);
+    EXPECT_EQ(migrating.kind, ClusterState::RouteKind::MIGRATING);
+    EXPECT_EQ(migrating.target.id, other.id);
+
+    ASSERT_TRUE(cluster.set_importing(20, other.id));
+    auto importing = cluster.route(20);
+    EXPECT_EQ(importing.kind, ClusterState::RouteKind::IMPORTING);
+    EXPECT_EQ(importing.target.id, other.id);
+
+    cluster.set_stable(20);
+    EXPECT_EQ(cluster.route(20).kind, ClusterState::RouteKind::MOVED);
+
+    // Handing the slot over ends the migration.
+    ASSERT_TRUE(cluster.assign_slot(10, other.id));
+    EXPECT_EQ(cluster.route(10).kind, ClusterState::RouteKind::MOVED);
+}
+
+TEST(MigratePayload, RoundTrips) {
+    auto string =
+        Redis::restore_payload(Redis::dump_payload(std::string("a\r\nb")));
+    ASSERT_TRUE(string);
+    EXPECT_EQ(std::get<std::string>(*string), "a\r\nb");
+
+    auto number = Redis::restore_payload(Redis::dump_payload(i64{-42}));
+    ASSERT_TRUE(number);
+    EXPECT_EQ(std::get<i64>(*number), -42);
+
+    RedisList list;
+    list.push_back("x");
+    list.push_back("");
+    list.push_back("z");
+    auto restored = Redis::restore_payload(Redis::dump_payload(list));
+    ASSERT_TRUE(restored);
+    const auto &items = std::get<RedisList>(*restored);
+    EXPECT_EQ(std::vector<std::string>(items.begin(), items.end()),
+              (std::vector<std::string>{"x", "", "z"}));
+
+    EXPECT_FALSE(Redis::restore_payload("garbage"));
+    EXPECT_FALSE(Redis::restore_payload("$-1\r\n"));
+}
+
+TEST(MigrateErase, OnlyErasesTheDumpedVersion) {
+    ConcurrentStore store;
+    store.set("k", std::string("a"), SetOptions{});
+    u64 version = 0;
+    ASSERT_TRUE(store.dump("k", &version));
+    EXPECT_EQ(version, store.version("k"));
+
+    store.set("k", std::string("b"), SetOptions{});
+    EXPECT_FALSE(store.erase_if_version("k", version));
+    EXPECT_TRUE(store.contains("k"));
+
+    ASSERT_TRUE(store.dump("k", &version));
+    EXPECT_TRUE(store.erase_if_version("k", version));
+    EXPECT_FALSE(store.contains("k"));
+}
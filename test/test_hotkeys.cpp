@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "common/concurrent_store.hpp"
+#include "server/key_sampler.hpp"
+
+using Redis::ConcurrentStore;
+using Redis::KeySample;
+using Redis::KeySampler;
+using Redis::SetOptions;
+
+static std::vector<KeySample> sample_all(const ConcurrentStore& store) {
+    std::vector<KeySample> out;
+    u64 cursor = 0;
+    do {
+        cursor = store.sample(cursor, 100, out);
+    } while (cursor != 0);
+    return out;
+}
+
+static const KeySample* find(const std::vector<KeySample>& samples,
+                             const std::string& key) {
+    for (const auto& s : samples) {
+        if (s.key == key) return &s;
+    }
+    return nullptr;
+}
+
+TEST(StoreLfu, ReadsRaiseTheCounterLogarithmically) {
+    ConcurrentStore store;
+    store.set("hot", std::string("a"), SetOptions{});
+    store.set("cold", std::string("b"), SetOptions{});
+    for (int i = 0; i < 5000; i++) store.get("hot");
+
+    auto samples = sample_all(store);
+    const KeySample* hot = find(samples, "hot");
+    const KeySample* cold = find(samples, "cold");
+    ASSERT_NE(hot, nullptr);
+    ASSERT_NE(cold, nullptr);
+    EXPECT_EQ(cold->frequency, 5);
+    // ~5000 hits with log factor 10 land in the low 20s, far from 255.
+    EXPECT_GT(hot->frequency, 12);
+    EXPECT_LT(hot->frequency, 40);
+}
+
+TEST(StoreLfu, WritesKeepVersionsWorking) {
+    ConcurrentStore store;
+    store.set("k", std::string("a"), SetOptions{});
+    u64 v1 = store.version("k");
+    for (int i = 0; i < 100; i++) store.get("k");
+    EXPECT_EQ(store.version("k"), v1);
+    store.set("k", std::string("b"), SetOptions{});
+    EXPECT_GT(store.version("k"), v1);
+}
+
+TEST(StoreSample, ReportsElementsAndMemory) {
+    ConcurrentStore store;
+    store.set("small", std::string("x"), SetOptions{});
+    store.set("big", std::string(10000, 'x'), SetOptions{});
+    store.set("n", Redis::encode_string("12345"), SetOptions{});
+    std::vector<std::string> items(300, std::string(100, 'y'));
+    store.rpush("list", items);
+
+    auto samples = sample_all(store);
+    ASSERT_EQ(samples.size(), 4u);
+    EXPECT_EQ(find(samples, "small")->elements, 1u);
+    EXPECT_EQ(find(samples, "big")->elements, 10000u);
+    EXPECT_EQ(find(samples, "n")->elements, 5u);
+    EXPECT_EQ(find(samples, "list")->elements, 300u);
+    EXPECT_GT(find(samples, "big")->memory, 10000u);
+    EXPECT_GT(find(samples, "list")->memory, 30000u);
+    EXPECT_LT(find(samples, "small")->memory, 256u);
+}
+
+TEST(KeySampler, RanksAcrossSlicesAndKeepsLastPass) {
+    ConcurrentStore store;
+    for (int i = 0; i < 500; i++) {
+        store.set("k" + std::to_string(i), std::string(i, 'v'), SetOptions{});
+    }
+    for (int i = 0; i < 2000; i++) store.get("k7");
+
+    KeySampler sampler(8);
+    // Small slices, so a pass takes many steps.
+    while (sampler.passes() == 0) sampler.step(store, 16);
+
+    auto hot = sampler.top(KeySampler::Metric::FREQ, 3);
+    ASSERT_EQ(hot.size(), 3u);
+    EXPECT_EQ(hot[0].key, "k7");
+
+    auto big = sampler.top(KeySampler::Metric::ELEMENTS, 20);
+    ASSERT_EQ(big.size(), 8u);
+    EXPECT_EQ(big[0].key, "k499");
+    EXPECT_EQ(big[7].key, "k492");
+
+    // Half-way through the next pass the previous board still answers.
+    sampler.step(store, 16);
+    EXPECT_EQ(sampler.top(KeySampler::Metric::ELEMENTS, 1)[0].key, "k499");
+}
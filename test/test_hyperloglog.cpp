@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "common/hyperloglog.hpp"
+
+namespace hll = Redis::hll;
+
+static std::vector<std::string> elements(size_t from, size_t to) {
+    std::vector<std::string> out;
+    for (size_t i = from; i < to; i++) out.push_back("e" + std::to_string(i));
+    return out;
+}
+
+static u64 count_of(std::string& h) {
+    u64 n = 0;
+    bool updated;
+    EXPECT_EQ(hll::count(h, n, updated), hll::Status::OK);
+    return n;
+}
+
+TEST(HyperLogLog, EmptyValueUsesRedisLayout) {
+    std::string h = hll::create();
+    // Header, then one XZERO opcode covering all 16384 registers.
+    EXPECT_EQ(h.size(), hll::HEADER_SIZE + 2);
+    EXPECT_EQ(h.substr(0, 5), std::string("HYLL\x01", 5));
+    EXPECT_EQ(h.substr(16), "\x7f\xff");
+    EXPECT_EQ(count_of(h), 0u);
+}
+
+TEST(HyperLogLog, SmallSetsStaySparseAndCountExactly) {
+    std::string h = hll::create();
+    bool changed;
+    ASSERT_EQ(hll::add(h, elements(0, 10), changed), hll::Status::OK);
+    EXPECT_TRUE(changed);
+    EXPECT_EQ(h[4], 1);
+    EXPECT_EQ(count_of(h), 10u);
+
+    hll::add(h, elements(0, 10), changed);
+    EXPECT_FALSE(changed);
+}
+
+TEST(HyperLogLog, PromotesToDenseAndStaysAccurate) {
+    std::string h = hll::create();
+    bool changed;
+    hll::add(h, elements(0, 100000), changed);
+    EXPECT_EQ(h[4], 0);
+    EXPECT_EQ(h.size(), hll::DENSE_SIZE);
+    double error = std::abs(static_cast<double>(count_of(h)) - 100000) / 1e5;
+    // Standard error is 0.81%; allow three of them.
+    EXPECT_LT(error, 0.025);
+}
+
+TEST(HyperLogLog, SparseAndDenseAgree) {
+    auto items = elements(0, 1500);
+    std::string sparse = hll::create();
+    std::string dense = hll::create();
+    bool changed;
+    hll::add(sparse, items, changed, 1 << 20);
+    hll::add(dense, items, changed, 0);
+    ASSERT_EQ(sparse[4], 1);
+    ASSERT_EQ(dense[4], 0);
+    EXPECT_EQ(count_of(sparse), count_of(dense));
+}
+
+TEST(HyperLogLog, CacheIsUsedUntilTheNextChange) {
+    std::string h = hll::create();
+    bool changed, updated;
+    u64 n;
+    hll::add(h, elements(0, 50), changed);
+    ASSERT_EQ(hll::count(h, n, updated), hll::Status::OK);
+    EXPECT_TRUE(updated);
+    ASSERT_EQ(hll::count(h, n, updated), hll::Status::OK);
+    EXPECT_FALSE(updated);
+    EXPECT_EQ(n, 50u);
+    hll::add(h, elements(50, 60), changed);
+    ASSERT_EQ(hll::count(h, n, updated), hll::Status::OK);
+    EXPECT_TRUE(updated);
+    EXPECT_EQ(n, 60u);
+}
+
+TEST(HyperLogLog, MergeMatchesTheUnion) {
+    std::string a = hll::create();
+    std::string b = hll::create();
+    std::string both = hll::create();
+    bool changed;
+    hll::add(a, elements(0, 30000), changed);
+    hll::add(b, elements(20000, 20100), changed);  // stays sparse
+    hll::add(both, elements(0, 30000), changed);
+    hll::add(both, elements(20000, 20100), changed);
+
+    std::vector<u8> registers(hll::REGISTERS, 0);
+    ASSERT_EQ(hll::merge_into(registers.data(), a), hll::Status::OK);
+    ASSERT_EQ(hll::merge_into(registers.data(), b), hll::Status::OK);
+    std::string merged = hll::from_registers(registers.data());
+    EXPECT_EQ(hll::count_registers(registers.data()), count_of(both));
+    EXPECT_EQ(merged.substr(16), both.substr(16));
+}
+
+TEST(HyperLogLog, RejectsOtherStrings) {
+    std::string plain = "hello";
+    bool changed;
+    u64 n;
+    EXPECT_EQ(hll::add(plain, elements(0, 1), changed), hll::Status::NOT_HLL);
+    EXPECT_EQ(plain, "hello");
+    EXPECT_EQ(hll::count(plain, n, changed), hll::Status::NOT_HLL);
+
+    // Sparse opcodes that cover fewer than 16384 registers.
+    std::string corrupt = hll::create();
+    corrupt.back() = '\x00';
+    corrupt[15] = '\x80';  // invalidate the cache
+    EXPECT_EQ(hll::count(corrupt, n, changed), hll::Status::CORRUPT);
+    std::vector<u8> registers(hll::REGISTERS, 0);
+    EXPECT_EQ(hll::merge_into(registers.data(), corrupt),
+              hll::Status::CORRUPT);
+}
@@ -0,0 +1,294 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include "client/reply_parser.hpp"
+#include "server/client_limits.hpp"
+#include "server/request_reader.hpp"
+#include "util/RESP.hpp"
+#include "util/simd_scan.hpp"
+
+// Reference implementations: the parser's original scalar helpers, kept here
+// so the vectorized scanner and the fast integer path are checked against
+// exactly what they replaced.
+static size_t legacy_find_crlf(const std::string& data) {
+    return data.find("\r\n");
+}
+
+static bool legacy_stoll(const std::string& line, long long& out) {
+    try {
+        size_t pos;
+        long long val = std::stoll(line, &pos);
+        if (pos != line.length()) {
+            return false;
+        }
+        out = val;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+static std::string random_bytes(std::mt19937_64& rng, size_t len) {
+    // Bias towards the delimiters so matches (and near-misses) are common.
+    static const char alphabet[] = {'\r', '\n', 'a', '0', '\0', '\xff', ' '};
+    std::uniform_int_distribution<int> pick(0, sizeof(alphabet) - 1);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::string out(len, '\0');
+    for (auto& c : out) {
+        c = (rng() % 4 == 0) ? alphabet[pick(rng)] : static_cast<char>(byte(rng));
+    }
+    return out;
+}
+
+TEST(ParseFuzz, FindCRLFMatchesLegacyForEveryImpl) {
+    std::mt19937_64 rng(1234);
+    for (int iter = 0; iter < 20000; iter++) {
+        std::string data = random_bytes(rng, rng() % 200);
+        size_t expected = legacy_find_crlf(data);
+
+        EXPECT_EQ(find_crlf(data.data(), data.size()), expected);
+        for (ScanImpl impl : {ScanImpl::SCALAR, ScanImpl::SSE2, ScanImpl::AVX2}) {
+            if (!scan_impl_supported(impl)) {
+                continue;
+            }
+            ASSERT_EQ(find_crlf_with(impl, data.data(), data.size()), expected)
+                << "impl=" << scan_impl_name(impl) << " len=" << data.size();
+        }
+    }
+}
+
+TEST(ParseFuzz, FindCRLFAtEveryOffset) {
+    for (size_t len = 2; len < 100; len++) {
+        for (size_t at = 0; at + 1 < len; at++) {
+            std::string data(len, 'x');
+            data[at] = '\r';
+            data[at + 1] = '\n';
+            for (ScanImpl impl : {ScanImpl::SCALAR, ScanImpl::SSE2, ScanImpl::AVX2}) {
+                if (scan_impl_supported(impl)) {
+                    ASSERT_EQ(find_crlf_with(impl, data.data(), data.size()), at);
+                }
+            }
+        }
+    }
+}
+
+TEST(ParseFuzz, FastIntegerAgreesWithLegacyWhenItAccepts) {
+    std::mt19937_64 rng(99);
+    static const char digits[] = "0123456789-+ x";
+    for (int iter = 0; iter < 100000; iter++) {
+        std::string line(rng() % 22, '0');
+        for (auto& c : line) {
+            c = (rng() % 8 == 0) ? digits[rng() % (sizeof(digits) - 1)]
+                                 : static_cast<char>('0' + rng() % 10);
+        }
+
+        long long fast = 0, legacy = 0;
+        bool fast_ok = parse_int_fast(line.data(), line.size(), fast);
+        bool legacy_ok = legacy_stoll(line, legacy);
+        if (fast_ok) {
+            ASSERT_TRUE(legacy_ok) << line;
+            ASSERT_EQ(fast, legacy) << line;
+        }
+    }
+}
+
+TEST(ParseFuzz, FastIntegerBoundaries) {
+    long long v;
+    EXPECT_TRUE(parse_int_fast("9223372036854775807", 19, v));
+    EXPECT_EQ(v, 9223372036854775807LL);
+    EXPECT_TRUE(parse_int_fast("-9223372036854775808", 20, v));
+    EXPECT_EQ(v, -9223372036854775807LL - 1);
+    EXPECT_FALSE(parse_int_fast("9223372036854775808", 19, v));
+    EXPECT_FALSE(parse_int_fast("-", 1, v));
+    EXPECT_FALSE(parse_int_fast("", 0, v));
+    EXPECT_FALSE(parse_int_fast("12a", 3, v));
+}
+
+// Random RESP frames, whole and truncated: the parser must either return the
+// same structure it was given or throw, never crash or misread.
+TEST(ParseFuzz, RoundTripsRandomFrames) {
+    std::mt19937_64 rng(7);
+    for (int iter = 0; iter < 5000; iter++) {
+        RESP r{.resp_type = RESP::type::ARRAY};
+        size_t n = rng() % 8;
+        for (size_t i = 0; i < n; i++) {
+            r.elements.push_back({.resp_type = RESP::type::BULK_STRING,
+                                  .str = random_bytes(rng, rng() % 64)});
+        }
+        std::string wire = serialize_RESP(r);
+
+        size_t pos = 0;
+        RESP parsed = parse_RESP(wire, pos);
+        ASSERT_EQ(pos, wire.size());
+        ASSERT_EQ(serialize_RESP(parsed), wire);
+
+        std::string cut = wire.substr(0, rng() % wire.size());
+        pos = 0;
+        EXPECT_THROW(parse_RESP(cut, pos), std::runtime_error);
+    }
+}
+
+TEST(Parse, LegacyIntegerSpellingsStillAccepted) {
+    std::string data = ":+42\r\n";
+    size_t pos = 0;
+    EXPECT_EQ(parse_RESP(data, pos).integer, 42);
+}
+
+TEST(Parse, PushFramesRoundTripAndFrame) {
+    std::string wire = ">2\r\n$10\r\ninvalidate\r\n*1\r\n$3\r\nfoo\r\n";
+    size_t pos = 0;
+    RESP push = parse_RESP(wire, pos);
+    EXPECT_EQ(push.resp_type, RESP::type::PUSH);
+    ASSERT_EQ(push.elements.size(), 2u);
+    EXPECT_EQ(push.elements[1].elements[0].str, "foo");
+    EXPECT_EQ(serialize_RESP(push), wire);
+    EXPECT_EQ(Redis::ReplyParser::frame_length(wire, 0), wire.size());
+    EXPECT_EQ(Redis::ReplyParser::frame_length(wire.substr(0, 20), 0), 0u);
+}
+
+// The parser resumes its scan where the previous feed() stopped; fed one byte
+// at a time it must still split the stream exactly where frame_length does.
+TEST(ReplyParser, ByteAtATimeMatchesWholeFrames) {
+    std::string wire = "+OK\r\n*-1\r\n*0\r\n$-1\r\n"
+                       "*3\r\n:1\r\n*2\r\n$3\r\nfoo\r\n*0\r\n$0\r\n\r\n"
+                       ">2\r\n$10\r\ninvalidate\r\n*1\r\n$1\r\nk\r\n"
+                       "-ERR x\r\n";
+    std::vector<std::string> expected;
+    for (size_t pos = 0; pos < wire.size();) {
+        size_t len = Redis::ReplyParser::frame_length(wire, pos);
+        ASSERT_GT(len, 0u);
+        expected.push_back(wire.substr(pos, len));
+        pos += len;
+    }
+
+    Redis::ReplyParser parser;
+    std::vector<std::string> frames;
+    for (char ch : wire) {
+        parser.feed(&ch, 1);
+        while (auto reply = parser.next()) frames.push_back(serialize_RESP(*reply));
+    }
+    EXPECT_EQ(frames, expected);
+    EXPECT_EQ(parser.buffered(), 0u);
+}
+
+// Feeds wire in random-sized chunks the way TCPServer does, receiving large
+// arguments in place, and returns every command that came out.
+static std::vector<std::vector<std::string>> read_requests(
+        const std::string& wire, std::mt19937_64& rng) {
+    Redis::RequestReader reader;
+    std::vector<std::vector<std::string>> out;
+    std::vector<std::string> tokens;
+    size_t pos = 0;
+    while (pos < wire.size()) {
+        size_t chunk = 1 + rng() % 5000;
+        std::span<char> direct = reader.direct_buffer();
+        if (!direct.empty()) {
+            size_t n = std::min({chunk, direct.size(), wire.size() - pos});
+            std::memcpy(direct.data(), wire.data() + pos, n);
+            reader.direct_commit(n);
+            pos += n;
+        } else {
+            size_t n = std::min(chunk, wire.size() - pos);
+            reader.feed(wire.data() + pos, n);
+            pos += n;
+        }
+        while (reader.next(tokens)) out.push_back(tokens);
+    }
+    return out;
+}
+
+TEST(RequestReader, ReassemblesSplitCommandsIncludingBigArgs) {
+    std::mt19937_64 rng(7);
+    std::vector<std::vector<std::string>> commands;
+    std::string wire;
+    for (int i = 0; i < 200; i++) {
+        std::vector<std::string> cmd = {"SET", "key" + std::to_string(i)};
+        size_t len = i % 20 == 0 ? Redis::RequestReader::BIG_ARG + rng() % 100000
+                                 : rng() % 100;
+        cmd.push_back(random_bytes(rng, len));
+        RESP r{.resp_type = RESP::type::ARRAY};
+        for (const auto& arg : cmd) {
+            r.elements.push_back({.resp_type = RESP::type::BULK_STRING, .str = arg});
+        }
+        wire += serialize_RESP(r);
+        commands.push_back(std::move(cmd));
+    }
+
+    for (int round = 0; round < 5; round++) {
+        EXPECT_EQ(read_requests(wire, rng), commands);
+    }
+}
+
+TEST(RequestReader, RejectsMalformedInput) {
+    std::vector<std::string> tokens;
+    for (std::string bad : {"PING\r\n", "*1\r\n:1\r\n", "*1\r\n$3\r\nabcXY",
+                            "*1\r\n$-5\r\n", "*x\r\n"}) {
+        Redis::RequestReader reader;
+        reader.feed(bad.data(), bad.size());
+        EXPECT_THROW(reader.next(tokens), std::runtime_error) << bad;
+    }
+}
+
+TEST(RequestReader, EnforcesQueryBufferLimit) {
+    std::vector<std::string> tokens;
+
+    // Refused at the header, before a 100 MB argument is allocated.
+    Redis::RequestReader big;
+    big.set_limit(1024 * 1024);
+    std::string header = "*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$104857600\r\n";
+    big.feed(header.data(), header.size());
+    EXPECT_THROW(big.next(tokens), Redis::QueryBufferLimitError);
+
+    // An unterminated stream of small pipelined data trips it as well.
+    Redis::RequestReader slow;
+    slow.set_limit(1024);
+    std::string partial = "*2\r\n$3\r\nGET\r\n$2000\r\n" + std::string(1500, 'x');
+    slow.feed(partial.data(), partial.size());
+    EXPECT_THROW(slow.next(tokens), Redis::QueryBufferLimitError);
+
+    Redis::RequestReader ok;
+    ok.set_limit(1024);
+    std::string ping = "*1\r\n$4\r\nPING\r\n";
+    ok.feed(ping.data(), ping.size());
+    EXPECT_TRUE(ok.next(tokens));
+}
+
+TEST(ClientLimits, ParsesRedisSyntaxAndAppliesSoftLimitOverTime) {
+    u64 bytes;
+    EXPECT_TRUE(Redis::parse_memory_amount("64kb", bytes));
+    EXPECT_EQ(bytes, 65536u);
+    EXPECT_TRUE(Redis::parse_memory_amount("1G", bytes));
+    EXPECT_EQ(bytes, 1000000000u);
+    EXPECT_FALSE(Redis::parse_memory_amount("12xb", bytes));
+    EXPECT_FALSE(Redis::parse_memory_amount("mb", bytes));
+
+    Redis::ClientLimits limits;
+    EXPECT_FALSE(limits.set_output_limits("normal 1mb 512kb"));
+    EXPECT_FALSE(limits.set_output_limits("bogus 1mb 512kb 10"));
+    ASSERT_TRUE(limits.set_output_limits("normal 1mb 512kb 10"));
+
+    using Redis::ClientClass;
+    i64 since = 0;
+    EXPECT_FALSE(limits.output_over_limit(ClientClass::NORMAL, 1000, 0, since));
+    EXPECT_TRUE(limits.output_over_limit(ClientClass::NORMAL, 1 << 20, 0, since));
+    EXPECT_FALSE(limits.output_over_limit(ClientClass::NORMAL, 600000, 1000, since));
+    EXPECT_EQ(since, 1000);
+    EXPECT_FALSE(limits.output_over_limit(ClientClass::NORMAL, 600000, 11000, since));
+    EXPECT_TRUE(limits.output_over_limit(ClientClass::NORMAL, 600000, 11001, since));
+    // Dropping under the soft limit restarts the clock.
+    EXPECT_FALSE(limits.output_over_limit(ClientClass::NORMAL, 10, 11002, since));
+    EXPECT_EQ(since, 0);
+}
+
+TEST(ClientLimits, DefaultsBoundNormalClientsAndTheTotal) {
+    Redis::ClientLimits limits;
+    EXPECT_EQ(limits.output_limit(Redis::ClientClass::NORMAL).hard, 1ULL << 30);
+    EXPECT_EQ(limits.total_output_limit(), 2ULL << 30);
+    EXPECT_EQ(limits.output_limits_string(),
+              "normal 1073741824 0 0 replica 268435456 67108864 60 "
+              "pubsub 33554432 8388608 60");
+}
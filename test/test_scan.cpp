@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <vector>
+#include "common/concurrent_store.hpp"
+#include "common/dict.hpp"
+#include "util/glob.hpp"
+
+using Redis::ConcurrentStore;
+using Redis::Dict;
+using Redis::ScanEntry;
+
+static void insert(Dict<int>& d, int i) {
+    std::string key = "key:" + std::to_string(i);
+    d.insert_or_assign(key, Dict<int>::hash_key(key), i);
+}
+
+static void erase(Dict<int>& d, int i) {
+    std::string key = "key:" + std::to_string(i);
+    d.erase(key, Dict<int>::hash_key(key));
+}
+
+// Keys present from the first to the last SCAN call must all be returned,
+// whatever the table does in between.
+TEST(DictScan, CoversStableKeysWhileGrowing) {
+    Dict<int> d;
+    for (int i = 0; i < 100; i++) insert(d, i);
+
+    std::set<int> seen;
+    u64 cursor = 0;
+    int next = 100;
+    do {
+        cursor = d.scan(cursor, [&](const std::string&, int v) { seen.insert(v); });
+        if (next < 2000) insert(d, next++);
+    } while (cursor != 0);
+
+    EXPECT_GT(d.bucket_count(), 128u);
+    for (int i = 0; i < 100; i++) EXPECT_TRUE(seen.count(i)) << i;
+}
+
+TEST(DictScan, CoversStableKeysWhileShrinking) {
+    Dict<int> d;
+    for (int i = 0; i < 5000; i++) insert(d, i);
+    size_t before = d.bucket_count();
+
+    std::set<int> seen;
+    u64 cursor = 0;
+    int victim = 100;
+    do {
+        cursor = d.scan(cursor, [&](const std::string&, int v) { seen.insert(v); });
+        for (int j = 0; j < 100 && victim < 5000; j++) erase(d, victim++);
+    } while (cursor != 0);
+
+    EXPECT_LT(d.bucket_count(), before);
+    for (int i = 0; i < 100; i++) EXPECT_TRUE(seen.count(i)) << i;
+}
+
+static bool contains(const Dict<int>& d, int i) {
+    std::string key = "key:" + std::to_string(i);
+    return d.find(key, Dict<int>::hash_key(key)) != nullptr;
+}
+
+// Each write moves one bucket, so until a resize completes keys live in both
+// tables; lookups and SCAN must see all of them, and rehash() finishes it.
+TEST(DictRehash, ResizesIncrementally) {
+    Dict<int> d;
+    int next = 0;
+    while (next < 4096) insert(d, next++);
+    EXPECT_FALSE(d.rehashing());
+    insert(d, next++);
+    ASSERT_TRUE(d.rehashing());
+    EXPECT_EQ(d.bucket_count(), 8192u);
+    for (int i = 0; i < next; i++) EXPECT_TRUE(contains(d, i)) << i;
+
+    std::set<int> seen;
+    u64 cursor = 0;
+    do {
+        cursor = d.scan(cursor, [&](const std::string&, int v) { seen.insert(v); });
+    } while (cursor != 0);
+    EXPECT_EQ(seen.size(), static_cast<size_t>(next));
+
+    int batches = 0;
+    d.set_rehash_observer([&](u64) { batches++; });
+    while (d.rehash(100)) {}
+    EXPECT_FALSE(d.rehashing());
+    EXPECT_GT(batches, 1);
+    EXPECT_EQ(d.size(), static_cast<size_t>(next));
+    for (int i = 0; i < next; i++) EXPECT_TRUE(contains(d, i)) << i;
+
+    for (int i = 0; i < next; i++) erase(d, i);
+    while (d.rehash(100)) {}
+    EXPECT_TRUE(d.empty());
+    EXPECT_LT(d.bucket_count(), 8192u);
+}
+
+TEST(StoreScan, VisitsEveryShardAndRespectsCount) {
+    ConcurrentStore store;
+    for (int i = 0; i < 1000; i++) {
+        store.set("k" + std::to_string(i), Redis::Value{std::string("v")});
+    }
+    EXPECT_EQ(store.size(), 1000u);
+
+    std::set<std::string> seen;
+    std::vector<ScanEntry> batch;
+    u64 cursor = 0;
+    size_t calls = 0;
+    do {
+        batch.clear();
+        cursor = store.scan(cursor, 10, batch);
+        for (auto& e : batch) seen.insert(e.key);
+        calls++;
+    } while (cursor != 0);
+
+    EXPECT_EQ(seen.size(), 1000u);
+    EXPECT_GT(calls, 10u);
+}
+
+TEST(Glob, MatchesRedisSyntax) {
+    EXPECT_TRUE(glob_match("*", ""));
+    EXPECT_TRUE(glob_match("user:*", "user:42"));
+    EXPECT_FALSE(glob_match("user:*", "users:42"));
+    EXPECT_TRUE(glob_match("h?llo", "hello"));
+    EXPECT_TRUE(glob_match("h[ae]llo", "hallo"));
+    EXPECT_FALSE(glob_match("h[^e]llo", "hello"));
+    EXPECT_TRUE(glob_match("h[a-c]llo", "hbllo"));
+    EXPECT_TRUE(glob_match("a\\*b", "a*b"));
+    EXPECT_FALSE(glob_match("a\\*b", "axb"));
+    EXPECT_TRUE(glob_match("*a*b*c", "xxaxxbxxc"));
+    EXPECT_FALSE(glob_match("*a*b*c", "xxaxxbxx"));
+    EXPECT_TRUE(glob_is_literal("plain:key"));
+    EXPECT_FALSE(glob_is_literal("key*"));
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <climits>
+#include <string>
+#include "common/concurrent_store.hpp"
+
+using Redis::ConcurrentStore;
+using Redis::RedisData;
+using Redis::SetOptions;
+using Redis::StoreStatus;
+
+TEST(StringEncoding, OnlyCanonicalIntegersBecomeInts) {
+    EXPECT_TRUE(std::holds_alternative<i64>(Redis::encode_string("0")));
+    EXPECT_TRUE(std::holds_alternative<i64>(Redis::encode_string("-42")));
+    EXPECT_TRUE(std::holds_alternative<i64>(
+        Redis::encode_string("9223372036854775807")));
+    EXPECT_TRUE(std::holds_alternative<i64>(
+        Redis::encode_string("-9223372036854775808")));
+
+    for (const char* s : {"", "-", "-0", "007", "+1", " 1", "1 ", "1.0",
+                          "9223372036854775808", "abc"}) {
+        EXPECT_TRUE(std::holds_alternative<std::string>(Redis::encode_string(s)))
+            << s;
+    }
+}
+
+TEST(StoreIncr, CountsInPlaceAndRejectsBadValues) {
+    ConcurrentStore store;
+    i64 result = 0;
+    EXPECT_EQ(store.incr_by("n", 5, result), StoreStatus::OK);
+    EXPECT_EQ(result, 5);
+    EXPECT_EQ(store.incr_by("n", -7, result), StoreStatus::OK);
+    EXPECT_EQ(result, -2);
+
+    store.set("max", Redis::encode_string(std::to_string(LLONG_MAX)),
+              SetOptions{});
+    EXPECT_EQ(store.incr_by("max", 1, result), StoreStatus::OVERFLOW);
+    EXPECT_EQ(std::get<i64>(*store.get("max")), LLONG_MAX);
+
+    store.set("s", Redis::encode_string("12abc"), SetOptions{});
+    EXPECT_EQ(store.incr_by("s", 1, result), StoreStatus::NOT_INTEGER);
+
+    std::string items[] = {"a"};
+    store.rpush("l", items);
+    EXPECT_EQ(store.incr_by("l", 1, result), StoreStatus::WRONG_TYPE);
+}
+
+TEST(StoreIncr, FloatResultsUseRedisFormatting) {
+    ConcurrentStore store;
+    std::string result;
+    ASSERT_EQ(store.incr_by_float("f", 10.5L, result), StoreStatus::OK);
+    EXPECT_EQ(result, "10.5");
+    ASSERT_EQ(store.incr_by_float("f", -0.5L, result), StoreStatus::OK);
+    EXPECT_EQ(result, "10");
+    // A whole result is stored as an integer, so INCR keeps working.
+    i64 n = 0;
+    EXPECT_EQ(store.incr_by("f", 1, n), StoreStatus::OK);
+    EXPECT_EQ(n, 11);
+}
+
+TEST(StoreSet, ConditionsGetAndKeepTtl) {
+    ConcurrentStore store;
+    SetOptions nx;
+    nx.condition = SetOptions::Condition::IF_ABSENT;
+    SetOptions xx;
+    xx.condition = SetOptions::Condition::IF_PRESENT;
+
+    EXPECT_EQ(store.set("k", std::string("a"), xx), StoreStatus::NOT_SET);
+    EXPECT_FALSE(store.contains("k"));
+    EXPECT_EQ(store.set("k", std::string("a"), nx), StoreStatus::OK);
+    EXPECT_EQ(store.set("k", std::string("b"), nx), StoreStatus::NOT_SET);
+
+    SetOptions ttl;
+    ttl.ttl_ms = 100000;
+    store.set("k", std::string("c"), ttl);
+    SetOptions keep;
+    keep.keep_ttl = true;
+    std::optional<RedisData> old;
+    EXPECT_EQ(store.set("k", std::string("d"), keep, &old), StoreStatus::OK);
+    EXPECT_EQ(std::get<std::string>(*old), "c");
+    EXPECT_GT(store.dump("k")->second, 0);
+
+    store.set("k", std::string("e"), SetOptions{});
+    EXPECT_EQ(store.dump("k")->second, 0);
+
+    EXPECT_EQ(store.getdel("k", old), StoreStatus::OK);
+    EXPECT_EQ(std::get<std::string>(*old), "e");
+    EXPECT_FALSE(store.contains("k"));
+}
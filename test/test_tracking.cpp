@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "client/async_connection.hpp"
+#include "client/client_cache.hpp"
+#include "client/reply_parser.hpp"
+#include "common/concurrent_store.hpp"
+#include "server/tracking.hpp"
+
+using Redis::ClientCache;
+using Redis::ConcurrentStore;
+using Redis::SetOptions;
+using Redis::TrackingTable;
+
+TEST(TrackingTable, RememberedReadersAreCollectedOnce) {
+    TrackingTable table;
+    std::vector<u32> evicted;
+    table.remember("k", 1, evicted);
+    table.remember("k", 2, evicted);
+    table.remember("k", 1, evicted);
+    EXPECT_TRUE(evicted.empty());
+    EXPECT_EQ(table.tracked_keys(), 1u);
+
+    std::vector<u32> out;
+    table.collect("other", out);
+    EXPECT_TRUE(out.empty());
+    table.collect("k", out);
+    std::sort(out.begin(), out.end());
+    EXPECT_EQ(out, (std::vector<u32>{1, 2}));
+
+    // One invalidation per read: the entry is gone until read again.
+    out.clear();
+    table.collect("k", out);
+    EXPECT_TRUE(out.empty());
+    EXPECT_EQ(table.tracked_keys(), 0u);
+}
+
+TEST(TrackingTable, ReportsClientsOfEvictedEntries) {
+    // One entry per stripe, so the 17th key must evict somebody.
+    TrackingTable table(TrackingTable::STRIPE_COUNT);
+    std::vector<u32> evicted;
+    for (u32 i = 0; i <= TrackingTable::STRIPE_COUNT; i++) {
+        table.remember("key:" + std::to_string(i), 100 + i, evicted);
+    }
+    ASSERT_FALSE(evicted.empty());
+    EXPECT_LE(table.tracked_keys(), TrackingTable::STRIPE_COUNT);
+
+    // Evicted readers are no longer collected for their key.
+    for (u32 id : evicted) {
+        std::vector<u32> out;
+        table.collect("key:" + std::to_string(id - 100), out);
+        EXPECT_TRUE(std::find(out.begin(), out.end(), id) == out.end());
+    }
+}
+
+TEST(TrackingTable, PrefixSubscriptions) {
+    TrackingTable table;
+    table.subscribe_prefix(1, "user:");
+    table.subscribe_prefix(2, "user:");
+    table.subscribe_prefix(2, "");
+    EXPECT_EQ(table.prefixes(), 2u);
+
+    std::vector<u32> out;
+    table.collect("user:7", out);
+    std::sort(out.begin(), out.end());
+    EXPECT_EQ(out, (std::vector<u32>{1, 2, 2}));
+
+    // Broadcast entries are not consumed.
+    out.clear();
+    table.collect("user:7", out);
+    EXPECT_EQ(out.size(), 3u);
+
+    out.clear();
+    table.collect("item:1", out);
+    EXPECT_EQ(out, (std::vector<u32>{2}));
+
+    table.unsubscribe(2);
+    EXPECT_EQ(table.prefixes(), 1u);
+    out.clear();
+    table.collect("item:1", out);
+    EXPECT_TRUE(out.empty());
+    table.unsubscribe(1);
+    EXPECT_EQ(table.prefixes(), 0u);
+}
+
+TEST(KeyObserver, FiresOnWritesDeletesAndExpiry) {
+    ConcurrentStore store;
+    std::vector<std::string> notified;
+    store.set_key_observer(
+        [&](const std::string& key) { notified.push_back(key); });
+
+    store.set("s", std::string("a"), SetOptions{});
+    std::string items[] = {"x"};
+    store.rpush("l", items);
+    store.erase("s");
+    EXPECT_FALSE(store.erase("missing"));
+    EXPECT_EQ(notified, (std::vector<std::string>{"s", "l", "s"}));
+
+    SetOptions ttl;
+    ttl.ttl_ms = 1;
+    store.set("lazy", std::string("a"), ttl);
+    store.set("active", std::string("a"), ttl);
+    notified.clear();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    // Reads do not notify; expiring on read does.
+    EXPECT_FALSE(store.get("lazy"));
+    EXPECT_EQ(notified, (std::vector<std::string>{"lazy"}));
+    for (int i = 0; i < 100 && notified.size() < 2; i++) {
+        store.active_expiry_cycle();
+    }
+    EXPECT_EQ(notified, (std::vector<std::string>{"lazy", "active"}));
+}
+
+// A one-connection server that answers each request with the next scripted
+// response, so a test decides where pushes land relative to replies.
+class ScriptedServer {
+public:
+    explicit ScriptedServer(std::vector<std::string> responses)
+        : responses_(std::move(responses)) {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        listen(listen_fd_, 1);
+        socklen_t len = sizeof(addr);
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        thread_ = std::thread([this] { serve(); });
+    }
+
+    ~ScriptedServer() {
+        thread_.join();
+        close(listen_fd_);
+    }
+
+    int port() const { return port_; }
+    size_t requests() const { return next_; }
+
+private:
+    void serve() {
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        std::string buf;
+        char chunk[4096];
+        ssize_t n;
+        while ((n = recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+            buf.append(chunk, n);
+            size_t len;
+            while ((len = Redis::ReplyParser::frame_length(buf, 0)) > 0) {
+                buf.erase(0, len);
+                const std::string& out = responses_.at(next_++);
+                send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+            }
+        }
+        close(fd);
+    }
+
+    std::vector<std::string> responses_;
+    std::atomic<size_t> next_{0};
+    int listen_fd_;
+    int port_;
+    std::thread thread_;
+};
+
+// An invalidation that arrives while the GET is in flight means the reply
+// may already be stale, so it is returned but not cached.
+TEST(ClientCache, InvalidatedInFlightReplyIsNotCached) {
+    ScriptedServer server({
+        "+OK\r\n",
+        ">2\r\n$10\r\ninvalidate\r\n*1\r\n$1\r\nk\r\n$3\r\nold\r\n",
+        "$3\r\nnew\r\n",
+    });
+    {
+        ClientCache cache("127.0.0.1", server.port());
+        EXPECT_EQ(cache.get("k"), "old");
+        EXPECT_EQ(cache.size(), 0u);
+        EXPECT_EQ(cache.invalidations(), 1u);
+
+        EXPECT_EQ(cache.get("k"), "new");
+        EXPECT_EQ(cache.size(), 1u);
+        EXPECT_EQ(cache.get("k"), "new");
+        EXPECT_EQ(cache.hits(), 1u);
+        EXPECT_EQ(cache.misses(), 2u);
+    }
+    EXPECT_EQ(server.requests(), 3u);
+}
+
+// Dropping the last reference from a reply callback runs the destructor on
+// the I/O thread, which cannot join itself.
+TEST(AsyncConnection, CanBeReleasedFromItsOwnCallback) {
+    ScriptedServer server({"+PONG\r\n"});
+    auto conn = std::make_shared<Redis::AsyncConnection>("127.0.0.1",
+                                                         server.port());
+    Redis::AsyncConnection* raw = conn.get();
+    std::promise<void> released;
+    raw->command({"PING"},
+                 [conn = std::move(conn), &released](const RESP&) mutable {
+                     conn.reset();
+                     released.set_value();
+                 });
+    EXPECT_EQ(released.get_future().wait_for(std::chrono::seconds(5)),
+              std::future_status::ready);
+}
+
+// A listener that never accepts and whose backlog is full leaves connect()
+// pending forever; the constructor gives up at its deadline.
+TEST(AsyncConnection, ConnectTimesOut) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    listen(listener, 0);
+    socklen_t len = sizeof(addr);
+    getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len);
+    int filler = socket(AF_INET, SOCK_STREAM, 0);
+    connect(filler, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_THROW(Redis::AsyncConnection("127.0.0.1", ntohs(addr.sin_port),
+                                        std::chrono::milliseconds(200)),
+                 std::runtime_error);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+    close(filler);
+    close(listener);
+}
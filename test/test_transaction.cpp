@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/concurrent_store.hpp"
+
+using Redis::ConcurrentStore;
+using Redis::SetOptions;
+
+TEST(StoreVersion, ChangesOnWriteDeleteAndExpiry) {
+    ConcurrentStore store;
+    u64 absent = store.version("k");
+    EXPECT_NE(absent & ConcurrentStore::ABSENT_VERSION, 0u);
+
+    store.set("k", std::string("a"), SetOptions{});
+    u64 v1 = store.version("k");
+    EXPECT_NE(v1, absent);
+    EXPECT_EQ(store.version("k"), v1);
+
+    i64 n;
+    store.set("k", Redis::encode_string("1"), SetOptions{});
+    store.incr_by("k", 1, n);
+    u64 v2 = store.version("k");
+    EXPECT_GT(v2, v1);
+
+    store.erase("k");
+    EXPECT_NE(store.version("k") & ConcurrentStore::ABSENT_VERSION, 0u);
+
+    SetOptions ttl;
+    ttl.ttl_ms = 1;
+    store.set("e", std::string("a"), ttl);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_NE(store.version("e") & ConcurrentStore::ABSENT_VERSION, 0u);
+}
+
+// WATCH on a missing key must see it created and removed again before EXEC.
+TEST(StoreVersion, MissingKeyCreatedThenRemovedChanges) {
+    ConcurrentStore store;
+    u64 watched = store.version("w2");
+    store.set("w2", std::string("1"), SetOptions{});
+    std::optional<Redis::RedisData> old;
+    store.getdel("w2", old);
+    EXPECT_NE(store.version("w2"), watched);
+
+    watched = store.version("w3");
+    SetOptions ttl;
+    ttl.ttl_ms = 1;
+    store.set("w3", std::string("1"), ttl);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    u64 expired = store.version("w3");
+    EXPECT_NE(expired, watched);
+    store.active_expiry_cycle();
+    EXPECT_EQ(store.version("w3"), expired);
+
+    // Reading a missing key does not change its version.
+    watched = store.version("w4");
+    EXPECT_FALSE(store.get("w4"));
+    EXPECT_EQ(store.version("w4"), watched);
+}
+
+// Store calls under a KeyLock run on the held shards without relocking, and
+// key notifications wait for the release.
+TEST(KeyLock, ReentrantCallsAndDeferredNotifications) {
+    ConcurrentStore store;
+    std::vector<std::string> notified;
+    store.set_key_observer(
+        [&](const std::string& key) { notified.push_back(key); });
+
+    std::vector<std::string> keys = {"a", "b", "c"};
+    {
+        ConcurrentStore::KeyLock lock(store, keys);
+        i64 n;
+        store.incr_by("a", 1, n);
+        store.set("b", std::string("x"), SetOptions{});
+        EXPECT_TRUE(store.get("b").has_value());
+        // A key outside the locked set still takes its own shard lock.
+        store.set("zzz", std::string("y"), SetOptions{});
+        EXPECT_TRUE(notified.empty());
+    }
+    EXPECT_EQ(notified.size(), 3u);
+    EXPECT_NE(store.version("c") & ConcurrentStore::ABSENT_VERSION, 0u);
+}
+
+TEST(KeyLock, OverlappingLocksDoNotDeadlock) {
+    ConcurrentStore store;
+    auto worker = [&](int seed) {
+        for (int i = 0; i < 2000; i++) {
+            std::vector<std::string> keys = {
+                "k" + std::to_string((i + seed) % 37),
+                "k" + std::to_string((i * 7 + seed) % 37)};
+            ConcurrentStore::KeyLock lock(store, keys);
+            i64 n;
+            store.incr_by(keys[0], 1, n);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) threads.emplace_back(worker, t);
+    for (auto& t : threads) t.join();
+
+    i64 total = 0;
+    for (int k = 0; k < 37; k++) {
+        auto v = store.get("k" + std::to_string(k));
+        if (v) total += std::get<i64>(*v);
+    }
+    EXPECT_EQ(total, 8 * 2000);
+}
+
+// Multi-key commands take their own KeyLock; inside EXEC the outer one
+// already covers their keys.
+TEST(KeyLock, NestedLockIsANoOp) {
+    ConcurrentStore store;
+    std::vector<std::string> notified;
+    store.set_key_observer(
+        [&](const std::string& key) { notified.push_back(key); });
+    std::vector<std::string> keys = {"a", "b"};
+    {
+        ConcurrentStore::KeyLock outer(store, keys);
+        {
+            ConcurrentStore::KeyLock inner(store, keys);
+            store.set("a", std::string("x"), SetOptions{});
+        }
+        // Releasing the inner lock must not flush notifications or drop
+        // the outer lock's ownership.
+        store.set("b", std::string("y"), SetOptions{});
+        EXPECT_TRUE(notified.empty());
+    }
+    EXPECT_EQ(notified.size(), 2u);
+}